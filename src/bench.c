@@ -0,0 +1,461 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * bench.c: benchmarks for opening, prerolling, seeking and decoding.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Output is one line per scenario, tab-separated, with a commented
+ * header line. All times are in milliseconds, decode rates in frames
+ * per second:
+ *
+ * # scenario  unit  runs  min  p50  p90  p99  max
+ *
+ * Colorspace conversion is measured separately for every converter
+ * and input format at 1080p, so they can be compared directly.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "colorconv.h"
+#include "convert.h"
+#include "dispatcher.h"
+#include "index.h"
+#include "pipeline.h"
+#include "seek.h"
+
+#define FIXTURE_SECONDS	10
+#define FRAME_TIMEOUT	(10 * G_USEC_PER_SEC)
+#define CONVERT_FRAMES	10
+
+typedef struct _Bench {
+  GstElement *play;
+  GstElement *video;
+  GstBus *bus;
+  GTimer *timer;
+
+  /* first frame notification from the streaming thread */
+  GMutex *lock;
+  GCond *cond;
+  gint frames;
+
+  /* seek scenarios, through the player's own seek controller and
+   * keyframe index; the dispatcher only exists meanwhile, since it
+   * would take the messages polled for elsewhere */
+  GstPlayerIndex *index;
+  GstPlayerDispatcher *disp;
+  GstPlayerSeek *seek;
+  gboolean seek_accurate;
+
+  /* colorspace conversion scenario */
+  const gchar *converter, *format;
+} Bench;
+
+static gint runs = 20;
+
+/*
+ * Fixture generation.
+ */
+
+static gchar *
+make_fixture (GError **err)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  gchar *filename, *desc;
+  gboolean res;
+  gint fd;
+
+  if ((fd = g_file_open_tmp ("aldegonde-bench-XXXXXX.ogg",
+           &filename, err)) < 0)
+    return NULL;
+  close (fd);
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d ! "
+      "video/x-raw-yuv,width=640,height=480,framerate=25/1 ! "
+      "theoraenc ! queue ! oggmux name=mux ! filesink location=%s "
+      "audiotestsrc num-buffers=%d ! audioconvert ! vorbisenc ! "
+      "queue ! mux.",
+      FIXTURE_SECONDS * 25, filename, FIXTURE_SECONDS * 44100 / 1024);
+  pipeline = gst_parse_launch (desc, err);
+  g_free (desc);
+  if (!pipeline) {
+    g_free (filename);
+    return NULL;
+  }
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  res = msg && GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS;
+  if (!res)
+    g_set_error (err, GST_PLAYER_ERROR, 1,
+                 "Failed to encode fixture (missing theora/vorbis/ogg?)");
+  if (msg)
+    gst_message_unref (msg);
+  gst_object_unref (GST_OBJECT (bus));
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (GST_OBJECT (pipeline));
+
+  if (!res) {
+    unlink (filename);
+    g_free (filename);
+    return NULL;
+  }
+
+  return filename;
+}
+
+/*
+ * Player setup.
+ */
+
+static void
+cb_handoff (GstElement *sink,
+	    GstBuffer  *buffer,
+	    GstPad     *pad,
+	    gpointer    data)
+{
+  Bench *bench = data;
+
+  g_mutex_lock (bench->lock);
+  bench->frames++;
+  g_cond_signal (bench->cond);
+  g_mutex_unlock (bench->lock);
+}
+
+static gboolean
+bench_init (Bench       *bench,
+            const gchar *uri,
+            GError     **err)
+{
+  GstElement *audio;
+
+  audio = gst_element_factory_make ("fakesink", "audio-sink");
+  bench->video = gst_element_factory_make ("fakesink", "video-sink");
+  g_object_set (audio, "sync", FALSE, NULL);
+  g_object_set (bench->video, "sync", FALSE, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (bench->video, "handoff", G_CALLBACK (cb_handoff), bench);
+
+  if (!(bench->play = gst_player_pipeline_new (audio, bench->video, err)))
+    return FALSE;
+  g_object_set (G_OBJECT (bench->play), "uri", uri, NULL);
+
+  /* kept in memory only, like the player's for remote media */
+  bench->index = gst_player_index_new (bench->play);
+  bench->disp = NULL;
+  bench->seek = NULL;
+
+  bench->bus = gst_pipeline_get_bus (GST_PIPELINE (bench->play));
+  bench->timer = g_timer_new ();
+  bench->lock = g_mutex_new ();
+  bench->cond = g_cond_new ();
+  bench->frames = 0;
+
+  return TRUE;
+}
+
+static void
+bench_reset (Bench *bench)
+{
+  GstMessage *msg;
+
+  gst_element_set_state (bench->play, GST_STATE_READY);
+  gst_element_get_state (bench->play, NULL, NULL, GST_CLOCK_TIME_NONE);
+  bench->frames = 0;
+
+  /* nobody else reads the bus, so drop what the last run left */
+  while ((msg = gst_bus_pop (bench->bus)))
+    gst_message_unref (msg);
+}
+
+static void
+bench_free (Bench *bench)
+{
+  gst_element_set_state (bench->play, GST_STATE_NULL);
+  gst_object_unref (GST_OBJECT (bench->play));
+  gst_player_index_free (bench->index);
+  gst_object_unref (GST_OBJECT (bench->bus));
+  g_timer_destroy (bench->timer);
+  g_mutex_free (bench->lock);
+  g_cond_free (bench->cond);
+}
+
+static gboolean
+wait_for_frame (Bench *bench)
+{
+  GTimeVal until;
+  gboolean res = TRUE;
+
+  g_get_current_time (&until);
+  g_time_val_add (&until, FRAME_TIMEOUT);
+
+  g_mutex_lock (bench->lock);
+  while (bench->frames == 0 && res)
+    res = g_cond_timed_wait (bench->cond, bench->lock, &until);
+  g_mutex_unlock (bench->lock);
+
+  return res;
+}
+
+/*
+ * Scenarios. Each returns one sample, or a negative value on failure.
+ */
+
+static gdouble
+run_first_frame (Bench *bench)
+{
+  bench_reset (bench);
+
+  g_timer_start (bench->timer);
+  gst_element_set_state (bench->play, GST_STATE_PLAYING);
+  if (!wait_for_frame (bench))
+    return -1.;
+
+  return g_timer_elapsed (bench->timer, NULL) * 1000.;
+}
+
+static gdouble
+run_preroll (Bench *bench)
+{
+  bench_reset (bench);
+
+  g_timer_start (bench->timer);
+  gst_element_set_state (bench->play, GST_STATE_PAUSED);
+  if (gst_element_get_state (bench->play, NULL, NULL,
+          GST_CLOCK_TIME_NONE) != GST_STATE_CHANGE_SUCCESS)
+    return -1.;
+
+  return g_timer_elapsed (bench->timer, NULL) * 1000.;
+}
+
+static gdouble
+run_seek (Bench *bench)
+{
+  GstPlayerSeek *seek = bench->seek;
+  GstMessage *msg;
+  guint seeks = seek->seeks;
+  gint64 pos;
+
+  /* stay prerolled between runs, seek somewhere else every time */
+  if (GST_STATE (bench->play) != GST_STATE_PAUSED) {
+    bench_reset (bench);
+    gst_element_set_state (bench->play, GST_STATE_PAUSED);
+    gst_element_get_state (bench->play, NULL, NULL, GST_CLOCK_TIME_NONE);
+  }
+  pos = g_random_int_range (0, (FIXTURE_SECONDS - 1) * 1000) * GST_MSECOND;
+
+  /* an earlier ASYNC_DONE would complete the seek right away */
+  while ((msg = gst_bus_pop (bench->bus)))
+    gst_message_unref (msg);
+
+  /* the timer slider seeks to keyframes while scrubbing and
+   * accurately when let go; either is done once the controller saw
+   * its ASYNC_DONE, and fails if it gave up waiting */
+  g_timer_start (bench->timer);
+  gst_player_seek_request (seek, pos, bench->seek_accurate);
+  while (seek->in_flight)
+    g_main_context_iteration (NULL, TRUE);
+  if (seek->seeks == seeks)
+    return -1.;
+
+  return g_timer_elapsed (bench->timer, NULL) * 1000.;
+}
+
+static gdouble
+run_decode (Bench *bench)
+{
+  GstMessage *msg;
+  gboolean res;
+
+  bench_reset (bench);
+
+  g_timer_start (bench->timer);
+  gst_element_set_state (bench->play, GST_STATE_PLAYING);
+  msg = gst_bus_poll (bench->bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  res = msg && GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS;
+  if (msg)
+    gst_message_unref (msg);
+  if (!res)
+    return -1.;
+
+  return bench->frames / g_timer_elapsed (bench->timer, NULL);
+}
+
+static gdouble
+run_convert (Bench *bench)
+{
+  return gst_player_convert_rate (bench->converter, bench->format,
+				  1920, 1080, CONVERT_FRAMES);
+}
+
+/*
+ * Statistics.
+ */
+
+static gint
+compare_double (gconstpointer a,
+                gconstpointer b)
+{
+  gdouble da = *(const gdouble *) a, db = *(const gdouble *) b;
+
+  return (da > db) - (da < db);
+}
+
+static gdouble
+percentile (GArray *samples,
+            gint    pct)
+{
+  gint idx = (samples->len * pct + 99) / 100 - 1;
+
+  return g_array_index (samples, gdouble, CLAMP (idx, 0, samples->len - 1));
+}
+
+static gboolean
+run_scenario (Bench       *bench,
+              const gchar *name,
+              const gchar *unit,
+              gdouble    (*func) (Bench *bench))
+{
+  GArray *samples = g_array_sized_new (FALSE, FALSE, sizeof (gdouble), runs);
+  gint n;
+
+  for (n = 0; n < runs; n++) {
+    gdouble sample = func (bench);
+
+    if (sample < 0.) {
+      g_printerr ("%s: run %d failed\n", name, n);
+      g_array_free (samples, TRUE);
+      return FALSE;
+    }
+    g_array_append_val (samples, sample);
+  }
+
+  g_array_sort (samples, compare_double);
+  g_print ("%s\t%s\t%d\t%.03lf\t%.03lf\t%.03lf\t%.03lf\t%.03lf\n",
+           name, unit, samples->len,
+           g_array_index (samples, gdouble, 0),
+           percentile (samples, 50), percentile (samples, 90),
+           percentile (samples, 99),
+           g_array_index (samples, gdouble, samples->len - 1));
+  g_array_free (samples, TRUE);
+
+  return TRUE;
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  GOptionContext *options;
+  GOptionEntry entries[] = {
+    {"runs", 'n', 0, G_OPTION_ARG_INT, &runs,
+     "Number of runs per scenario", "N"},
+    {NULL}
+  };
+  GError *err = NULL;
+  Bench bench;
+  gchar *fixture, *uri;
+  gboolean res = TRUE;
+  gint n;
+
+  g_thread_init (NULL);
+
+  options = g_option_context_new ("- benchmark the playback paths");
+  g_option_context_add_main_entries (options, entries, NULL);
+  g_option_context_add_group (options, gst_init_get_option_group ());
+  if (!g_option_context_parse (options, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    g_option_context_free (options);
+    return 1;
+  }
+  g_option_context_free (options);
+  gst_player_color_conv_register ();
+  if (runs < 1)
+    runs = 1;
+
+  if (!(fixture = make_fixture (&err))) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    return 1;
+  }
+  uri = g_filename_to_uri (fixture, NULL, NULL);
+
+  if (!bench_init (&bench, uri, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    unlink (fixture);
+    g_free (fixture);
+    g_free (uri);
+    return 1;
+  }
+
+  g_print ("# scenario\tunit\truns\tmin\tp50\tp90\tp99\tmax\n");
+  res &= run_scenario (&bench, "open-to-first-frame", "ms", run_first_frame);
+  res &= run_scenario (&bench, "preroll", "ms", run_preroll);
+  bench.disp = gst_player_dispatcher_new (bench.play);
+  bench.seek = gst_player_seek_new (bench.play, bench.disp);
+  gst_player_seek_set_index (bench.seek, bench.index);
+  bench.seek_accurate = FALSE;
+  res &= run_scenario (&bench, "flush-seek-keyframe", "ms", run_seek);
+  bench.seek_accurate = TRUE;
+  res &= run_scenario (&bench, "flush-seek-accurate", "ms", run_seek);
+  gst_player_seek_free (bench.seek);
+  gst_player_dispatcher_free (bench.disp);
+  bench.seek = NULL;
+  bench.disp = NULL;
+  res &= run_scenario (&bench, "decode", "fps", run_decode);
+
+  /* not every converter handles every format, that's no failure */
+  for (n = 0; gst_player_converters[n] != NULL; n++) {
+    GstElementFactory *factory;
+    gint f;
+
+    if (!(factory = gst_element_factory_find (gst_player_converters[n])))
+      continue;
+    gst_object_unref (GST_OBJECT (factory));
+
+    for (f = 0; gst_player_convert_formats[f] != NULL; f++) {
+      gchar *name = g_strdup_printf ("convert-%s-%s",
+				     gst_player_converters[n],
+				     gst_player_convert_formats[f]);
+
+      bench.converter = gst_player_converters[n];
+      bench.format = gst_player_convert_formats[f];
+      run_scenario (&bench, name, "fps", run_convert);
+      g_free (name);
+    }
+  }
+
+  bench_free (&bench);
+  unlink (fixture);
+  g_free (fixture);
+  g_free (uri);
+
+  return res ? 0 : 1;
+}
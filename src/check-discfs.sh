@@ -0,0 +1,110 @@
+#!/bin/sh
+# Builds small disc images with genisoimage or mkisofs and checks what
+# cd_fs_detect() makes of them, and of damaged copies. Skipped when
+# neither tool is installed.
+
+MKISOFS=
+for tool in genisoimage mkisofs; do
+  if $tool -version >/dev/null 2>&1; then
+    MKISOFS=$tool
+    break
+  fi
+done
+if test -z "$MKISOFS"; then
+  echo "genisoimage or mkisofs not found, skipping"
+  exit 77
+fi
+
+TEST_DISCFS=./test-discfs
+TMP=`mktemp -d ${TMPDIR:-/tmp}/check-discfs.XXXXXX` || exit 1
+trap 'rm -rf "$TMP"' 0 1 2 15
+FAILED=0
+
+# expect IMAGE RESULT[|RESULT...]
+expect ()
+{
+  res=`$TEST_DISCFS "$1"`
+  case "|$2|" in
+    *"|$res|"*)
+      echo "PASS: `basename $1`: $res"
+      ;;
+    *)
+      echo "FAIL: `basename $1`: $res, expected $2"
+      FAILED=1
+      ;;
+  esac
+}
+
+# image NAME [MKISOFS OPTIONS]
+image ()
+{
+  name=$1
+  shift
+  $MKISOFS -quiet "$@" -o "$TMP/$name.iso" "$TMP/$name" || exit 1
+}
+
+# garbage IMAGE SECTOR: overwrite a sector with 0xff bytes
+garbage ()
+{
+  dd if=/dev/zero bs=2048 count=1 2>/dev/null | tr '\000' '\377' | \
+    dd of="$1" bs=2048 seek=$2 conv=notrunc 2>/dev/null
+}
+
+# plain data
+mkdir -p "$TMP/data/DOCS"
+echo "nothing to see here" > "$TMP/data/DOCS/README.TXT"
+image data
+
+# Video CD and Super Video CD, identified by their info file
+mkdir -p "$TMP/vcd/VCD" "$TMP/vcd/MPEGAV"
+printf 'VIDEO_CD\002\000' > "$TMP/vcd/VCD/INFO.VCD"
+image vcd
+
+mkdir -p "$TMP/svcd/SVCD" "$TMP/svcd/MPEG2"
+printf 'SUPERVCD\001\000' > "$TMP/svcd/SVCD/INFO.SVD"
+image svcd
+
+# DVD-Video, on a UDF/ISO9660 bridge
+mkdir -p "$TMP/dvd/VIDEO_TS" "$TMP/dvd/AUDIO_TS"
+printf 'DVDVIDEO-VMG' > "$TMP/dvd/VIDEO_TS/VIDEO_TS.IFO"
+image dvd -udf
+
+# the same, but ISO9660 only
+cp -R "$TMP/dvd" "$TMP/dvdiso"
+image dvdiso
+
+expect "$TMP/data.iso" data
+expect "$TMP/vcd.iso" vcd
+expect "$TMP/svcd.iso" svcd
+expect "$TMP/dvd.iso" dvd
+expect "$TMP/dvdiso.iso" dvd
+
+# cut off after the primary volume descriptor, before the root
+# directory and the UDF anchor
+dd if="$TMP/dvd.iso" of="$TMP/truncated.iso" bs=2048 count=17 2>/dev/null
+expect "$TMP/truncated.iso" "data|error"
+
+# ISO9660 root directory (from the primary volume descriptor at
+# sector 16) overwritten with garbage
+cp "$TMP/vcd.iso" "$TMP/corrupted.iso"
+root=`od -An -tu1 -j 32926 -N 4 "$TMP/vcd.iso" | \
+  awk '{ print $1 + $2 * 256 + $3 * 65536 + $4 * 16777216 }'`
+garbage "$TMP/corrupted.iso" $root
+expect "$TMP/corrupted.iso" data
+
+# UDF anchor overwritten, the ISO9660 side still works
+cp "$TMP/dvd.iso" "$TMP/noanchor.iso"
+garbage "$TMP/noanchor.iso" 256
+expect "$TMP/noanchor.iso" dvd
+
+# every sector in turn damaged; must not crash
+for name in data vcd svcd dvd; do
+  if $TEST_DISCFS --damage "$TMP/$name.iso"; then
+    echo "PASS: $name.iso damaged"
+  else
+    echo "FAIL: $name.iso damaged"
+    FAILED=1
+  fi
+done
+
+exit $FAILED
@@ -0,0 +1,372 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * colorconv.c: YUV to 32 bit RGB converter for X sinks that only
+ * take RGB. Lines convert independently, so each frame is spread
+ * over all processors; the inner loop is plain integer arithmetic
+ * without lookups, which the compiler can vectorize.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "colorconv.h"
+#include "slices.h"
+
+#define YUV_CAPS \
+  "video/x-raw-yuv, format = (fourcc) { I420, YV12, NV12, YUY2 }, " \
+  "width = (int) [ 1, MAX ], height = (int) [ 1, MAX ], " \
+  "framerate = (fraction) [ 0, MAX ]"
+
+#define RGB_CAPS(r, g, b) \
+  "video/x-raw-rgb, bpp = (int) 32, depth = (int) 24, " \
+  "endianness = (int) 4321, red_mask = (int) " r ", " \
+  "green_mask = (int) " g ", blue_mask = (int) " b ", " \
+  "width = (int) [ 1, MAX ], height = (int) [ 1, MAX ], " \
+  "framerate = (fraction) [ 0, MAX ]"
+
+static GstStaticPadTemplate sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+			 GST_STATIC_CAPS (YUV_CAPS));
+static GstStaticPadTemplate src_template =
+GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+			 GST_STATIC_CAPS (
+    RGB_CAPS ("0x0000ff00", "0x00ff0000", "0xff000000") "; "
+    RGB_CAPS ("0xff000000", "0x00ff0000", "0x0000ff00") "; "
+    RGB_CAPS ("0x00ff0000", "0x0000ff00", "0x000000ff") "; "
+    RGB_CAPS ("0x000000ff", "0x0000ff00", "0x00ff0000")));
+
+/* copied from one side to the other */
+static const gchar *shared_fields[] = {
+  "width",
+  "height",
+  "framerate",
+  "pixel-aspect-ratio",
+  NULL
+};
+
+static void	gst_player_color_conv_base_init	(gpointer klass);
+static void	gst_player_color_conv_class_init (GstPlayerColorConvClass *klass);
+static void	gst_player_color_conv_init	(GstPlayerColorConv *conv);
+
+static GstCaps *gst_player_color_conv_transform_caps (GstBaseTransform *trans,
+						 GstPadDirection   direction,
+						 GstCaps          *caps);
+static gboolean	gst_player_color_conv_get_unit_size (GstBaseTransform *trans,
+						 GstCaps          *caps,
+						 guint            *size);
+static gboolean	gst_player_color_conv_set_caps	(GstBaseTransform *trans,
+						 GstCaps          *incaps,
+						 GstCaps          *outcaps);
+static GstFlowReturn
+		gst_player_color_conv_transform	(GstBaseTransform *trans,
+						 GstBuffer        *inbuf,
+						 GstBuffer        *outbuf);
+
+GType
+gst_player_color_conv_get_type (void)
+{
+  static GType gst_player_color_conv_type = 0;
+
+  if (!gst_player_color_conv_type) {
+    static const GTypeInfo gst_player_color_conv_info = {
+      sizeof (GstPlayerColorConvClass),
+      gst_player_color_conv_base_init,
+      NULL,
+      (GClassInitFunc) gst_player_color_conv_class_init,
+      NULL,
+      NULL,
+      sizeof (GstPlayerColorConv),
+      0,
+      (GInstanceInitFunc) gst_player_color_conv_init,
+      NULL
+    };
+
+    gst_player_color_conv_type =
+	g_type_register_static (GST_TYPE_BASE_TRANSFORM,
+				"GstPlayerColorConv",
+				&gst_player_color_conv_info, 0);
+  }
+
+  return gst_player_color_conv_type;
+}
+
+static void
+gst_player_color_conv_base_init (gpointer klass)
+{
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  static const GstElementDetails details =
+      GST_ELEMENT_DETAILS ("Threaded colorspace converter",
+			   "Filter/Converter/Video",
+			   "Converts YUV to 32 bit RGB on all processors",
+			   "Ronald Bultje <rbultje@ronald.bitfreak.net>");
+
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&sink_template));
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&src_template));
+  gst_element_class_set_details (element_class, &details);
+}
+
+static void
+gst_player_color_conv_class_init (GstPlayerColorConvClass *klass)
+{
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  trans_class->transform_caps = gst_player_color_conv_transform_caps;
+  trans_class->get_unit_size = gst_player_color_conv_get_unit_size;
+  trans_class->set_caps = gst_player_color_conv_set_caps;
+  trans_class->transform = gst_player_color_conv_transform;
+}
+
+static void
+gst_player_color_conv_init (GstPlayerColorConv *conv)
+{
+  conv->width = conv->height = 0;
+}
+
+/*
+ * Makes the element available to gst_element_factory_make() and
+ * pipeline descriptions. Call once after GStreamer is initialized.
+ */
+
+gboolean
+gst_player_color_conv_register (void)
+{
+  return gst_element_register (NULL, GST_PLAYER_COLOR_CONV_NAME,
+			       GST_RANK_NONE, GST_PLAYER_TYPE_COLOR_CONV);
+}
+
+/*
+ * The other side's template, with the size and rate of each of the
+ * given structures.
+ */
+
+static GstCaps *
+gst_player_color_conv_transform_caps (GstBaseTransform *trans,
+				      GstPadDirection   direction,
+				      GstCaps          *caps)
+{
+  GstStaticPadTemplate *other =
+      direction == GST_PAD_SINK ? &src_template : &sink_template;
+  GstCaps *res = gst_caps_new_empty ();
+  guint n, m, f;
+
+  for (n = 0; n < gst_caps_get_size (caps); n++) {
+    GstStructure *from = gst_caps_get_structure (caps, n);
+    GstCaps *to = gst_caps_copy (gst_static_pad_template_get_caps (other));
+
+    for (m = 0; m < gst_caps_get_size (to); m++) {
+      GstStructure *s = gst_caps_get_structure (to, m);
+
+      for (f = 0; shared_fields[f] != NULL; f++) {
+        const GValue *value = gst_structure_get_value (from, shared_fields[f]);
+
+        if (value)
+          gst_structure_set_value (s, shared_fields[f], value);
+      }
+    }
+    gst_caps_append (res, to);
+  }
+
+  return res;
+}
+
+static gboolean
+gst_player_color_conv_get_unit_size (GstBaseTransform *trans,
+				     GstCaps          *caps,
+				     guint            *size)
+{
+  GstStructure *s = gst_caps_get_structure (caps, 0);
+  guint32 fourcc;
+  gint width, height;
+
+  if (!gst_structure_get_int (s, "width", &width) ||
+      !gst_structure_get_int (s, "height", &height))
+    return FALSE;
+
+  if (gst_structure_has_name (s, "video/x-raw-rgb")) {
+    *size = width * height * 4;
+    return TRUE;
+  }
+
+  if (!gst_structure_get_fourcc (s, "format", &fourcc))
+    return FALSE;
+  switch (fourcc) {
+    case GST_MAKE_FOURCC ('I', '4', '2', '0'):
+    case GST_MAKE_FOURCC ('Y', 'V', '1', '2'):
+      *size = GST_ROUND_UP_4 (width) * GST_ROUND_UP_2 (height) +
+	  GST_ROUND_UP_8 (width) / 2 * GST_ROUND_UP_2 (height) / 2 * 2;
+      return TRUE;
+    case GST_MAKE_FOURCC ('N', 'V', '1', '2'):
+      *size = GST_ROUND_UP_4 (width) * GST_ROUND_UP_2 (height) * 3 / 2;
+      return TRUE;
+    case GST_MAKE_FOURCC ('Y', 'U', 'Y', '2'):
+      *size = GST_ROUND_UP_4 (width * 2) * height;
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+/*
+ * Byte of a big endian 32 bit pixel that the mask selects.
+ */
+
+static gint
+mask_offset (GstStructure *s,
+	     const gchar  *field)
+{
+  gint mask;
+
+  if (!gst_structure_get_int (s, field, &mask) || !mask)
+    return -1;
+
+  return 3 - g_bit_nth_lsf ((guint32) mask, -1) / 8;
+}
+
+static gboolean
+gst_player_color_conv_set_caps (GstBaseTransform *trans,
+				GstCaps          *incaps,
+				GstCaps          *outcaps)
+{
+  GstPlayerColorConv *conv = GST_PLAYER_COLOR_CONV (trans);
+  GstStructure *in = gst_caps_get_structure (incaps, 0),
+      *out = gst_caps_get_structure (outcaps, 0);
+  guint32 fourcc;
+  gint height;
+
+  if (!gst_structure_get_fourcc (in, "format", &fourcc) ||
+      !gst_structure_get_int (in, "width", &conv->width) ||
+      !gst_structure_get_int (in, "height", &conv->height))
+    return FALSE;
+  height = GST_ROUND_UP_2 (conv->height);
+
+  conv->y_start = 0;
+  switch (fourcc) {
+    case GST_MAKE_FOURCC ('I', '4', '2', '0'):
+    case GST_MAKE_FOURCC ('Y', 'V', '1', '2'):
+      conv->y_stride = GST_ROUND_UP_4 (conv->width);
+      conv->uv_stride = GST_ROUND_UP_8 (conv->width) / 2;
+      conv->u_start = conv->y_stride * height;
+      conv->v_start = conv->u_start + conv->uv_stride * height / 2;
+      if (fourcc == GST_MAKE_FOURCC ('Y', 'V', '1', '2')) {
+        guint tmp = conv->u_start;
+
+        conv->u_start = conv->v_start;
+        conv->v_start = tmp;
+      }
+      conv->y_step = conv->uv_step = 1;
+      conv->subsampled = TRUE;
+      break;
+    case GST_MAKE_FOURCC ('N', 'V', '1', '2'):
+      conv->y_stride = conv->uv_stride = GST_ROUND_UP_4 (conv->width);
+      conv->u_start = conv->y_stride * height;
+      conv->v_start = conv->u_start + 1;
+      conv->y_step = 1;
+      conv->uv_step = 2;
+      conv->subsampled = TRUE;
+      break;
+    case GST_MAKE_FOURCC ('Y', 'U', 'Y', '2'):
+      conv->y_stride = conv->uv_stride = GST_ROUND_UP_4 (conv->width * 2);
+      conv->u_start = 1;
+      conv->v_start = 3;
+      conv->y_step = 2;
+      conv->uv_step = 4;
+      conv->subsampled = FALSE;
+      break;
+    default:
+      return FALSE;
+  }
+
+  conv->r_off = mask_offset (out, "red_mask");
+  conv->g_off = mask_offset (out, "green_mask");
+  conv->b_off = mask_offset (out, "blue_mask");
+  if (conv->r_off < 0 || conv->g_off < 0 || conv->b_off < 0)
+    return FALSE;
+  conv->x_off = 6 - conv->r_off - conv->g_off - conv->b_off;
+
+  return TRUE;
+}
+
+typedef struct _ConvFrame {
+  GstPlayerColorConv *conv;
+  const guint8 *src;
+  guint8 *dest;
+} ConvFrame;
+
+#define CLIP(v) ((v) < 0 ? 0 : (v) > 255 ? 255 : (v))
+
+/*
+ * ITU-R BT.601 with 8 bits of fraction.
+ */
+
+static void
+convert_lines (gint     first,
+	       gint     last,
+	       gpointer data)
+{
+  ConvFrame *frame = data;
+  GstPlayerColorConv *conv = frame->conv;
+  gint x, y;
+
+  for (y = first; y < last; y++) {
+    gint cy = conv->subsampled ? y / 2 : y;
+    const guint8 *py = frame->src + conv->y_start + y * conv->y_stride,
+        *pu = frame->src + conv->u_start + cy * conv->uv_stride,
+        *pv = frame->src + conv->v_start + cy * conv->uv_stride;
+    guint8 *dest = frame->dest + y * conv->width * 4;
+
+    for (x = 0; x < conv->width; x++) {
+      gint c = 298 * (py[0] - 16) + 128, d = pu[0] - 128, e = pv[0] - 128;
+      gint r = (c + 409 * e) >> 8,
+          g = (c - 100 * d - 208 * e) >> 8,
+          b = (c + 516 * d) >> 8;
+
+      dest[conv->r_off] = CLIP (r);
+      dest[conv->g_off] = CLIP (g);
+      dest[conv->b_off] = CLIP (b);
+      dest[conv->x_off] = 0xff;
+      dest += 4;
+
+      /* chroma is shared by pixel pairs */
+      py += conv->y_step;
+      if (x & 1) {
+        pu += conv->uv_step;
+        pv += conv->uv_step;
+      }
+    }
+  }
+}
+
+static GstFlowReturn
+gst_player_color_conv_transform (GstBaseTransform *trans,
+				 GstBuffer        *inbuf,
+				 GstBuffer        *outbuf)
+{
+  GstPlayerColorConv *conv = GST_PLAYER_COLOR_CONV (trans);
+  ConvFrame frame;
+
+  frame.conv = conv;
+  frame.src = GST_BUFFER_DATA (inbuf);
+  frame.dest = GST_BUFFER_DATA (outbuf);
+  gst_player_slices_run (conv->height, convert_lines, &frame);
+
+  return GST_FLOW_OK;
+}
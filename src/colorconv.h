@@ -0,0 +1,69 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * colorconv.h: slice-threaded YUV to 32 bit RGB converter.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COLORCONV_H__
+#define __COLORCONV_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+
+G_BEGIN_DECLS
+
+#define GST_PLAYER_TYPE_COLOR_CONV \
+  (gst_player_color_conv_get_type ())
+#define GST_PLAYER_COLOR_CONV(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_PLAYER_TYPE_COLOR_CONV, GstPlayerColorConv))
+#define GST_PLAYER_COLOR_CONV_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), GST_PLAYER_TYPE_COLOR_CONV, GstPlayerColorConvClass))
+#define GST_PLAYER_IS_COLOR_CONV(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_PLAYER_TYPE_COLOR_CONV))
+#define GST_PLAYER_IS_COLOR_CONV_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), GST_PLAYER_TYPE_COLOR_CONV))
+
+/* factory name it is registered under */
+#define GST_PLAYER_COLOR_CONV_NAME "aldegondecolorspace"
+
+typedef struct _GstPlayerColorConv {
+  GstBaseTransform parent;
+
+  gint width, height;
+
+  /* where the input planes start and how far apart their lines and
+   * pixel pairs are; packed formats point all three into one plane */
+  guint y_start, u_start, v_start;
+  gint y_stride, uv_stride, y_step, uv_step;
+  gboolean subsampled;
+
+  /* byte position of each component in an output pixel */
+  gint r_off, g_off, b_off, x_off;
+} GstPlayerColorConv;
+
+typedef struct _GstPlayerColorConvClass {
+  GstBaseTransformClass klass;
+} GstPlayerColorConvClass;
+
+GType		gst_player_color_conv_get_type	(void);
+gboolean	gst_player_color_conv_register	(void);
+
+G_END_DECLS
+
+#endif /* __COLORCONV_H__ */
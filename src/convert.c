@@ -0,0 +1,172 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * convert.c: colorspace converter timing. Only the time spent inside
+ * the converter counts, so the test source doesn't skew the result.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "colorconv.h"
+#include "convert.h"
+
+#define CONVERT_TIMEOUT 10
+
+const gchar *gst_player_converters[] = {
+  GST_PLAYER_COLOR_CONV_NAME,
+  "colorspace",
+  "ffmpegcolorspace",
+  NULL
+};
+
+const gchar *gst_player_convert_formats[] = {
+  "I420",
+  "YV12",
+  "NV12",
+  "YUY2",
+  NULL
+};
+
+typedef struct _ConvertTiming {
+  GstClockTime start, total;
+  gint frames;
+} ConvertTiming;
+
+static gboolean
+cb_in (GstPad    *pad,
+       GstBuffer *buf,
+       gpointer   data)
+{
+  ConvertTiming *timing = data;
+
+  timing->start = gst_util_get_timestamp ();
+
+  return TRUE;
+}
+
+static gboolean
+cb_out (GstPad    *pad,
+	GstBuffer *buf,
+	gpointer   data)
+{
+  ConvertTiming *timing = data;
+
+  timing->total += gst_util_get_timestamp () - timing->start;
+  timing->frames++;
+
+  return TRUE;
+}
+
+/*
+ * Frames per second the converter manages from the given YUV format
+ * to 32 bit RGB, or a negative value if it can't do it at all.
+ */
+
+gdouble
+gst_player_convert_rate (const gchar *factory,
+			 const gchar *format,
+			 gint         width,
+			 gint         height,
+			 gint         frames)
+{
+  GstElement *pipeline, *conv;
+  GstBus *bus;
+  GstMessage *msg;
+  GstPad *in, *out;
+  GError *error = NULL;
+  ConvertTiming timing = { 0, 0, 0 };
+  gchar *desc;
+  gboolean res = FALSE;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d ! "
+			  "video/x-raw-yuv,format=(fourcc)%s,"
+			  "width=%d,height=%d,framerate=25/1 ! "
+			  "%s name=conv ! "
+			  "video/x-raw-rgb,bpp=32,depth=24 ! "
+			  "fakesink sync=false",
+			  frames, format, width, height, factory);
+  pipeline = gst_parse_launch (desc, &error);
+  g_free (desc);
+  if (error) {
+    g_error_free (error);
+    if (pipeline)
+      gst_object_unref (GST_OBJECT (pipeline));
+    return -1.;
+  }
+
+  /* everything runs in one streaming thread */
+  conv = gst_bin_get_by_name (GST_BIN (pipeline), "conv");
+  in = gst_element_get_static_pad (conv, "sink");
+  out = gst_element_get_static_pad (conv, "src");
+  gst_pad_add_buffer_probe (in, G_CALLBACK (cb_in), &timing);
+  gst_pad_add_buffer_probe (out, G_CALLBACK (cb_out), &timing);
+
+  bus = gst_element_get_bus (pipeline);
+  if (gst_element_set_state (pipeline,
+			     GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE) {
+    msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR,
+			CONVERT_TIMEOUT * GST_SECOND);
+    if (msg) {
+      res = GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS;
+      gst_message_unref (msg);
+    }
+  }
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  gst_object_unref (GST_OBJECT (in));
+  gst_object_unref (GST_OBJECT (out));
+  gst_object_unref (GST_OBJECT (conv));
+  gst_object_unref (GST_OBJECT (bus));
+  gst_object_unref (GST_OBJECT (pipeline));
+
+  if (!res || timing.frames == 0 || timing.total == 0)
+    return -1.;
+
+  return timing.frames / ((gdouble) timing.total / GST_SECOND);
+}
+
+/*
+ * The fastest converter for I420 at the given size, or NULL if none
+ * works.
+ */
+
+const gchar *
+gst_player_convert_choose (gint width,
+			   gint height)
+{
+  const gchar *best = NULL;
+  gdouble best_fps = 0.;
+  gint n;
+
+  for (n = 0; gst_player_converters[n] != NULL; n++) {
+    gdouble fps;
+
+    fps = gst_player_convert_rate (gst_player_converters[n], "I420",
+				   width, height, 10);
+    g_message ("converter %s: %.01lf fps at %dx%d",
+	       gst_player_converters[n], fps, width, height);
+    if (fps > best_fps) {
+      best = gst_player_converters[n];
+      best_fps = fps;
+    }
+  }
+
+  return best;
+}
@@ -0,0 +1,44 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * convert.h: colorspace converter timing
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CONVERT_H__
+#define __CONVERT_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* NULL-terminated, in order of preference */
+extern const gchar *gst_player_converters[];
+extern const gchar *gst_player_convert_formats[];
+
+gdouble		gst_player_convert_rate		(const gchar *factory,
+						 const gchar *format,
+						 gint         width,
+						 gint         height,
+						 gint         frames);
+const gchar *	gst_player_convert_choose	(gint         width,
+						 gint         height);
+
+G_END_DECLS
+
+#endif /* __CONVERT_H__ */
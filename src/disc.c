@@ -28,7 +28,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
-#include <mntent.h>
+#include <limits.h>
 #include <string.h>
 
 #include <sys/stat.h>
@@ -38,10 +38,11 @@
 #include <glib.h>
 
 #include "disc.h"
+#include "discfs.h"
 
 typedef struct _CdCache {
-  /* device node and mountpoint */
-  gchar *device, *mountpoint;
+  /* device node */
+  gchar *device;
 
   /* file descriptor to the device */
   gint fd;
@@ -49,12 +50,23 @@ typedef struct _CdCache {
   /* capabilities of the device */
   gint cap;
 
-  /* indicates if we mounted this mountpoint ourselves or if it
-   * was already mounted. */
-  gboolean self_mounted;
-  gboolean mounted;
+  /* file system on the disc, read directly rather than mounted */
+  CdFs *fs;
+
+  /* caches are kept per drive, for as long as the same disc is in
+   * there; only one probe at a time uses a cache */
+  GMutex *lock;
+  CdType type;
+  gboolean valid;
+
+  /* probes using or waiting for the cache, under caches_lock */
+  gint users;
 } CdCache;
 
+/* real device node -> CdCache */
+static GStaticMutex caches_lock = G_STATIC_MUTEX_INIT;
+static GHashTable *caches = NULL;
+
 /*
  * So, devices can be symlinks and that screws up.
  */
@@ -99,51 +111,41 @@ cd_cache_new (const gchar *dev,
 	      GError     **error)
 {
   CdCache *cache;
-  FILE *f;
-  gchar *mountpoint = NULL, buf[256], *device;
-  struct mntent mnt;
+  gchar *device;
 
-  /* retrieve mountpoint (/etc/fstab). We could also use HAL for this,
-   * I think (gnome-volume-manager does that). */
   if (!(device = get_device (dev, error)))
     return NULL;
-  if (!(f = setmntent ("/etc/fstab", "r"))) {
-    g_set_error (error, 0, 0,
-        "Opening /etc/fstab failed: %s",
-        g_strerror (errno));
-    return NULL;
-  }
-  while (getmntent_r (f, &mnt, buf, 256)) {
-    gchar *pdev;
-
-    if (!(pdev = get_device (mnt.mnt_fsname, NULL)))
-      continue;
-
-    if (!strcmp (pdev, device)) {
-      mountpoint = g_strdup (mnt.mnt_dir);
-      g_free (pdev);
-      break;
-    }
-    g_free (pdev);
-  }
-  endmntent (f);
-  if (!mountpoint) {
-    g_set_error (error, 0, 0,
-        "Failed to find mountpoint for device %s in /etc/fstab",
-        device);
-    return NULL;
-  }
 
   /* create struture */
   cache = g_new0 (CdCache, 1);
   cache->device = device;
-  cache->mountpoint = mountpoint;
   cache->fd = -1;
-  cache->self_mounted = FALSE;
+  cache->lock = g_mutex_new ();
+  cache->type = CD_TYPE_ERROR;
 
   return cache;
 }
 
+static CdFs *
+cd_cache_open_fs (CdCache *cache,
+		  GError **error)
+{
+  /* already opened? */
+  if (!cache->fs)
+    cache->fs = cd_fs_open_fd (cache->fd, error);
+
+  return cache->fs;
+}
+
+static void
+cd_cache_close_fs (CdCache *cache)
+{
+  if (cache->fs) {
+    cd_fs_free (cache->fs);
+    cache->fs = NULL;
+  }
+}
+
 static gboolean
 cd_cache_open_device (CdCache *cache,
 		      GError **error)
@@ -152,10 +154,11 @@ cd_cache_open_device (CdCache *cache,
 
   /* already open? */
   if (cache->fd > 0)
-    return TRUE;
+    goto status;
 
-  /* try to open the CD before creating anything */
-  if ((cache->fd = open (cache->device, O_RDONLY)) < 0) {
+  /* try to open the CD before creating anything. Non-blocking, so
+   * that the door isn't locked while we keep the device open. */
+  if ((cache->fd = open (cache->device, O_RDONLY | O_NONBLOCK)) < 0) {
     g_set_error (error, 0, 0,
         "Failed to open device %s for reading: %s",
         cache->device, g_strerror (errno));
@@ -172,10 +175,15 @@ cd_cache_open_device (CdCache *cache,
     return FALSE;
   }
 
+  /* changes from before we looked don't matter */
+  ioctl (cache->fd, CDROM_MEDIA_CHANGED, CDSL_CURRENT);
+
+status:
   /* is there a disc in the tray? */
   if ((drive = ioctl (cache->fd, CDROM_DRIVE_STATUS, NULL)) != CDS_DISC_OK) {
     const gchar *drive_s;
 
+    cd_cache_close_fs (cache);
     close (cache->fd);
     cache->fd = -1;
 
@@ -208,71 +216,10 @@ cd_cache_open_device (CdCache *cache,
   return TRUE;
 }
 
-static GDir *
-cd_cache_open_mountpoint (CdCache *cache,
-			  GError **error)
-{
-  FILE *f;
-  gchar buf[256];
-  struct mntent mnt;
-
-  /* already opened? */
-  if (cache->mounted)
-    goto opendir;
-
-  /* check for mounting - assume we'll mount ourselves */
-  if (!(f = setmntent ("/etc/mtab", "r"))) {
-    g_set_error (error, 0, 0,
-        "Opening /etc/mtab failed: %s",
-        g_strerror (errno));
-    return NULL;
-  }
-  cache->self_mounted = TRUE;
-  while (getmntent_r (f, &mnt, buf, 256)) {
-    if (!strcmp (mnt.mnt_dir, cache->mountpoint)) {
-      cache->self_mounted = FALSE;
-      break;
-    }
-  }
-  endmntent (f);
-
-  /* mount if we have to */
-  if (cache->self_mounted) {
-    gchar *command;
-    gint status;
-
-    command = g_strdup_printf ("mount %s", cache->mountpoint);
-    if (!g_spawn_command_line_sync (command,
-             NULL, NULL, &status, error)) {
-      g_free (command);
-      return NULL;
-    }
-    g_free (command);
-    if (status != 0) {
-      g_set_error (error, 0, 0,
-          "Unexpected error status %d while mounting %s",
-          status, cache->mountpoint);
-      return NULL;
-    }
-  }
-
-  cache->mounted = TRUE;
-
-opendir:
-  return g_dir_open (cache->mountpoint, 0, error);
-}
-
 static void
 cd_cache_free (CdCache *cache)
 {
-  /* umount if we mounted */
-  if (cache->self_mounted && cache->mounted) {
-    gchar *command;
-
-    command = g_strdup_printf ("umount %s", cache->mountpoint);
-    g_spawn_command_line_sync (command, NULL, NULL, NULL, NULL);
-    g_free (command);
-  }
+  cd_cache_close_fs (cache);
 
   /* close file descriptor to device */
   if (cache->fd > 0) {
@@ -280,7 +227,7 @@ cd_cache_free (CdCache *cache)
   }
 
   /* free mem */
-  g_free (cache->mountpoint);
+  g_mutex_free (cache->lock);
   g_free (cache->device);
   g_free (cache);
 }
@@ -341,78 +288,403 @@ static CdType
 cd_cache_disc_is_vcd (CdCache *cache,
                       GError **error)
 {
-  GDir *dir;
-  CdType type = CD_TYPE_DATA;
+  CdFs *fs;
+  CdType type;
 
-  /* open disc and open mount */
+  /* open disc and its file system */
   if (!cd_cache_open_device (cache, error) ||
-      !(dir = cd_cache_open_mountpoint (cache, error)))
+      !(fs = cd_cache_open_fs (cache, error)))
     return CD_TYPE_ERROR;
 
-  //..
-
-  g_dir_close (dir);
+  type = cd_fs_detect (fs);
 
-  return type;
+  return (type == CD_TYPE_VCD || type == CD_TYPE_SVCD) ?
+      type : CD_TYPE_DATA;
 }
 
 static CdType
 cd_cache_disc_is_dvd (CdCache *cache,
 		      GError **error)
 {
-  GDir *dir;
-  const gchar *name;
-  gboolean have_vts = FALSE, have_vtsifo = FALSE, have_ats = FALSE;
+  CdFs *fs;
 
-  /* open disc, check capabilities and open mount */
+  /* open disc, check capabilities and open file system */
   if (!cd_cache_open_device (cache, error))
     return CD_TYPE_ERROR;
   if (!(cache->cap & CDC_DVD))
     return CD_TYPE_DATA;
-  if (!(dir = cd_cache_open_mountpoint (cache, error)))
+  if (!(fs = cd_cache_open_fs (cache, error)))
     return CD_TYPE_ERROR;
 
-  /* check directory structure */
-  while ((name = g_dir_read_name (dir)) != NULL) {
-    if (!strcmp (name, "VIDEO_TS")) {
-      GDir *subdir;
-      gchar *subdirname = g_build_path (G_DIR_SEPARATOR_S,
-                               cache->mountpoint, name, NULL);
-
-      have_vts = TRUE;
-      if (!(subdir = g_dir_open (subdirname, 0, error)))
-        return CD_TYPE_ERROR;
-      while ((name = g_dir_read_name (subdir)) != NULL) {
-        if (!strcmp (name, "VIDEO_TS.IFO"))
-          have_vtsifo = TRUE;
+  return cd_fs_detect (fs) == CD_TYPE_DVD ? CD_TYPE_DVD : CD_TYPE_DATA;
+}
+
+/*
+ * Device nodes of all CD/DVD drives, e.g. "/dev/sr0", first drive
+ * first. Free the strings and the list when done.
+ */
+
+GList *
+cd_drive_list (void)
+{
+  GList *drives = NULL;
+  gchar *contents, **lines, **names, *path, *type;
+  const gchar *name;
+  GDir *dir;
+  gint n, m;
+
+  /* the cdrom driver knows all of them... */
+  if (g_file_get_contents ("/proc/sys/dev/cdrom/info", &contents,
+			   NULL, NULL)) {
+    lines = g_strsplit (contents, "\n", -1);
+    for (n = 0; lines[n] != NULL; n++) {
+      if (!g_str_has_prefix (lines[n], "drive name:"))
+        continue;
+
+      /* latest drive first */
+      names = g_strsplit_set (lines[n] + strlen ("drive name:"), " \t", -1);
+      for (m = 0; names[m] != NULL; m++) {
+        if (*names[m])
+          drives = g_list_prepend (drives,
+                                   g_strdup_printf ("/dev/%s", names[m]));
+      }
+      g_strfreev (names);
+    }
+    g_strfreev (lines);
+    g_free (contents);
+  }
+
+  /* ...if it's loaded; otherwise, look for SCSI type 5 (CD-ROM) */
+  if (!drives && (dir = g_dir_open ("/sys/block", 0, NULL))) {
+    while ((name = g_dir_read_name (dir)) != NULL) {
+      path = g_build_filename ("/sys/block", name, "device", "type", NULL);
+      if (g_file_get_contents (path, &type, NULL, NULL)) {
+        if (atoi (type) == 5)
+          drives = g_list_insert_sorted (drives,
+              g_strdup_printf ("/dev/%s", name), (GCompareFunc) strcmp);
+        g_free (type);
       }
-      g_dir_close (subdir);
-      g_free (subdirname);
-    } else if (!strcmp (name, "AUDIO_TS")) {
-      have_ats = TRUE;
+      g_free (path);
     }
+    g_dir_close (dir);
   }
-  g_dir_close (dir);
 
-  return (have_vts && have_ats && have_vtsifo) ?
-      CD_TYPE_DVD : CD_TYPE_DATA;
+  if (!drives)
+    drives = g_list_append (drives, g_strdup ("/dev/cdrom"));
+
+  return drives;
 }
 
-CdType
-cd_detect_type (const gchar *device,
-		GError     **error)
+/*
+ * The cache of a drive, locked. Created on first use. Give it back
+ * with cd_cache_put().
+ */
+
+static CdCache *
+cd_cache_get (const gchar *dev,
+	      GError     **error)
 {
   CdCache *cache;
-  CdType type;
+  gchar *device;
+
+  if (!(device = get_device (dev, error)))
+    return NULL;
+
+  g_static_mutex_lock (&caches_lock);
+  if (!caches)
+    caches = g_hash_table_new (g_str_hash, g_str_equal);
+  if (!(cache = g_hash_table_lookup (caches, device)) &&
+      (cache = cd_cache_new (device, error)))
+    g_hash_table_insert (caches, cache->device, cache);
+
+  /* keeps cd_detect_shutdown() from freeing it before we have it */
+  if (cache)
+    cache->users++;
+  g_static_mutex_unlock (&caches_lock);
+  g_free (device);
+
+  if (cache)
+    g_mutex_lock (cache->lock);
+
+  return cache;
+}
+
+static void
+cd_cache_put (CdCache *cache)
+{
+  g_mutex_unlock (cache->lock);
+
+  g_static_mutex_lock (&caches_lock);
+  cache->users--;
+  g_static_mutex_unlock (&caches_lock);
+}
+
+/*
+ * Whether the last detection still holds: the same disc is still in
+ * the drive. If not, everything learned about the old one is dropped.
+ */
 
-  if (!(cache = cd_cache_new (device, error)))
+static gboolean
+cd_cache_is_current (CdCache *cache)
+{
+  if (cache->valid && cache->fd > 0 &&
+      ioctl (cache->fd, CDROM_DRIVE_STATUS, CDSL_CURRENT) == CDS_DISC_OK &&
+      ioctl (cache->fd, CDROM_MEDIA_CHANGED, CDSL_CURRENT) == 0)
+    return TRUE;
+
+  cache->valid = FALSE;
+  cd_cache_close_fs (cache);
+
+  /* clear the media changed flag, so it tells about later changes */
+  if (cache->fd > 0)
+    ioctl (cache->fd, CDROM_MEDIA_CHANGED, CDSL_CURRENT);
+
+  return FALSE;
+}
+
+/*
+ * Closes the drives. Call this on exit.
+ */
+
+void
+cd_detect_shutdown (void)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  g_static_mutex_lock (&caches_lock);
+  if (caches) {
+    g_hash_table_iter_init (&iter, caches);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+      CdCache *cache = value;
+
+      /* a probe stuck in the drive keeps its cache */
+      if (cache->users > 0)
+        continue;
+      g_hash_table_iter_remove (&iter);
+      cd_cache_free (cache);
+    }
+  }
+  g_static_mutex_unlock (&caches_lock);
+}
+
+/*
+ * Asynchronous detection. The probe runs in a thread of its own, since
+ * drives can take seconds to spin up.
+ * Progress and the result are passed on from the main loop.
+ */
+
+static gboolean
+cb_detect_progress (gpointer data)
+{
+  CdDetect *detect = data;
+  gchar *message;
+  gdouble fraction;
+  gboolean cancelled;
+
+  g_mutex_lock (detect->lock);
+  detect->progress_id = 0;
+  message = detect->message;
+  detect->message = NULL;
+  fraction = detect->fraction;
+  cancelled = detect->cancelled;
+  g_mutex_unlock (detect->lock);
+
+  if (!cancelled && detect->progress)
+    detect->progress (message, fraction, detect->data);
+  g_free (message);
+
+  return FALSE;
+}
+
+static gboolean
+cb_detect_done (gpointer data)
+{
+  CdDetect *detect = data;
+
+  g_mutex_lock (detect->lock);
+  if (detect->progress_id != 0)
+    g_source_remove (detect->progress_id);
+  g_mutex_unlock (detect->lock);
+
+  if (!detect->cancelled)
+    detect->done (detect->type, cd_type_get_uri (detect->type),
+		  detect->error, detect->data);
+
+  if (detect->error)
+    g_error_free (detect->error);
+  g_mutex_free (detect->lock);
+  g_free (detect->message);
+  g_free (detect->device);
+  g_free (detect);
+
+  return FALSE;
+}
+
+/*
+ * Reports what's being done next. Returns FALSE if the detection was
+ * cancelled meanwhile.
+ */
+
+static gboolean
+detect_step (CdDetect    *detect,
+	     const gchar *message,
+	     gdouble      fraction,
+	     GError     **error)
+{
+  gboolean cancelled;
+
+  if (!detect)
+    return TRUE;
+
+  g_mutex_lock (detect->lock);
+  if (!(cancelled = detect->cancelled)) {
+    g_free (detect->message);
+    detect->message = g_strdup (message);
+    detect->fraction = fraction;
+    if (detect->progress_id == 0)
+      detect->progress_id = g_idle_add (cb_detect_progress, detect);
+  }
+  g_mutex_unlock (detect->lock);
+
+  if (cancelled)
+    g_set_error (error, 0, 0, "Detection cancelled");
+
+  return !cancelled;
+}
+
+static CdType
+detect_run (const gchar *device,
+	    CdDetect    *detect,
+	    GError     **error)
+{
+  CdCache *cache;
+  CdType type = CD_TYPE_ERROR;
+  struct stat st;
+
+  if (!detect_step (detect, "Opening drive", 0., error))
     return CD_TYPE_ERROR;
-  if ((type = cd_cache_disc_is_cdda (cache, error)) == CD_TYPE_DATA &&
+
+  /* disc images are looked into directly */
+  if (stat (device, &st) == 0 && S_ISREG (st.st_mode)) {
+    CdFs *fs;
+
+    if (!(fs = cd_fs_open (device, error)))
+      return CD_TYPE_ERROR;
+    type = cd_fs_detect (fs);
+    cd_fs_free (fs);
+
+    return type;
+  }
+
+  if (!(cache = cd_cache_get (device, error)))
+    return CD_TYPE_ERROR;
+
+  /* same disc as last time? */
+  if (cd_cache_is_current (cache)) {
+    type = cache->type;
+    cd_cache_put (cache);
+    return type;
+  }
+
+  if (detect_step (detect, "Checking for audio CD", .25, error) &&
+      (type = cd_cache_disc_is_cdda (cache, error)) == CD_TYPE_DATA &&
+      detect_step (detect, "Checking for video CD", .5, error) &&
       (type = cd_cache_disc_is_vcd (cache, error)) == CD_TYPE_DATA &&
+      detect_step (detect, "Checking for DVD", .75, error) &&
       (type = cd_cache_disc_is_dvd (cache, error)) == CD_TYPE_DATA) {
     /* crap, nothing found */
   }
-  cd_cache_free (cache);
+
+  /* cancelled in between */
+  if (error && *error && type != CD_TYPE_ERROR)
+    type = CD_TYPE_ERROR;
+
+  cache->type = type;
+  cache->valid = (type != CD_TYPE_ERROR);
+  cd_cache_put (cache);
 
   return type;
 }
+
+CdType
+cd_detect_type (const gchar *device,
+		GError     **error)
+{
+  return detect_run (device, NULL, error);
+}
+
+/*
+ * What to play for a disc of the given type, or NULL for data discs.
+ */
+
+const gchar *
+cd_type_get_uri (CdType type)
+{
+  switch (type) {
+    case CD_TYPE_CDDA:
+      return "cdda://";
+    case CD_TYPE_VCD:
+    case CD_TYPE_SVCD:
+      return "vcd://";
+    case CD_TYPE_DVD:
+      return "dvd://";
+    default:
+      return NULL;
+  }
+}
+
+static gpointer
+detect_thread (gpointer data)
+{
+  CdDetect *detect = data;
+
+  detect->type = detect_run (detect->device, detect, &detect->error);
+  g_idle_add (cb_detect_done, detect);
+
+  return NULL;
+}
+
+/*
+ * Detects the type of disc in device without blocking. progress (may
+ * be NULL) and done are called from the main loop; done is called
+ * exactly once, unless the detection is cancelled.
+ */
+
+CdDetect *
+cd_detect_type_async (const gchar         *device,
+		      CdDetectProgressFunc progress,
+		      CdDetectDoneFunc     done,
+		      gpointer             data)
+{
+  CdDetect *detect;
+
+  g_return_val_if_fail (done != NULL, NULL);
+
+  detect = g_new0 (CdDetect, 1);
+  detect->device = g_strdup (device);
+  detect->lock = g_mutex_new ();
+  detect->type = CD_TYPE_ERROR;
+  detect->progress = progress;
+  detect->done = done;
+  detect->data = data;
+
+  if (!g_thread_create (detect_thread, detect, FALSE, &detect->error))
+    g_idle_add (cb_detect_done, detect);
+
+  return detect;
+}
+
+/*
+ * Neither progress nor done will be called anymore. A probe that's
+ * stuck in the drive still finishes in the background; detect must
+ * not be used after this.
+ */
+
+void
+cd_detect_cancel (CdDetect *detect)
+{
+  g_mutex_lock (detect->lock);
+  detect->cancelled = TRUE;
+  g_mutex_unlock (detect->lock);
+}
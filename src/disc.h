@@ -31,11 +31,53 @@ typedef enum {
   CD_TYPE_DATA = 1,
   CD_TYPE_CDDA,
   CD_TYPE_VCD,
+  CD_TYPE_SVCD,
   CD_TYPE_DVD
 } CdType;
 
+typedef void (* CdDetectProgressFunc)	(const gchar *message,
+					 gdouble      fraction,
+					 gpointer     data);
+typedef void (* CdDetectDoneFunc)	(CdType       type,
+					 const gchar *uri,
+					 GError      *error,
+					 gpointer     data);
+
+typedef struct _CdDetect {
+  gchar *device;
+
+  GMutex *lock;
+  gboolean cancelled;
+
+  /* latest progress, not reported yet */
+  gchar *message;
+  gdouble fraction;
+  guint progress_id;
+
+  /* result */
+  CdType type;
+  GError *error;
+
+  CdDetectProgressFunc progress;
+  CdDetectDoneFunc done;
+  gpointer data;
+} CdDetect;
+
 CdType	cd_detect_type	(const gchar *device,
 			 GError     **error);
+const gchar *
+	cd_type_get_uri	(CdType       type);
+
+CdDetect *
+	cd_detect_type_async (const gchar *device,
+			 CdDetectProgressFunc progress,
+			 CdDetectDoneFunc done,
+			 gpointer     data);
+void	cd_detect_cancel (CdDetect   *detect);
+
+void	cd_detect_shutdown (void);
+
+GList *	cd_drive_list	(void);
 
 G_END_DECLS
 
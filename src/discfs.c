@@ -0,0 +1,563 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * discfs.c: read-only ISO9660/UDF access. Just enough to look up a
+ * few files on a disc, or in an image of one, by reading sectors
+ * directly, so that the disc doesn't have to be mounted to find out
+ * what's on it. UDF is preferred if both are present, as on most
+ * DVDs.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "discfs.h"
+
+#define SECTOR_SIZE 2048
+
+/* volume descriptors start here, on both */
+#define VRS_SECTOR 16
+#define UDF_ANCHOR_SECTOR 256
+
+/* sanity limits for damaged or hostile discs */
+#define MAX_DESCRIPTORS 64
+#define MAX_DIR_SIZE (256 * 1024)
+
+/* UDF descriptor tags */
+#define UDF_TAG_ANCHOR 2
+#define UDF_TAG_PARTITION 5
+#define UDF_TAG_LOGICAL_VOLUME 6
+#define UDF_TAG_TERMINATING 8
+#define UDF_TAG_FILE_SET 256
+#define UDF_TAG_FILE_ID 257
+#define UDF_TAG_FILE_ENTRY 261
+#define UDF_TAG_EXT_FILE_ENTRY 266
+
+typedef struct _CdFsEntry {
+  gboolean is_dir;
+
+  /* ISO9660: first sector and size of the data; UDF: sector of the
+   * file entry, size unknown until that's read */
+  guint32 sector;
+  guint32 size;
+} CdFsEntry;
+
+#define LE16(p) ((guint16) ((p)[0] | ((p)[1] << 8)))
+#define LE32(p) ((guint32) ((p)[0] | ((p)[1] << 8) | \
+			    ((p)[2] << 16) | ((guint32) (p)[3] << 24)))
+#define LE64(p) (LE32 (p) | ((guint64) LE32 ((p) + 4) << 32))
+
+static gboolean
+read_sector (CdFs    *fs,
+	     guint32  sector,
+	     guint8  *buf)
+{
+  gssize res;
+
+  do {
+    res = pread (fs->fd, buf, SECTOR_SIZE, (off_t) sector * SECTOR_SIZE);
+  } while (res < 0 && errno == EINTR);
+
+  return res == SECTOR_SIZE;
+}
+
+/*
+ * ISO9660.
+ */
+
+static gboolean
+iso_open (CdFs *fs)
+{
+  guint8 buf[SECTOR_SIZE];
+  gint n;
+
+  for (n = 0; n < MAX_DESCRIPTORS; n++) {
+    if (!read_sector (fs, VRS_SECTOR + n, buf) ||
+        memcmp (buf + 1, "CD001", 5) != 0)
+      return FALSE;
+
+    switch (buf[0]) {
+      case 1:
+        /* primary volume descriptor, with the root directory record */
+        fs->iso_root = LE32 (buf + 156 + 2);
+        fs->iso_root_size = LE32 (buf + 156 + 10);
+        return TRUE;
+      case 255:
+        return FALSE;
+      default:
+        break;
+    }
+  }
+
+  return FALSE;
+}
+
+static gboolean
+iso_name_equal (const guint8 *id,
+		guint         len,
+		const gchar  *name)
+{
+  gchar buf[256];
+
+  memcpy (buf, id, len);
+  buf[len] = '\0';
+
+  /* "NAME.EXT;1", "NAME.;1" */
+  if (strchr (buf, ';'))
+    *strchr (buf, ';') = '\0';
+  if ((len = strlen (buf)) > 0 && buf[len - 1] == '.')
+    buf[len - 1] = '\0';
+
+  return !g_ascii_strcasecmp (buf, name);
+}
+
+static gboolean
+iso_lookup (CdFs            *fs,
+	    const CdFsEntry *dir,
+	    const gchar     *name,
+	    CdFsEntry       *entry)
+{
+  guint8 buf[SECTOR_SIZE];
+  guint32 n, pos, len;
+
+  for (n = 0; n * SECTOR_SIZE < MIN (dir->size, MAX_DIR_SIZE); n++) {
+    if (!read_sector (fs, dir->sector + n, buf))
+      return FALSE;
+
+    /* records don't cross sectors, zeroes pad the rest */
+    for (pos = 0; pos + 33 <= SECTOR_SIZE; pos += len) {
+      if ((len = buf[pos]) < 33 || pos + len > SECTOR_SIZE ||
+          33 + buf[pos + 32] > len)
+        break;
+
+      if (iso_name_equal (buf + pos + 33, buf[pos + 32], name)) {
+        entry->sector = LE32 (buf + pos + 2);
+        entry->size = LE32 (buf + pos + 10);
+        entry->is_dir = (buf[pos + 25] & 0x02) != 0;
+        return TRUE;
+      }
+    }
+  }
+
+  return FALSE;
+}
+
+static gssize
+iso_read (CdFs            *fs,
+	  const CdFsEntry *file,
+	  guint8          *buf,
+	  gsize            len)
+{
+  guint8 sector[SECTOR_SIZE];
+  gsize done = 0, chunk;
+  guint32 n;
+
+  len = MIN (len, file->size);
+  for (n = 0; done < len; n++) {
+    if (!read_sector (fs, file->sector + n, sector))
+      return -1;
+    chunk = MIN (len - done, SECTOR_SIZE);
+    memcpy (buf + done, sector, chunk);
+    done += chunk;
+  }
+
+  return done;
+}
+
+/*
+ * UDF. Only a single partition and plain (non-virtual, non-sparable)
+ * partition maps, which is what DVD-Video uses.
+ */
+
+static gint
+udf_tag (const guint8 *buf)
+{
+  guint8 sum = 0;
+  gint n;
+
+  for (n = 0; n < 16; n++) {
+    if (n != 4)
+      sum += buf[n];
+  }
+  if (sum != buf[4])
+    return -1;
+
+  return LE16 (buf);
+}
+
+static gboolean
+udf_open (CdFs *fs)
+{
+  guint8 buf[SECTOR_SIZE];
+  guint32 vds, vds_len, fsd = 0, n;
+  gboolean have_partition = FALSE, have_fsd = FALSE;
+
+  if (!read_sector (fs, UDF_ANCHOR_SECTOR, buf) ||
+      udf_tag (buf) != UDF_TAG_ANCHOR)
+    return FALSE;
+
+  /* main volume descriptor sequence */
+  vds_len = LE32 (buf + 16) / SECTOR_SIZE;
+  vds = LE32 (buf + 20);
+  for (n = 0; n < MIN (vds_len, MAX_DESCRIPTORS); n++) {
+    if (!read_sector (fs, vds + n, buf))
+      return FALSE;
+
+    switch (udf_tag (buf)) {
+      case UDF_TAG_PARTITION:
+        fs->udf_partition = LE32 (buf + 188);
+        have_partition = TRUE;
+        break;
+      case UDF_TAG_LOGICAL_VOLUME:
+        fsd = LE32 (buf + 248 + 4);
+        have_fsd = TRUE;
+        break;
+      default:
+        break;
+    }
+    if (udf_tag (buf) == UDF_TAG_TERMINATING)
+      break;
+  }
+  if (!have_partition || !have_fsd)
+    return FALSE;
+
+  /* file set descriptor, with the root directory */
+  if (!read_sector (fs, fs->udf_partition + fsd, buf) ||
+      udf_tag (buf) != UDF_TAG_FILE_SET)
+    return FALSE;
+  fs->udf_root = fs->udf_partition + LE32 (buf + 400 + 4);
+
+  return TRUE;
+}
+
+/*
+ * Contents of the file with the file entry at sector, up to len
+ * bytes.
+ */
+
+static gssize
+udf_read (CdFs    *fs,
+	  guint32  sector,
+	  guint8  *buf,
+	  gsize    len)
+{
+  guint8 fe[SECTOR_SIZE], data[SECTOR_SIZE];
+  guint32 l_ea, l_ad, ad, ad_len, ext_len, ext_pos, n;
+  gsize done = 0, chunk;
+
+  if (!read_sector (fs, sector, fe))
+    return -1;
+
+  switch (udf_tag (fe)) {
+    case UDF_TAG_FILE_ENTRY:
+      l_ea = LE32 (fe + 168);
+      l_ad = LE32 (fe + 172);
+      ad = 176;
+      break;
+    case UDF_TAG_EXT_FILE_ENTRY:
+      l_ea = LE32 (fe + 208);
+      l_ad = LE32 (fe + 212);
+      ad = 216;
+      break;
+    default:
+      return -1;
+  }
+  if (l_ea > SECTOR_SIZE || l_ad > SECTOR_SIZE ||
+      ad + l_ea + l_ad > SECTOR_SIZE)
+    return -1;
+  ad += l_ea;
+  len = MIN (len, LE64 (fe + 56));
+
+  /* allocation descriptor type, from the ICB tag flags */
+  switch (LE16 (fe + 16 + 18) & 0x07) {
+    case 0:
+      ad_len = 8;
+      break;
+    case 1:
+      ad_len = 16;
+      break;
+    case 3:
+      /* data embedded in the file entry */
+      len = MIN (len, l_ad);
+      memcpy (buf, fe + ad, len);
+      return len;
+    default:
+      return -1;
+  }
+
+  for ( ; l_ad >= ad_len && done < len; ad += ad_len, l_ad -= ad_len) {
+    ext_len = LE32 (fe + ad) & 0x3fffffff;
+    ext_pos = LE32 (fe + ad + 4);
+    if (ext_len == 0)
+      break;
+
+    for (n = 0; n * SECTOR_SIZE < ext_len && done < len; n++) {
+      if (!read_sector (fs, fs->udf_partition + ext_pos + n, data))
+        return -1;
+      chunk = MIN (MIN (len - done, SECTOR_SIZE), ext_len - n * SECTOR_SIZE);
+      memcpy (buf + done, data, chunk);
+      done += chunk;
+    }
+  }
+
+  return done;
+}
+
+static gboolean
+udf_name_equal (const guint8 *id,
+		guint         len,
+		const gchar  *name)
+{
+  gchar buf[256];
+  guint n, out = 0;
+
+  /* compressed unicode: 8 or 16 bits per character */
+  if (len == 0)
+    return FALSE;
+  if (id[0] == 8) {
+    for (n = 1; n < len; n++)
+      buf[out++] = id[n];
+  } else if (id[0] == 16) {
+    for (n = 1; n + 1 < len; n += 2) {
+      if (id[n] != 0)
+        return FALSE;
+      buf[out++] = id[n + 1];
+    }
+  } else {
+    return FALSE;
+  }
+  buf[out] = '\0';
+
+  return !g_ascii_strcasecmp (buf, name);
+}
+
+static gboolean
+udf_lookup (CdFs            *fs,
+	    const CdFsEntry *dir,
+	    const gchar     *name,
+	    CdFsEntry       *entry)
+{
+  guint8 *data = g_malloc (MAX_DIR_SIZE);
+  gssize len;
+  guint pos, l_fi, l_iu;
+  gboolean found = FALSE;
+
+  if ((len = udf_read (fs, dir->sector, data, MAX_DIR_SIZE)) < 0) {
+    g_free (data);
+    return FALSE;
+  }
+
+  /* file identifier descriptors, padded to four bytes */
+  for (pos = 0; pos + 38 <= len; pos += (38 + l_iu + l_fi + 3) & ~3) {
+    const guint8 *fid = data + pos;
+
+    if (udf_tag (fid) != UDF_TAG_FILE_ID)
+      break;
+    l_fi = fid[19];
+    l_iu = LE16 (fid + 36);
+    if (pos + 38 + l_iu + l_fi > len)
+      break;
+
+    /* skip deleted files and the parent directory */
+    if (fid[18] & 0x0c)
+      continue;
+
+    if (udf_name_equal (fid + 38 + l_iu, l_fi, name)) {
+      entry->is_dir = (fid[18] & 0x02) != 0;
+      entry->sector = fs->udf_partition + LE32 (fid + 20 + 4);
+      entry->size = 0;
+      found = TRUE;
+      break;
+    }
+  }
+  g_free (data);
+
+  return found;
+}
+
+/*
+ * Files.
+ */
+
+static gboolean
+cd_fs_lookup (CdFs        *fs,
+	      const gchar *path,
+	      CdFsEntry   *entry)
+{
+  gchar **parts = g_strsplit (path, "/", -1);
+  gboolean res = TRUE;
+  gint n;
+
+  entry->is_dir = TRUE;
+  if (fs->udf_root) {
+    entry->sector = fs->udf_root;
+    entry->size = 0;
+  } else {
+    entry->sector = fs->iso_root;
+    entry->size = fs->iso_root_size;
+  }
+
+  for (n = 0; res && parts[n] != NULL; n++) {
+    CdFsEntry dir = *entry;
+
+    if (!*parts[n])
+      continue;
+    if (!dir.is_dir)
+      res = FALSE;
+    else if (fs->udf_root)
+      res = udf_lookup (fs, &dir, parts[n], entry);
+    else
+      res = iso_lookup (fs, &dir, parts[n], entry);
+  }
+  g_strfreev (parts);
+
+  return res;
+}
+
+/*
+ * Whether path ("DIR/FILE.EXT", case doesn't matter) exists.
+ */
+
+gboolean
+cd_fs_exists (CdFs        *fs,
+	      const gchar *path,
+	      gboolean    *is_dir)
+{
+  CdFsEntry entry;
+
+  if (!cd_fs_lookup (fs, path, &entry))
+    return FALSE;
+  if (is_dir)
+    *is_dir = entry.is_dir;
+
+  return TRUE;
+}
+
+/*
+ * Reads the first len bytes of the file at path. Returns the number
+ * of bytes read, or -1.
+ */
+
+gssize
+cd_fs_read (CdFs        *fs,
+	    const gchar *path,
+	    guint8      *buf,
+	    gsize        len)
+{
+  CdFsEntry entry;
+
+  if (!cd_fs_lookup (fs, path, &entry) || entry.is_dir)
+    return -1;
+
+  if (fs->udf_root)
+    return udf_read (fs, entry.sector, buf, len);
+
+  return iso_read (fs, &entry, buf, len);
+}
+
+/*
+ * DVD, (S)VCD or just data, from the files every such disc has.
+ */
+
+CdType
+cd_fs_detect (CdFs *fs)
+{
+  guint8 id[8];
+  gboolean is_dir;
+
+  if (cd_fs_exists (fs, "VIDEO_TS/VIDEO_TS.IFO", &is_dir) && !is_dir)
+    return CD_TYPE_DVD;
+
+  if (cd_fs_read (fs, "VCD/INFO.VCD", id, sizeof (id)) == sizeof (id) ||
+      cd_fs_read (fs, "SVCD/INFO.SVD", id, sizeof (id)) == sizeof (id)) {
+    if (!memcmp (id, "VIDEO_CD", 8))
+      return CD_TYPE_VCD;
+    if (!memcmp (id, "SUPERVCD", 8) || !memcmp (id, "HQ-VCD  ", 8))
+      return CD_TYPE_SVCD;
+  }
+
+  return CD_TYPE_DATA;
+}
+
+/*
+ * Opening. fd may be a CD/DVD device or an image file; it's not
+ * closed by cd_fs_free().
+ */
+
+CdFs *
+cd_fs_open_fd (gint     fd,
+	       GError **error)
+{
+  CdFs *fs = g_new0 (CdFs, 1);
+
+  fs->fd = fd;
+
+  /* both are tried, a DVD might be UDF-only */
+  if (!udf_open (fs))
+    fs->udf_root = 0;
+  if (!iso_open (fs))
+    fs->iso_root = 0;
+
+  if (!fs->udf_root && !fs->iso_root) {
+    g_set_error (error, 0, 0,
+        "No ISO9660 or UDF file system found");
+    g_free (fs);
+    return NULL;
+  }
+
+  return fs;
+}
+
+CdFs *
+cd_fs_open (const gchar *path,
+	    GError     **error)
+{
+  CdFs *fs;
+  gint fd;
+
+  if ((fd = open (path, O_RDONLY)) < 0) {
+    g_set_error (error, 0, 0,
+        "Failed to open %s for reading: %s",
+        path, g_strerror (errno));
+    return NULL;
+  }
+
+  if (!(fs = cd_fs_open_fd (fd, error))) {
+    close (fd);
+    return NULL;
+  }
+  fs->own_fd = TRUE;
+
+  return fs;
+}
+
+void
+cd_fs_free (CdFs *fs)
+{
+  if (fs->own_fd)
+    close (fs->fd);
+  g_free (fs);
+}
@@ -0,0 +1,61 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * discfs.h: read-only ISO9660/UDF access
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __DISCFS_H__
+#define __DISCFS_H__
+
+#include <glib.h>
+
+#include "disc.h"
+
+G_BEGIN_DECLS
+
+typedef struct _CdFs {
+  gint fd;
+  gboolean own_fd;
+
+  /* UDF partition start and root directory file entry, in sectors;
+   * zero if there's no UDF file system */
+  guint32 udf_partition, udf_root;
+
+  /* ISO9660 root directory; zero if there's none */
+  guint32 iso_root, iso_root_size;
+} CdFs;
+
+CdFs *		cd_fs_open		(const gchar *path,
+					 GError     **error);
+CdFs *		cd_fs_open_fd		(gint         fd,
+					 GError     **error);
+void		cd_fs_free		(CdFs        *fs);
+
+gboolean	cd_fs_exists		(CdFs        *fs,
+					 const gchar *path,
+					 gboolean    *is_dir);
+gssize		cd_fs_read		(CdFs        *fs,
+					 const gchar *path,
+					 guint8      *buf,
+					 gsize        len);
+
+CdType		cd_fs_detect		(CdFs        *fs);
+
+G_END_DECLS
+
+#endif /* __DISCFS_H__ */
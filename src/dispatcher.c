@@ -0,0 +1,224 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * dispatcher.c: bus message dispatching. There is one bus watch per
+ * pipeline; components subscribe to the message types (and message
+ * sources) they care about.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dispatcher.h"
+
+typedef struct _GstPlayerSubscription {
+  guint id;
+  GstMessageType types;
+  GstObject *src;
+  GstPlayerDispatchFunc func;
+  gpointer data;
+} GstPlayerSubscription;
+
+/*
+ * State changes of one object that follow each other in the same
+ * direction (e.g. READY->PAUSED->PLAYING) are merged into one, so that
+ * subscribers only see where it ended up. Changes that turn around are
+ * kept apart, since those mean something (e.g. new media).
+ */
+
+static GstMessage *
+merge_state_changes (GstMessage *first,
+		     GstMessage *second)
+{
+  GstState old1, new1, old2, new2, pending;
+
+  if (GST_MESSAGE_TYPE (first) != GST_MESSAGE_STATE_CHANGED ||
+      GST_MESSAGE_TYPE (second) != GST_MESSAGE_STATE_CHANGED ||
+      GST_MESSAGE_SRC (first) != GST_MESSAGE_SRC (second))
+    return NULL;
+
+  gst_message_parse_state_changed (first, &old1, &new1, NULL);
+  gst_message_parse_state_changed (second, &old2, &new2, &pending);
+  if (new1 != old2 || (new1 > old1) != (new2 > old2))
+    return NULL;
+
+  return gst_message_new_state_changed (GST_MESSAGE_SRC (second),
+      old1, new2, pending);
+}
+
+static void
+dispatch (GstPlayerDispatcher *disp,
+	  GstMessage          *message)
+{
+  GList *item;
+
+  disp->dispatching++;
+  for (item = disp->subscriptions; item != NULL; item = item->next) {
+    GstPlayerSubscription *sub = item->data;
+
+    if (sub->func == NULL ||
+        !(sub->types & GST_MESSAGE_TYPE (message)) ||
+        (sub->src && sub->src != GST_MESSAGE_SRC (message)))
+      continue;
+
+    sub->func (message, sub->data);
+  }
+  disp->dispatching--;
+
+  /* clean up what was unsubscribed meanwhile */
+  if (disp->dispatching == 0) {
+    for (item = disp->subscriptions; item != NULL; ) {
+      GstPlayerSubscription *sub = item->data;
+      GList *next = item->next;
+
+      if (sub->func == NULL) {
+        disp->subscriptions = g_list_delete_link (disp->subscriptions, item);
+        g_free (sub);
+      }
+      item = next;
+    }
+  }
+}
+
+/*
+ * Handles everything that is pending on the bus at once, rather than
+ * one message per main loop iteration, so state changes can be
+ * coalesced.
+ */
+
+static gboolean
+cb_bus (GstBus     *bus,
+	GstMessage *message,
+	gpointer    data)
+{
+  GstPlayerDispatcher *disp = data;
+  GList *batch, *item;
+  GstMessage *next;
+
+  batch = g_list_append (NULL, gst_message_ref (message));
+  while ((next = gst_bus_pop (bus))) {
+    GstMessage *merged = NULL;
+
+    /* look back for the last state change of the same object, but
+     * not past anything other than state changes of other objects:
+     * the merged message takes the place of the later one, and
+     * e.g. an error or EOS in between must stay where it was */
+    for (item = g_list_last (batch); item != NULL; item = item->prev) {
+      if (GST_MESSAGE_TYPE (item->data) != GST_MESSAGE_STATE_CHANGED ||
+          GST_MESSAGE_TYPE (next) != GST_MESSAGE_STATE_CHANGED)
+        break;
+      if (GST_MESSAGE_SRC (item->data) == GST_MESSAGE_SRC (next)) {
+        merged = merge_state_changes (item->data, next);
+        break;
+      }
+    }
+
+    if (merged) {
+      gst_message_unref (item->data);
+      batch = g_list_delete_link (batch, item);
+      gst_message_unref (next);
+      next = merged;
+    }
+    batch = g_list_append (batch, next);
+  }
+
+  for (item = batch; item != NULL; item = item->next) {
+    dispatch (disp, item->data);
+    gst_message_unref (item->data);
+  }
+  g_list_free (batch);
+
+  return TRUE;
+}
+
+GstPlayerDispatcher *
+gst_player_dispatcher_new (GstElement *pipeline)
+{
+  GstPlayerDispatcher *disp = g_new0 (GstPlayerDispatcher, 1);
+
+  disp->bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  disp->watch_id = gst_bus_add_watch (disp->bus, cb_bus, disp);
+
+  return disp;
+}
+
+void
+gst_player_dispatcher_free (GstPlayerDispatcher *disp)
+{
+  g_source_remove (disp->watch_id);
+  gst_object_unref (GST_OBJECT (disp->bus));
+
+  g_list_foreach (disp->subscriptions, (GFunc) g_free, NULL);
+  g_list_free (disp->subscriptions);
+  g_free (disp);
+}
+
+/*
+ * func is called from the main loop for all messages of one of the
+ * given types. If src is not NULL, only for messages posted by src.
+ * Returns an id for gst_player_dispatcher_unsubscribe().
+ */
+
+guint
+gst_player_dispatcher_subscribe (GstPlayerDispatcher  *disp,
+				 GstMessageType        types,
+				 GstObject            *src,
+				 GstPlayerDispatchFunc func,
+				 gpointer              data)
+{
+  GstPlayerSubscription *sub;
+
+  g_return_val_if_fail (disp != NULL, 0);
+  g_return_val_if_fail (func != NULL, 0);
+
+  sub = g_new (GstPlayerSubscription, 1);
+  sub->id = ++disp->last_id;
+  sub->types = types;
+  sub->src = src;
+  sub->func = func;
+  sub->data = data;
+  disp->subscriptions = g_list_append (disp->subscriptions, sub);
+
+  return sub->id;
+}
+
+void
+gst_player_dispatcher_unsubscribe (GstPlayerDispatcher *disp,
+				   guint                id)
+{
+  GList *item;
+
+  g_return_if_fail (disp != NULL);
+
+  for (item = disp->subscriptions; item != NULL; item = item->next) {
+    GstPlayerSubscription *sub = item->data;
+
+    if (sub->id != id)
+      continue;
+
+    if (disp->dispatching) {
+      /* removed after dispatching */
+      sub->func = NULL;
+    } else {
+      disp->subscriptions = g_list_delete_link (disp->subscriptions, item);
+      g_free (sub);
+    }
+    break;
+  }
+}
@@ -0,0 +1,57 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * dispatcher.h: bus message dispatching.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __DISPATCHER_H__
+#define __DISPATCHER_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef void (* GstPlayerDispatchFunc) (GstMessage *message,
+					gpointer    data);
+
+typedef struct _GstPlayerDispatcher {
+  GstBus *bus;
+  guint watch_id;
+
+  /* GstPlayerSubscription */
+  GList *subscriptions;
+  guint last_id;
+  gint dispatching;
+} GstPlayerDispatcher;
+
+GstPlayerDispatcher *
+		gst_player_dispatcher_new	(GstElement *pipeline);
+void		gst_player_dispatcher_free	(GstPlayerDispatcher *disp);
+
+guint		gst_player_dispatcher_subscribe	(GstPlayerDispatcher *disp,
+						 GstMessageType types,
+						 GstObject *src,
+						 GstPlayerDispatchFunc func,
+						 gpointer   data);
+void		gst_player_dispatcher_unsubscribe (GstPlayerDispatcher *disp,
+						 guint      id);
+
+G_END_DECLS
+
+#endif /* __DISPATCHER_H__ */
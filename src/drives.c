@@ -0,0 +1,325 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * drives.c: disc drive picker. All drives are probed at the same
+ * time, so that their spin-up delays overlap, and each row shows what
+ * was found as soon as its own probe finishes.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnome.h>
+
+#include "drives.h"
+
+enum {
+  COL_DEVICE,
+  COL_CONTENT,
+  COL_DRIVE,
+  N_COLS
+};
+
+typedef struct _GstPlayerDrive {
+  GstPlayerDrives *drives;
+  gchar *device;
+  GtkTreeIter iter;
+
+  /* probe in progress, or its result */
+  CdDetect *detect;
+  CdType type;
+} GstPlayerDrive;
+
+static void	gst_player_drives_class_init	(GstPlayerDrivesClass *klass);
+static void	gst_player_drives_init		(GstPlayerDrives *drives);
+static void	gst_player_drives_dispose	(GObject   *object);
+
+static void	cb_selection_changed		(GtkTreeSelection *selection,
+						 gpointer          data);
+static void	cb_row_activated		(GtkTreeView       *view,
+						 GtkTreePath       *path,
+						 GtkTreeViewColumn *column,
+						 gpointer           data);
+
+static GtkDialogClass *parent_class = NULL;
+
+GType
+gst_player_drives_get_type (void)
+{
+  static GType gst_player_drives_type = 0;
+
+  if (!gst_player_drives_type) {
+    static const GTypeInfo gst_player_drives_info = {
+      sizeof (GstPlayerDrivesClass),
+      NULL,
+      NULL,
+      (GClassInitFunc) gst_player_drives_class_init,
+      NULL,
+      NULL,
+      sizeof (GstPlayerDrives),
+      0,
+      (GInstanceInitFunc) gst_player_drives_init,
+      NULL
+    };
+
+    gst_player_drives_type =
+	g_type_register_static (GTK_TYPE_DIALOG, 
+				"GstPlayerDrives",
+				&gst_player_drives_info, 0);
+  }
+
+  return gst_player_drives_type;
+}
+
+static void
+gst_player_drives_class_init (GstPlayerDrivesClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  parent_class = g_type_class_ref (GTK_TYPE_DIALOG);
+
+  gobject_class->dispose = gst_player_drives_dispose;
+}
+
+static void
+gst_player_drives_init (GstPlayerDrives *drives)
+{
+  GtkWidget *scroll, *view;
+
+  drives->drives = NULL;
+
+  gtk_window_set_title (GTK_WINDOW (drives), _("Open disc"));
+  gtk_container_set_border_width (GTK_CONTAINER (drives), 6);
+  gtk_window_set_default_size (GTK_WINDOW (drives), 400, 200);
+
+  /* buttons */
+  gtk_dialog_add_button (GTK_DIALOG (drives),
+			 GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL);
+  gtk_dialog_add_button (GTK_DIALOG (drives),
+			 GTK_STOCK_OPEN, GTK_RESPONSE_OK);
+  gtk_dialog_set_default_response (GTK_DIALOG (drives), GTK_RESPONSE_OK);
+  gtk_box_set_spacing (GTK_BOX (GTK_DIALOG (drives)->vbox), 6);
+
+  /* drive list */
+  drives->store = gtk_list_store_new (N_COLS,
+      G_TYPE_STRING, G_TYPE_STRING, G_TYPE_POINTER);
+  view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (drives->store));
+  gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (view), -1,
+      _("Drive"), gtk_cell_renderer_text_new (), "text", COL_DEVICE, NULL);
+  gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (view), -1,
+      _("Contents"), gtk_cell_renderer_text_new (), "text", COL_CONTENT, NULL);
+  drives->selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (view));
+  gtk_tree_selection_set_mode (drives->selection, GTK_SELECTION_BROWSE);
+  g_signal_connect (drives->selection, "changed",
+      G_CALLBACK (cb_selection_changed), drives);
+  g_signal_connect (view, "row-activated",
+      G_CALLBACK (cb_row_activated), drives);
+
+  scroll = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scroll),
+				  GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scroll),
+				       GTK_SHADOW_IN);
+  gtk_container_add (GTK_CONTAINER (scroll), view);
+  gtk_widget_show (view);
+  gtk_box_pack_start (GTK_BOX (GTK_DIALOG (drives)->vbox),
+		      scroll, TRUE, TRUE, 0);
+  gtk_widget_show (scroll);
+}
+
+static void
+gst_player_drives_dispose (GObject *object)
+{
+  GstPlayerDrives *drives = GST_PLAYER_DRIVES (object);
+  GList *item;
+
+  /* the view may still change its selection while being torn down */
+  if (drives->selection) {
+    g_signal_handlers_disconnect_by_func (drives->selection,
+        cb_selection_changed, drives);
+    drives->selection = NULL;
+  }
+
+  /* probes still running finish in the background */
+  for (item = drives->drives; item != NULL; item = item->next) {
+    GstPlayerDrive *drive = item->data;
+
+    if (drive->detect)
+      cd_detect_cancel (drive->detect);
+    g_free (drive->device);
+    g_free (drive);
+  }
+  g_list_free (drives->drives);
+  drives->drives = NULL;
+
+  if (drives->store) {
+    g_object_unref (G_OBJECT (drives->store));
+    drives->store = NULL;
+  }
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
+}
+
+static GstPlayerDrive *
+selected_drive (GstPlayerDrives *drives)
+{
+  GstPlayerDrive *drive = NULL;
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+
+  if (gtk_tree_selection_get_selected (drives->selection, &model, &iter))
+    gtk_tree_model_get (model, &iter, COL_DRIVE, &drive, -1);
+
+  return drive;
+}
+
+static gboolean
+drive_playable (GstPlayerDrive *drive)
+{
+  return drive && !drive->detect && drive->type != CD_TYPE_ERROR;
+}
+
+static void
+cb_selection_changed (GtkTreeSelection *selection,
+		      gpointer          data)
+{
+  GstPlayerDrives *drives = GST_PLAYER_DRIVES (data);
+
+  gtk_dialog_set_response_sensitive (GTK_DIALOG (drives), GTK_RESPONSE_OK,
+      drive_playable (selected_drive (drives)));
+}
+
+static void
+cb_row_activated (GtkTreeView       *view,
+		  GtkTreePath       *path,
+		  GtkTreeViewColumn *column,
+		  gpointer           data)
+{
+  GstPlayerDrives *drives = GST_PLAYER_DRIVES (data);
+
+  if (drive_playable (selected_drive (drives)))
+    gtk_dialog_response (GTK_DIALOG (drives), GTK_RESPONSE_OK);
+}
+
+static const gchar *
+type_name (CdType type)
+{
+  switch (type) {
+    case CD_TYPE_CDDA:
+      return _("Audio CD");
+    case CD_TYPE_VCD:
+      return _("Video CD");
+    case CD_TYPE_SVCD:
+      return _("Super Video CD");
+    case CD_TYPE_DVD:
+      return _("DVD");
+    case CD_TYPE_DATA:
+      return _("Data disc");
+    default:
+      return _("Unknown");
+  }
+}
+
+static void
+cb_progress (const gchar *message,
+	     gdouble      fraction,
+	     gpointer     data)
+{
+  GstPlayerDrive *drive = data;
+
+  gtk_list_store_set (drive->drives->store, &drive->iter,
+		      COL_CONTENT, message, -1);
+}
+
+static void
+cb_detected (CdType       type,
+	     const gchar *uri,
+	     GError      *error,
+	     gpointer     data)
+{
+  GstPlayerDrive *drive = data;
+  GstPlayerDrives *drives = drive->drives;
+
+  drive->detect = NULL;
+  drive->type = type;
+  gtk_list_store_set (drives->store, &drive->iter, COL_CONTENT,
+      type == CD_TYPE_ERROR && error ? error->message : type_name (type),
+      -1);
+
+  /* the first drive with something on it is the likely choice */
+  if (type != CD_TYPE_ERROR && !drive_playable (selected_drive (drives)))
+    gtk_tree_selection_select_iter (drives->selection, &drive->iter);
+
+  cb_selection_changed (drives->selection, drives);
+}
+
+/*
+ * Starts probing devices (device node names) right away.
+ */
+
+GtkWidget *
+gst_player_drives_new (const GList *devices)
+{
+  GstPlayerDrives *drives = g_object_new (GST_PLAYER_TYPE_DRIVES, NULL);
+
+  for ( ; devices != NULL; devices = devices->next) {
+    GstPlayerDrive *drive = g_new0 (GstPlayerDrive, 1);
+
+    drive->drives = drives;
+    drive->device = g_strdup (devices->data);
+    drive->type = CD_TYPE_ERROR;
+    gtk_list_store_append (drives->store, &drive->iter);
+    gtk_list_store_set (drives->store, &drive->iter,
+			COL_DEVICE, drive->device,
+			COL_CONTENT, _("Waiting for drive"),
+			COL_DRIVE, drive, -1);
+    drives->drives = g_list_append (drives->drives, drive);
+
+    drive->detect = cd_detect_type_async (drive->device,
+        cb_progress, cb_detected, drive);
+  }
+  cb_selection_changed (drives->selection, drives);
+
+  return GTK_WIDGET (drives);
+}
+
+/*
+ * What was found in the selected drive, and its device node; uri is
+ * NULL for data discs. The strings belong to the dialog.
+ */
+
+gboolean
+gst_player_drives_get_selected (GstPlayerDrives *drives,
+				CdType          *type,
+				const gchar    **uri,
+				const gchar    **device)
+{
+  GstPlayerDrive *drive = selected_drive (drives);
+
+  g_return_val_if_fail (GST_PLAYER_IS_DRIVES (drives), FALSE);
+
+  if (!drive_playable (drive))
+    return FALSE;
+
+  *type = drive->type;
+  *uri = cd_type_get_uri (drive->type);
+  *device = drive->device;
+
+  return TRUE;
+}
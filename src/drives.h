@@ -0,0 +1,69 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * drives.h: disc drive picker
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __DRIVES_H__
+#define __DRIVES_H__
+
+#include <glib.h>
+#include <gdk/gdk.h>
+#include <gtk/gtkdialog.h>
+#include <gtk/gtkliststore.h>
+#include <gtk/gtktreeselection.h>
+
+#include "disc.h"
+
+G_BEGIN_DECLS
+
+#define GST_PLAYER_TYPE_DRIVES \
+  (gst_player_drives_get_type())
+#define GST_PLAYER_DRIVES(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_PLAYER_TYPE_DRIVES, GstPlayerDrives))
+#define GST_PLAYER_DRIVES_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), GST_PLAYER_TYPE_DRIVES, GstPlayerDrivesClass))
+#define GST_PLAYER_IS_DRIVES(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_PLAYER_TYPE_DRIVES))
+#define GST_PLAYER_IS_DRIVES_CLASS(obj) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_PLAYER_TYPE_DRIVES))
+
+typedef struct _GstPlayerDrives {
+  GtkDialog parent;
+
+  GtkListStore *store;
+  GtkTreeSelection *selection;
+
+  /* GstPlayerDrive, one per row, probed in parallel */
+  GList *drives;
+} GstPlayerDrives;
+
+typedef struct _GstPlayerDrivesClass {
+  GtkDialogClass klass;
+} GstPlayerDrivesClass;
+
+GType		gst_player_drives_get_type	(void);
+GtkWidget *	gst_player_drives_new		(const GList *devices);
+gboolean	gst_player_drives_get_selected	(GstPlayerDrives *drives,
+						 CdType          *type,
+						 const gchar    **uri,
+						 const gchar    **device);
+
+G_END_DECLS
+
+#endif /* __DRIVES_H__ */
@@ -0,0 +1,213 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * headless.c: playback without user interface, for measuring raw
+ * decoding throughput.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "dispatcher.h"
+#include "headless.h"
+#include "pipeline.h"
+
+typedef struct _GstPlayerHeadless {
+  GstElement *play;
+  GMainLoop *loop;
+
+  /* measurements */
+  gint frames;
+  GTimer *timer;
+  gboolean failed;
+
+  /* peak resident set size of the current run, in kB */
+  glong rss;
+} GstPlayerHeadless;
+
+#define RSS_INTERVAL	100
+
+/*
+ * Current resident set size, in kB, or -1. Unlike ru_maxrss, this
+ * can go down again, so every URI gets its own peak.
+ */
+
+static glong
+rss_now (void)
+{
+  gchar *contents;
+  glong pages, res = -1;
+
+  if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+    return -1;
+  if (sscanf (contents, "%*ld %ld", &pages) == 1)
+    res = pages * (sysconf (_SC_PAGESIZE) / 1024);
+  g_free (contents);
+
+  return res;
+}
+
+static gboolean
+cb_sample_rss (gpointer data)
+{
+  GstPlayerHeadless *hl = data;
+
+  hl->rss = MAX (hl->rss, rss_now ());
+
+  return TRUE;
+}
+
+static void
+cb_handoff (GstElement *sink,
+	    GstBuffer  *buffer,
+	    GstPad     *pad,
+	    gpointer    data)
+{
+  GstPlayerHeadless *hl = data;
+
+  g_atomic_int_inc (&hl->frames);
+}
+
+static void
+cb_message (GstMessage*message,
+            gpointer   user_data)
+{
+  GstPlayerHeadless *hl = user_data;
+
+  switch (message->type) {
+    case GST_MESSAGE_EOS:
+      g_main_loop_quit (hl->loop);
+      break;
+    case GST_MESSAGE_ERROR:
+      {
+        GError* error = NULL;
+        gchar * debug = NULL;
+
+        gst_message_parse_error (message,
+                                 &error,
+                                 &debug);
+
+        g_printerr ("%s: %s\n", GST_OBJECT_NAME (message->src),
+                    error->message);
+        hl->failed = TRUE;
+        g_main_loop_quit (hl->loop);
+
+        g_error_free (error);
+        g_free (debug);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+static GstElement *
+make_sink (const gchar *name)
+{
+  GstElement *sink;
+
+  if ((sink = gst_element_factory_make ("fakesink", name))) {
+    g_object_set (sink, "sync", FALSE, NULL);
+  }
+
+  return sink;
+}
+
+/*
+ * Plays each URI to the end as fast as the decoders allow, and prints
+ * frame rate, wall time and peak RSS for each of them. The peak is
+ * sampled while the URI plays, so it's not carried over from earlier
+ * ones.
+ */
+
+gint
+gst_player_headless_run (gchar **uris)
+{
+  GstPlayerHeadless hl;
+  GstElement *audio, *video;
+  GstPlayerDispatcher *disp;
+  GError *err = NULL;
+  gint n, res = EXIT_SUCCESS;
+
+  if (!(audio = make_sink ("audio-sink")) ||
+      !(video = make_sink ("video-sink"))) {
+    g_printerr ("Failed to create fakesink\n");
+    return EXIT_FAILURE;
+  }
+  g_object_set (video, "signal-handoffs", TRUE, NULL);
+
+  if (!(hl.play = gst_player_pipeline_new (audio, video, &err))) {
+    g_printerr ("Failed to start player: %s\n", err->message);
+    g_error_free (err);
+    return EXIT_FAILURE;
+  }
+  hl.loop = g_main_loop_new (NULL, FALSE);
+  hl.timer = g_timer_new ();
+
+  g_signal_connect (video, "handoff", G_CALLBACK (cb_handoff), &hl);
+  disp = gst_player_dispatcher_new (hl.play);
+  gst_player_dispatcher_subscribe (disp,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR, NULL, cb_message, &hl);
+
+  for (n = 0; uris[n] != NULL; n++) {
+    gdouble elapsed;
+    guint rss_id;
+
+    hl.frames = 0;
+    hl.failed = FALSE;
+    hl.rss = rss_now ();
+
+    g_object_set (G_OBJECT (hl.play), "uri", uris[n], NULL);
+    rss_id = g_timeout_add (RSS_INTERVAL, cb_sample_rss, &hl);
+    g_timer_start (hl.timer);
+    if (gst_element_set_state (hl.play, GST_STATE_PLAYING) !=
+            GST_STATE_CHANGE_FAILURE)
+      g_main_loop_run (hl.loop);
+    else
+      hl.failed = TRUE;
+    elapsed = g_timer_elapsed (hl.timer, NULL);
+    cb_sample_rss (&hl);
+    g_source_remove (rss_id);
+    gst_element_set_state (hl.play, GST_STATE_READY);
+
+    if (hl.failed) {
+      res = EXIT_FAILURE;
+      g_print ("%s: failed after %.03lf s\n", uris[n], elapsed);
+    } else {
+      g_print ("%s: %d frames in %.03lf s (%.02lf fps), peak RSS %ld kB\n",
+               uris[n], hl.frames, elapsed,
+               elapsed > 0. ? hl.frames / elapsed : 0., hl.rss);
+    }
+  }
+
+  gst_player_dispatcher_free (disp);
+  gst_element_set_state (hl.play, GST_STATE_NULL);
+  gst_object_unref (GST_OBJECT (hl.play));
+  g_main_loop_unref (hl.loop);
+  g_timer_destroy (hl.timer);
+
+  return res;
+}
@@ -0,0 +1,601 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * index.c: persistent keyframe index. While local files play, the
+ * timestamps of the keyframes leaving the demuxer and the byte offset
+ * of the container data they came from are recorded. They are stored
+ * in the user's cache directory, keyed by URI, size and modification
+ * time.
+ *
+ * Demuxers that pull their data look keyframes up in the container's
+ * own index. Those that get it pushed, as for MPEG program and
+ * transport streams, can only estimate where a time is and then scan
+ * for a keyframe. For those, seeks go to the recorded byte offset
+ * instead, and for accurate seeks the new segment is moved to start at
+ * the position asked for, so that decoding starts at the keyframe but
+ * nothing before the position is shown.
+ *
+ * Since playback may jump around, an entry only says the file has no
+ * other keyframes between it and the previous one if both were seen
+ * in one go. Lookups only trust such spans.
+ *
+ * The file is a magic string followed by varint-coded entries: the
+ * timestamp delta to the previous entry shifted left by one with the
+ * "follows" flag in the low bit, and the zigzag-coded delta of the
+ * offset.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "index.h"
+#include "metadata.h"
+#include "pipeline.h"
+
+#define INDEX_MAGIC "ALDIDX2\n"
+
+/*
+ * Entries.
+ */
+
+static gint
+entry_find (GArray      *entries,
+	    GstClockTime timestamp)
+{
+  gint lo = 0, hi = entries->len;
+
+  /* first entry with a timestamp >= the given one */
+  while (lo < hi) {
+    gint mid = (lo + hi) / 2;
+
+    if (g_array_index (entries, GstPlayerIndexEntry, mid).timestamp <
+        timestamp)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+/*
+ * Keyframes are recorded where they leave the demuxer, or going into
+ * the decoder if there is none.
+ */
+
+static void
+entry_add (GstPlayerIndex *index,
+	   GstClockTime    timestamp,
+	   gint64          offset,
+	   gboolean        from_demux)
+{
+  GstPlayerIndexEntry entry = { timestamp, offset, FALSE };
+  GstPlayerIndexEntry *prev, *cur;
+  gint pos;
+
+  g_mutex_lock (index->lock);
+  if (index->filename && from_demux == (index->demux != NULL)) {
+    pos = entry_find (index->entries, timestamp);
+    if (pos == index->entries->len ||
+        g_array_index (index->entries, GstPlayerIndexEntry,
+            pos).timestamp != timestamp) {
+      g_array_insert_val (index->entries, pos, entry);
+      index->dirty = TRUE;
+    }
+
+    /* one after the other, so nothing was skipped in between */
+    prev = pos > 0 ?
+        &g_array_index (index->entries, GstPlayerIndexEntry, pos - 1) : NULL;
+    cur = &g_array_index (index->entries, GstPlayerIndexEntry, pos);
+    if (!cur->follows && prev && GST_CLOCK_TIME_IS_VALID (index->last) &&
+        prev->timestamp == index->last) {
+      cur->follows = TRUE;
+      index->dirty = TRUE;
+    }
+  }
+  index->last = timestamp;
+  g_mutex_unlock (index->lock);
+}
+
+/*
+ * Recording, from the streaming threads.
+ */
+
+static void
+index_reset_last (GstPlayerIndex *index)
+{
+  g_mutex_lock (index->lock);
+  index->last = GST_CLOCK_TIME_NONE;
+  g_mutex_unlock (index->lock);
+}
+
+static gboolean
+cb_buffer (GstPad    *pad,
+	   GstBuffer *buf,
+	   gpointer   data)
+{
+  if (!GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT) &&
+      GST_BUFFER_TIMESTAMP_IS_VALID (buf))
+    entry_add (data, GST_BUFFER_TIMESTAMP (buf), -1, FALSE);
+
+  return TRUE;
+}
+
+static gboolean
+cb_event (GstPad   *pad,
+	  GstEvent *event,
+	  gpointer  data)
+{
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_STOP:
+    case GST_EVENT_NEWSEGMENT:
+      index_reset_last (data);
+      break;
+    default:
+      break;
+  }
+
+  return TRUE;
+}
+
+/*
+ * The source hands out buffers with their byte offset. A keyframe
+ * leaving the demuxer started in the buffer that went in last or,
+ * if it spans two, in the one before.
+ */
+
+static gboolean
+cb_demux_buffer (GstPad    *pad,
+		 GstBuffer *buf,
+		 gpointer   data)
+{
+  GstPlayerIndex *index = data;
+
+  g_mutex_lock (index->lock);
+  if (GST_OBJECT_PARENT (pad) == GST_OBJECT (index->demux)) {
+    index->offset[0] = index->offset[1];
+    index->offset[1] = GST_BUFFER_OFFSET_IS_VALID (buf) ?
+        (gint64) GST_BUFFER_OFFSET (buf) : -1;
+  }
+  g_mutex_unlock (index->lock);
+
+  return TRUE;
+}
+
+static gboolean
+cb_demux_event (GstPad   *pad,
+		GstEvent *event,
+		gpointer  data)
+{
+  GstPlayerIndex *index = data;
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_FLUSH_STOP)
+    return TRUE;
+
+  g_mutex_lock (index->lock);
+  if (GST_OBJECT_PARENT (pad) == GST_OBJECT (index->demux)) {
+    index->offset[0] = index->offset[1] = -1;
+
+    /* this flush is from our own byte seek, or any later one */
+    index->clip = index->clip_next;
+    index->clip_next = GST_CLOCK_TIME_NONE;
+    index->clip_serial++;
+  }
+  g_mutex_unlock (index->lock);
+
+  return TRUE;
+}
+
+static gboolean
+cb_demux_src_buffer (GstPad    *pad,
+		     GstBuffer *buf,
+		     gpointer   data)
+{
+  GstPlayerIndex *index = data;
+  GstCaps *caps;
+  gint64 offset;
+
+  if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT) ||
+      !GST_BUFFER_TIMESTAMP_IS_VALID (buf))
+    return TRUE;
+
+  /* only video has keyframes worth indexing */
+  if (!(caps = GST_BUFFER_CAPS (buf)) && !(caps = GST_PAD_CAPS (pad)))
+    return TRUE;
+  if (!g_str_has_prefix (gst_structure_get_name (
+          gst_caps_get_structure (caps, 0)), "video/"))
+    return TRUE;
+
+  g_mutex_lock (index->lock);
+  if (GST_OBJECT_PARENT (pad) != GST_OBJECT (index->demux)) {
+    g_mutex_unlock (index->lock);
+    return TRUE;
+  }
+  offset = index->offset[0] >= 0 ? index->offset[0] : index->offset[1];
+  g_mutex_unlock (index->lock);
+  entry_add (index, GST_BUFFER_TIMESTAMP (buf), offset, TRUE);
+
+  return TRUE;
+}
+
+/*
+ * After a byte seek for an accurate position, the first segment of
+ * every stream is moved to start at that position.
+ */
+
+static gboolean
+cb_demux_src_event (GstPad   *pad,
+		    GstEvent *event,
+		    gpointer  data)
+{
+  GstPlayerIndex *index = data;
+  GstClockTime clip;
+  GstFormat format;
+  gboolean update;
+  gdouble rate;
+  gint64 start, stop, time;
+  guint serial;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_STOP:
+      index_reset_last (index);
+      return TRUE;
+    case GST_EVENT_NEWSEGMENT:
+      index_reset_last (index);
+      break;
+    default:
+      return TRUE;
+  }
+
+  gst_event_parse_new_segment (event, &update, &rate, &format,
+			       &start, &stop, &time);
+  if (update || format != GST_FORMAT_TIME)
+    return TRUE;
+
+  g_mutex_lock (index->lock);
+  clip = index->clip;
+  serial = index->clip_serial;
+  g_mutex_unlock (index->lock);
+  if (!GST_CLOCK_TIME_IS_VALID (clip) ||
+      GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (pad),
+          "aldegonde-clip")) == serial)
+    return TRUE;
+  g_object_set_data (G_OBJECT (pad), "aldegonde-clip",
+		     GUINT_TO_POINTER (serial));
+
+  if (start >= (gint64) clip || (stop != -1 && stop <= (gint64) clip))
+    return TRUE;
+
+  if (time != -1)
+    time += clip - start;
+  gst_pad_push_event (pad, gst_event_new_new_segment (FALSE, rate, format,
+						      clip, stop, time));
+
+  return FALSE;
+}
+
+static void
+cb_pad_added (GstElement *element,
+	      GstPad     *pad,
+	      gpointer    data)
+{
+  if (GST_PAD_DIRECTION (pad) != GST_PAD_SRC)
+    return;
+
+  gst_pad_add_buffer_probe (pad, G_CALLBACK (cb_demux_src_buffer), data);
+  gst_pad_add_event_probe (pad, G_CALLBACK (cb_demux_src_event), data);
+}
+
+/*
+ * The newest demuxer belongs to the newest media.
+ */
+
+static void
+demux_add (GstPlayerIndex *index,
+	   GstElement     *element)
+{
+  GstPad *pad;
+
+  if (!(pad = gst_element_get_static_pad (element, "sink")))
+    return;
+
+  g_mutex_lock (index->lock);
+  if (index->demux)
+    gst_object_unref (GST_OBJECT (index->demux));
+  index->demux = gst_object_ref (GST_OBJECT (element));
+  index->offset[0] = index->offset[1] = -1;
+  g_mutex_unlock (index->lock);
+
+  gst_pad_add_buffer_probe (pad, G_CALLBACK (cb_demux_buffer), index);
+  gst_pad_add_event_probe (pad, G_CALLBACK (cb_demux_event), index);
+  gst_object_unref (GST_OBJECT (pad));
+
+  g_signal_connect (element, "pad-added", G_CALLBACK (cb_pad_added), index);
+}
+
+static void
+cb_element (GstElement *element,
+	    gpointer    data)
+{
+  GstElementFactory *factory = gst_element_get_factory (element);
+  const gchar *klass;
+  GstPad *pad;
+
+  if (!factory)
+    return;
+  klass = gst_element_factory_get_klass (factory);
+  if (strstr (klass, "Demux")) {
+    demux_add (data, element);
+    return;
+  }
+  if (!strstr (klass, "Decoder") || !strstr (klass, "Video"))
+    return;
+
+  if ((pad = gst_element_get_static_pad (element, "sink"))) {
+    gst_pad_add_buffer_probe (pad, G_CALLBACK (cb_buffer), data);
+    gst_pad_add_event_probe (pad, G_CALLBACK (cb_event), data);
+    gst_object_unref (GST_OBJECT (pad));
+  }
+}
+
+GstPlayerIndex *
+gst_player_index_new (GstElement *play)
+{
+  GstPlayerIndex *index = g_new0 (GstPlayerIndex, 1);
+
+  index->lock = g_mutex_new ();
+  index->entries = g_array_new (FALSE, FALSE, sizeof (GstPlayerIndexEntry));
+  index->last = GST_CLOCK_TIME_NONE;
+  index->offset[0] = index->offset[1] = -1;
+  index->clip = index->clip_next = GST_CLOCK_TIME_NONE;
+  gst_player_pipeline_watch_elements (play, cb_element, index);
+
+  return index;
+}
+
+void
+gst_player_index_free (GstPlayerIndex *index)
+{
+  gst_player_index_save (index);
+  if (index->demux)
+    gst_object_unref (GST_OBJECT (index->demux));
+  g_array_free (index->entries, TRUE);
+  g_free (index->filename);
+  g_mutex_free (index->lock);
+  g_free (index);
+}
+
+/*
+ * Storage.
+ */
+
+static void
+put_varint (GString *str,
+	    guint64  value)
+{
+  do {
+    guint8 byte = value & 0x7f;
+
+    value >>= 7;
+    if (value)
+      byte |= 0x80;
+    g_string_append_c (str, byte);
+  } while (value);
+}
+
+static gboolean
+get_varint (const guint8 **data,
+	    const guint8  *end,
+	    guint64       *value)
+{
+  gint shift = 0;
+
+  *value = 0;
+  while (*data < end && shift < 64) {
+    guint8 byte = *(*data)++;
+
+    *value |= (guint64) (byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return TRUE;
+    shift += 7;
+  }
+
+  return FALSE;
+}
+
+static gchar *
+index_filename (const gchar *uri)
+{
+  gchar *key, *filename = NULL;
+
+  if ((key = gst_player_metadata_key (uri))) {
+    filename = g_build_filename (g_get_user_cache_dir (), PACKAGE,
+				 "index", key, NULL);
+    g_free (key);
+  }
+
+  return filename;
+}
+
+static void
+index_load (GstPlayerIndex *index)
+{
+  gchar *contents;
+  gsize len;
+  const guint8 *data, *end;
+  GstPlayerIndexEntry entry = { 0, -1, FALSE };
+
+  if (!g_file_get_contents (index->filename, &contents, &len, NULL))
+    return;
+
+  data = (const guint8 *) contents;
+  end = data + len;
+  if (len >= strlen (INDEX_MAGIC) &&
+      !memcmp (data, INDEX_MAGIC, strlen (INDEX_MAGIC))) {
+    guint64 ts, offset;
+
+    data += strlen (INDEX_MAGIC);
+    while (get_varint (&data, end, &ts) &&
+           get_varint (&data, end, &offset)) {
+      gint64 delta = (offset >> 1) ^ -(gint64) (offset & 1);
+
+      entry.timestamp += ts >> 1;
+      entry.follows = ts & 1;
+      entry.offset += delta;
+      g_array_append_val (index->entries, entry);
+    }
+  }
+  g_free (contents);
+}
+
+/*
+ * Writes out what was recorded for the current media, if anything
+ * changed.
+ */
+
+void
+gst_player_index_save (GstPlayerIndex *index)
+{
+  GString *str;
+  GstClockTime last_ts = 0;
+  gint64 last_offset = -1;
+  gchar *dir;
+  gint n;
+
+  g_mutex_lock (index->lock);
+  if (!index->filename || !index->dirty) {
+    g_mutex_unlock (index->lock);
+    return;
+  }
+
+  str = g_string_new (INDEX_MAGIC);
+  for (n = 0; n < index->entries->len; n++) {
+    GstPlayerIndexEntry *entry =
+        &g_array_index (index->entries, GstPlayerIndexEntry, n);
+    gint64 delta = entry->offset - last_offset;
+
+    put_varint (str, ((entry->timestamp - last_ts) << 1) | !!entry->follows);
+    put_varint (str, ((guint64) delta << 1) ^ (guint64) (delta >> 63));
+    last_ts = entry->timestamp;
+    last_offset = entry->offset;
+  }
+  index->dirty = FALSE;
+
+  dir = g_path_get_dirname (index->filename);
+  g_mkdir_with_parents (dir, 0700);
+  g_file_set_contents (index->filename, str->str, str->len, NULL);
+  g_free (dir);
+  g_mutex_unlock (index->lock);
+
+  g_string_free (str, TRUE);
+}
+
+/*
+ * Saves the index of the previous media and loads the one of uri.
+ */
+
+void
+gst_player_index_open (GstPlayerIndex *index,
+		       const gchar    *uri)
+{
+  gchar *filename = uri ? index_filename (uri) : NULL;
+
+  gst_player_index_save (index);
+
+  g_mutex_lock (index->lock);
+  g_free (index->filename);
+  index->filename = filename;
+  g_array_set_size (index->entries, 0);
+  index->dirty = FALSE;
+  index->last = GST_CLOCK_TIME_NONE;
+  index->clip = index->clip_next = GST_CLOCK_TIME_NONE;
+  if (filename)
+    index_load (index);
+  g_mutex_unlock (index->lock);
+}
+
+/*
+ * The entry of the keyframe at or before position, or NULL if the
+ * index doesn't know for sure which one that is. Call with the lock.
+ */
+
+static GstPlayerIndexEntry *
+entry_lookup (GstPlayerIndex *index,
+	      GstClockTime    position)
+{
+  gint pos = entry_find (index->entries, position + 1);
+
+  if (pos > 0 && pos < index->entries->len &&
+      g_array_index (index->entries, GstPlayerIndexEntry, pos).follows)
+    return &g_array_index (index->entries, GstPlayerIndexEntry, pos - 1);
+
+  return NULL;
+}
+
+/*
+ * Seeks the demuxer's input to the keyframe at or before position if
+ * the demuxer gets its data pushed and so would have to search for
+ * it. Returns FALSE if the index can't help, and the caller should
+ * seek in time as usual.
+ */
+
+gboolean
+gst_player_index_seek (GstPlayerIndex *index,
+		       GstClockTime    position,
+		       gboolean        accurate)
+{
+  GstPlayerIndexEntry *entry;
+  GstPad *pad = NULL;
+  gint64 offset = -1;
+  gboolean res;
+
+  g_mutex_lock (index->lock);
+  index->clip = index->clip_next = GST_CLOCK_TIME_NONE;
+  if (index->demux && (entry = entry_lookup (index, position)) &&
+      entry->offset >= 0 &&
+      (pad = gst_element_get_static_pad (index->demux, "sink"))) {
+    if (GST_PAD_ACTIVATE_MODE (pad) == GST_ACTIVATE_PUSH) {
+      offset = entry->offset;
+      if (accurate && entry->timestamp < position)
+        index->clip_next = position;
+    }
+  }
+  g_mutex_unlock (index->lock);
+
+  if (!pad)
+    return FALSE;
+  if (offset < 0) {
+    gst_object_unref (GST_OBJECT (pad));
+    return FALSE;
+  }
+
+  res = gst_pad_push_event (pad, gst_event_new_seek (1.0, GST_FORMAT_BYTES,
+      GST_SEEK_FLAG_FLUSH, GST_SEEK_TYPE_SET, offset, GST_SEEK_TYPE_NONE, -1));
+  gst_object_unref (GST_OBJECT (pad));
+
+  if (!res) {
+    g_mutex_lock (index->lock);
+    index->clip = index->clip_next = GST_CLOCK_TIME_NONE;
+    g_mutex_unlock (index->lock);
+  }
+
+  return res;
+}
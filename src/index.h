@@ -0,0 +1,80 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * index.h: persistent keyframe index
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __INDEX_H__
+#define __INDEX_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstPlayerIndexEntry {
+  GstClockTime timestamp;
+
+  /* byte offset in the container at or before the keyframe, or -1
+   * if there's no demuxer or the source didn't say */
+  gint64 offset;
+
+  /* whether the previous entry is the keyframe right before this one,
+   * i.e. there's no unrecorded keyframe in between */
+  gboolean follows;
+} GstPlayerIndexEntry;
+
+typedef struct _GstPlayerIndex {
+  GMutex *lock;
+
+  /* file the index of the current media is stored in, or NULL if
+   * the media can't be indexed (not a local file) */
+  gchar *filename;
+
+  /* GstPlayerIndexEntry, sorted by timestamp */
+  GArray *entries;
+  gboolean dirty;
+
+  /* last keyframe seen since the last flush or new segment */
+  GstClockTime last;
+
+  /* demuxer of the newest media and the byte offsets of the last
+   * two buffers that went into it */
+  GstElement *demux;
+  gint64 offset[2];
+
+  /* where segments start after the byte seek being flushed in now
+   * (clip_next) or the last one; each stream's pad is clipped once
+   * per serial */
+  GstClockTime clip, clip_next;
+  guint clip_serial;
+} GstPlayerIndex;
+
+GstPlayerIndex *gst_player_index_new		(GstElement *play);
+void		gst_player_index_free		(GstPlayerIndex *index);
+
+void		gst_player_index_open		(GstPlayerIndex *index,
+						 const gchar    *uri);
+void		gst_player_index_save		(GstPlayerIndex *index);
+gboolean	gst_player_index_seek		(GstPlayerIndex *index,
+						 GstClockTime    position,
+						 gboolean        accurate);
+
+G_END_DECLS
+
+#endif /* __INDEX_H__ */
@@ -24,10 +24,16 @@
 #endif
 
 #include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
 #include <glib.h>
 #include <gst/gst.h>
 #include <gnome.h>
 
+#include "colorconv.h"
+#include "disc.h"
+#include "headless.h"
+#include "sink.h"
 #include "stock.h"
 #include "window.h"
 
@@ -63,6 +69,96 @@ register_stock_icons (void)
   }
 }
 
+static gchar *
+arg_to_uri (const gchar *arg)
+{
+  GFile* file = g_file_new_for_commandline_arg (arg);
+  gchar* uri  = g_file_get_uri (file);
+
+  g_object_unref (file);
+
+  return uri;
+}
+
+/*
+ * Without GTK+/GNOME, decode everything as fast as possible and report
+ * statistics.
+ */
+
+static gint
+run_headless (GOptionContext *options,
+              gint            argc,
+              gchar          *argv[],
+              gchar        ***files)
+{
+  GError *err = NULL;
+  gchar **uris;
+  gint n, res;
+
+  if (!g_option_context_parse (options, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    return EXIT_FAILURE;
+  }
+  if (!*files) {
+    g_printerr ("%s: --headless needs at least one file\n",
+                g_get_prgname ());
+    return EXIT_FAILURE;
+  }
+
+  uris = g_new0 (gchar *, g_strv_length (*files) + 1);
+  for (n = 0; (*files)[n] != NULL; n++)
+    uris[n] = arg_to_uri ((*files)[n]);
+
+  res = gst_player_headless_run (uris);
+
+  g_strfreev (uris);
+  g_strfreev (*files);
+
+  return res;
+}
+
+static void
+cb_calibrate_progress (const gchar *message,
+		       gdouble      fraction,
+		       gpointer     data)
+{
+  GtkProgressBar *bar = GTK_PROGRESS_BAR (data);
+
+  gtk_progress_bar_set_text (bar, message);
+  gtk_progress_bar_set_fraction (bar, fraction);
+}
+
+/*
+ * Chooses the video output on first start, with a progress window
+ * so that the test windows popping up don't come out of nowhere.
+ */
+
+static void
+calibrate_video (void)
+{
+  GtkWidget *win, *box, *label, *bar;
+
+  win = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  gtk_window_set_title (GTK_WINDOW (win), _("Setting up video output"));
+  gtk_window_set_position (GTK_WINDOW (win), GTK_WIN_POS_CENTER);
+  g_signal_connect (win, "delete-event", G_CALLBACK (gtk_true), NULL);
+  gtk_container_set_border_width (GTK_CONTAINER (win), 12);
+
+  box = gtk_vbox_new (FALSE, 6);
+  label = gtk_label_new (_("Measuring which video output "
+			   "is fastest on this computer..."));
+  gtk_box_pack_start (GTK_BOX (box), label, FALSE, FALSE, 0);
+  bar = gtk_progress_bar_new ();
+  gtk_box_pack_start (GTK_BOX (box), bar, FALSE, FALSE, 0);
+  gtk_container_add (GTK_CONTAINER (win), box);
+  gtk_widget_show_all (win);
+
+  gst_player_video_sink_calibrate (cb_calibrate_progress, bar);
+
+  gtk_widget_destroy (win);
+}
+
 static void
 cb_destroy (GtkWidget *widget,
 	    gpointer   data)
@@ -78,11 +174,19 @@ main (gint   argc,
   gchar         * appfile;
   GOptionContext* options;
   gchar         **files = NULL;
+  gboolean        headless = FALSE, trace = FALSE, calibrate = FALSE;
   GOptionEntry    entries[] = {
+    {"headless", 0, 0, G_OPTION_ARG_NONE, &headless,
+     N_("Decode without user interface and print statistics"), NULL},
+    {"trace", 0, 0, G_OPTION_ARG_NONE, &trace,
+     N_("Measure processing time of every element"), NULL},
+    {"calibrate", 0, 0, G_OPTION_ARG_NONE, &calibrate,
+     N_("Choose the fastest video output again"), NULL},
     {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &files, NULL, NULL},
     {NULL}
   };
   GtkWidget     * win;
+  gint            n;
 
   g_thread_init (NULL);
 
@@ -91,6 +195,13 @@ main (gint   argc,
   /* init gstreamer */
   g_option_context_add_group(options, gst_init_get_option_group ());
 
+  /* headless mode must not touch the display at all, so it has to be
+   * known before GNOME is initialized */
+  for (n = 1; n < argc; n++) {
+    if (!strcmp (argv[n], "--headless"))
+      return run_headless (options, argc, argv, &files);
+  }
+
   /* init gtk/gnome */
   gnome_program_init (PACKAGE, VERSION, LIBGNOMEUI_MODULE, argc, argv,
 		      GNOME_PARAM_GOPTION_CONTEXT, options,
@@ -98,6 +209,7 @@ main (gint   argc,
 
   /* init ourselves */
   register_stock_icons ();
+  gst_player_color_conv_register ();
 
   /* add appicon image */
   appfile = gnome_program_locate_file (NULL, GNOME_FILE_DOMAIN_APP_PIXMAP,
@@ -108,6 +220,11 @@ main (gint   argc,
     g_free (appfile);
   }
 
+  if (calibrate)
+    gst_player_video_sink_forget ();
+  if (!gst_player_video_sink_calibrated ())
+    calibrate_video ();
+
   /* window contains everything automagically */
   if (!(win = gst_player_window_new (&err))) {
     win = gtk_message_dialog_new (NULL, 0, GTK_MESSAGE_ERROR,
@@ -120,17 +237,22 @@ main (gint   argc,
     return -1;
   }
 
+  if (trace)
+    gst_player_window_enable_tracer (GST_PLAYER_WINDOW (win));
+
   if (files)
     {
-      GFile* file = g_file_new_for_commandline_arg (files[0]);
-      gchar* uri  = g_file_get_uri (file);
-      gst_player_window_play (GST_PLAYER_WINDOW (win), uri);
-      g_free (uri);
-      g_object_unref (file);
+      for (n = 0; files[n] != NULL; n++)
+        {
+          gchar* uri = arg_to_uri (files[n]);
 
-      if (files[1])
-        g_warning ("%s: cannot handle multiple files to be opened, please only specify one",
-                   g_get_application_name ());
+          if (n == 0)
+            gst_player_window_play (GST_PLAYER_WINDOW (win), uri);
+          else
+            gst_player_window_enqueue (GST_PLAYER_WINDOW (win), uri);
+
+          g_free (uri);
+        }
 
       g_strfreev (files);
     }
@@ -139,5 +261,7 @@ main (gint   argc,
   gtk_widget_show (win);
   gtk_main ();
 
+  cd_detect_shutdown ();
+
   return 0;
 }
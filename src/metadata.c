@@ -0,0 +1,579 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * metadata.c: on-disk media metadata cache. Duration, streams and
+ * tags of local files are kept across runs, keyed by URI, size and
+ * modification time, so the UI can show them while the pipeline is
+ * still prerolling.
+ *
+ * All entries live in one append-only file that is memory-mapped for
+ * reading: a magic string followed by records of a 32-bit payload
+ * length, the hex key and a key file payload. Later records replace
+ * earlier ones with the same key. Only record headers are looked at
+ * when scanning, and only new records are scanned after an append.
+ * Once most of the file is superseded records, it's rewritten.
+ *
+ * Rewriting replaces the file under an exclusive flock() on it, and
+ * records are appended under a shared one. Whoever finds the file at
+ * the path isn't the one they have open anymore reopens it, so no
+ * record goes to a replaced file.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "metadata.h"
+#include "topology.h"
+
+#define METADATA_MAGIC "ALDMETA1"
+#define KEY_LEN 32
+#define HEADER_LEN (sizeof (guint32) + KEY_LEN)
+
+/* don't bother rewriting smaller stores */
+#define COMPACT_SIZE (4 * 1024 * 1024)
+
+static gboolean	store_open	(GstPlayerMetadata *md);
+
+/*
+ * Entries.
+ */
+
+GstPlayerMediaInfo *
+gst_player_media_info_new (void)
+{
+  GstPlayerMediaInfo *info = g_new0 (GstPlayerMediaInfo, 1);
+
+  info->duration = GST_CLOCK_TIME_NONE;
+
+  return info;
+}
+
+void
+gst_player_media_info_free (GstPlayerMediaInfo *info)
+{
+  g_list_foreach (info->streams, (GFunc) gst_player_stream_free, NULL);
+  g_list_free (info->streams);
+  if (info->tags)
+    gst_tag_list_free (info->tags);
+  g_free (info);
+}
+
+static void
+cb_binary_tag (const GstTagList *list,
+	       const gchar      *tag,
+	       gpointer          data)
+{
+  GSList **binary = data;
+
+  if (gst_tag_get_type (tag) == GST_TYPE_BUFFER)
+    *binary = g_slist_prepend (*binary, (gpointer) tag);
+}
+
+static gchar *
+info_serialize (GstPlayerMediaInfo *info)
+{
+  GKeyFile *file = g_key_file_new ();
+  GList *item;
+  gchar *group, *data;
+  gint n;
+
+  if (GST_CLOCK_TIME_IS_VALID (info->duration))
+    g_key_file_set_uint64 (file, "media", "duration", info->duration);
+
+  if (info->tags) {
+    GstTagList *tags = gst_tag_list_copy (info->tags);
+    GSList *binary = NULL, *tag;
+
+    /* cover art and such would bloat the store */
+    gst_tag_list_foreach (tags, cb_binary_tag, &binary);
+    for (tag = binary; tag != NULL; tag = tag->next)
+      gst_tag_list_remove_tag (tags, tag->data);
+    g_slist_free (binary);
+
+    data = gst_structure_to_string ((GstStructure *) tags);
+    g_key_file_set_string (file, "media", "tags", data);
+    g_free (data);
+    gst_tag_list_free (tags);
+  }
+
+  for (n = 0, item = info->streams; item != NULL; n++, item = item->next) {
+    GstPlayerStream *stream = item->data;
+
+    group = g_strdup_printf ("stream%d", n);
+    g_key_file_set_integer (file, group, "type", stream->type);
+    if (stream->caps)
+      g_key_file_set_string (file, group, "caps", stream->caps);
+    if (stream->codec)
+      g_key_file_set_string (file, group, "codec", stream->codec);
+    if (stream->language)
+      g_key_file_set_string (file, group, "language", stream->language);
+    g_key_file_set_integer (file, group, "width", stream->width);
+    g_key_file_set_integer (file, group, "height", stream->height);
+    g_key_file_set_integer (file, group, "fps-n", stream->fps_n);
+    g_key_file_set_integer (file, group, "fps-d", stream->fps_d);
+    g_key_file_set_integer (file, group, "channels", stream->channels);
+    g_key_file_set_integer (file, group, "rate", stream->rate);
+    g_free (group);
+  }
+
+  data = g_key_file_to_data (file, NULL, NULL);
+  g_key_file_free (file);
+
+  return data;
+}
+
+/*
+ * Whether storing a would change anything over b.
+ */
+
+gboolean
+gst_player_media_info_equal (GstPlayerMediaInfo *a,
+			     GstPlayerMediaInfo *b)
+{
+  gchar *sa = info_serialize (a), *sb = info_serialize (b);
+  gboolean res = !strcmp (sa, sb);
+
+  g_free (sa);
+  g_free (sb);
+
+  return res;
+}
+
+static gchar *
+key_string (GKeyFile    *file,
+	    const gchar *group,
+	    const gchar *key)
+{
+  return g_key_file_get_string (file, group, key, NULL);
+}
+
+static GstPlayerMediaInfo *
+info_parse (const gchar *data,
+	    gsize        len)
+{
+  GKeyFile *file = g_key_file_new ();
+  GstPlayerMediaInfo *info;
+  gchar *group, *tags;
+  gint n;
+
+  if (!g_key_file_load_from_data (file, data, len, G_KEY_FILE_NONE, NULL)) {
+    g_key_file_free (file);
+    return NULL;
+  }
+
+  info = gst_player_media_info_new ();
+  if (g_key_file_has_key (file, "media", "duration", NULL))
+    info->duration = g_key_file_get_uint64 (file, "media", "duration", NULL);
+  if ((tags = key_string (file, "media", "tags"))) {
+    GstStructure *s = gst_structure_from_string (tags, NULL);
+
+    if (s && gst_is_tag_list (s))
+      info->tags = (GstTagList *) s;
+    else if (s)
+      gst_structure_free (s);
+    g_free (tags);
+  }
+
+  for (n = 0; ; n++) {
+    GstPlayerStream *stream;
+
+    group = g_strdup_printf ("stream%d", n);
+    if (!g_key_file_has_group (file, group)) {
+      g_free (group);
+      break;
+    }
+
+    stream = g_new0 (GstPlayerStream, 1);
+    stream->type = g_key_file_get_integer (file, group, "type", NULL);
+    stream->caps = key_string (file, group, "caps");
+    stream->codec = key_string (file, group, "codec");
+    stream->language = key_string (file, group, "language");
+    stream->width = g_key_file_get_integer (file, group, "width", NULL);
+    stream->height = g_key_file_get_integer (file, group, "height", NULL);
+    stream->fps_n = g_key_file_get_integer (file, group, "fps-n", NULL);
+    stream->fps_d = g_key_file_get_integer (file, group, "fps-d", NULL);
+    stream->channels = g_key_file_get_integer (file, group, "channels", NULL);
+    stream->rate = g_key_file_get_integer (file, group, "rate", NULL);
+    info->streams = g_list_append (info->streams, stream);
+    g_free (group);
+  }
+  g_key_file_free (file);
+
+  return info;
+}
+
+/*
+ * Key of uri in this and other caches, or NULL if it's not a local
+ * file.
+ */
+
+gchar *
+gst_player_metadata_key (const gchar *uri)
+{
+  GFile *file = g_file_new_for_uri (uri);
+  GFileInfo *info;
+  gchar *str, *key = NULL;
+
+  if (g_file_is_native (file) &&
+      (info = g_file_query_info (file,
+           G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+           G_FILE_ATTRIBUTE_TIME_MODIFIED,
+           G_FILE_QUERY_INFO_NONE, NULL, NULL))) {
+    str = g_strdup_printf ("%s\n%" G_GINT64_FORMAT "\n%" G_GUINT64_FORMAT,
+        uri, (gint64) g_file_info_get_size (info),
+        g_file_info_get_attribute_uint64 (info,
+            G_FILE_ATTRIBUTE_TIME_MODIFIED));
+    key = g_compute_checksum_for_string (G_CHECKSUM_MD5, str, -1);
+    g_free (str);
+    g_object_unref (info);
+  }
+  g_object_unref (file);
+
+  return key;
+}
+
+/*
+ * The store.
+ */
+
+GstPlayerMetadata *
+gst_player_metadata_new (void)
+{
+  GstPlayerMetadata *md = g_new0 (GstPlayerMetadata, 1);
+  gchar *dir;
+
+  md->filename = g_build_filename (g_get_user_cache_dir (), PACKAGE,
+				   "metadata", NULL);
+  md->fd = -1;
+  md->records = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+				       g_free, NULL);
+
+  dir = g_path_get_dirname (md->filename);
+  g_mkdir_with_parents (dir, 0700);
+  g_free (dir);
+
+  return md;
+}
+
+static void
+store_close (GstPlayerMetadata *md)
+{
+  if (md->map) {
+    g_mapped_file_unref (md->map);
+    md->map = NULL;
+  }
+  if (md->fd >= 0) {
+    close (md->fd);
+    md->fd = -1;
+  }
+  g_hash_table_remove_all (md->records);
+  md->scanned = 0;
+  md->stale = 0;
+}
+
+void
+gst_player_metadata_free (GstPlayerMetadata *md)
+{
+  store_close (md);
+  g_hash_table_destroy (md->records);
+  g_free (md->filename);
+  g_free (md);
+}
+
+static gint64
+record_id (const gchar *key)
+{
+  gchar buf[17];
+
+  memcpy (buf, key, 16);
+  buf[16] = '\0';
+
+  return g_ascii_strtoull (buf, NULL, 16);
+}
+
+static gsize
+record_size (const gchar *data)
+{
+  guint32 len;
+
+  memcpy (&len, data, sizeof (len));
+
+  return HEADER_LEN + len;
+}
+
+/*
+ * Indexes the records appended since the last scan. A record that
+ * isn't complete yet is left for the next scan.
+ */
+
+static void
+store_scan (GstPlayerMetadata *md)
+{
+  const gchar *data = g_mapped_file_get_contents (md->map);
+  gsize len = g_mapped_file_get_length (md->map);
+
+  if (md->scanned == 0)
+    md->scanned = strlen (METADATA_MAGIC);
+
+  while (md->scanned + HEADER_LEN <= len &&
+         md->scanned + record_size (data + md->scanned) <= len) {
+    gint64 *id = g_new (gint64, 1);
+    gpointer old;
+
+    *id = record_id (data + md->scanned + sizeof (guint32));
+    if ((old = g_hash_table_lookup (md->records, id)))
+      md->stale += record_size (data + GPOINTER_TO_SIZE (old));
+    g_hash_table_replace (md->records, id, GSIZE_TO_POINTER (md->scanned));
+    md->scanned += record_size (data + md->scanned);
+  }
+}
+
+static gboolean
+store_map (GstPlayerMetadata *md)
+{
+  struct stat st;
+
+  if (fstat (md->fd, &st) < 0)
+    return FALSE;
+  if (md->map && st.st_size == g_mapped_file_get_length (md->map))
+    return TRUE;
+
+  if (md->map)
+    g_mapped_file_unref (md->map);
+  if (!(md->map = g_mapped_file_new (md->filename, FALSE, NULL)))
+    return FALSE;
+  store_scan (md);
+
+  return TRUE;
+}
+
+static void
+cb_compact_record (gpointer key,
+		   gpointer value,
+		   gpointer data)
+{
+  GstPlayerMetadata *md = ((gpointer *) data)[0];
+  GString *str = ((gpointer *) data)[1];
+  const gchar *record = g_mapped_file_get_contents (md->map) +
+      GPOINTER_TO_SIZE (value);
+
+  g_string_append_len (str, record, record_size (record));
+}
+
+/*
+ * Whether the file we have open is still the one at the path, i.e.
+ * no other player rewrote it meanwhile.
+ */
+
+static gboolean
+store_current (GstPlayerMetadata *md)
+{
+  struct stat a, b;
+
+  return fstat (md->fd, &a) == 0 && g_stat (md->filename, &b) == 0 &&
+      a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+}
+
+/*
+ * Writes out only the current records, in one go. Skipped while other
+ * players are appending; one of us will get to it later.
+ */
+
+static void
+store_compact (GstPlayerMetadata *md)
+{
+  GString *str;
+  gpointer data[2];
+
+  if (flock (md->fd, LOCK_EX | LOCK_NB) < 0)
+    return;
+
+  /* pick up what was appended until we got the lock */
+  if (!store_current (md) || !store_map (md)) {
+    flock (md->fd, LOCK_UN);
+    return;
+  }
+
+  str = g_string_new (METADATA_MAGIC);
+  data[0] = md;
+  data[1] = str;
+  g_hash_table_foreach (md->records, cb_compact_record, data);
+  g_file_set_contents (md->filename, str->str, str->len, NULL);
+  g_string_free (str, TRUE);
+
+  flock (md->fd, LOCK_UN);
+  store_close (md);
+  store_open (md);
+}
+
+static gboolean
+store_open (GstPlayerMetadata *md)
+{
+  gchar magic[sizeof (METADATA_MAGIC) - 1];
+  struct stat st;
+
+  if (md->fd >= 0) {
+    if (store_current (md))
+      return store_map (md);
+    store_close (md);
+  }
+
+  if ((md->fd = g_open (md->filename, O_RDWR | O_CREAT | O_APPEND,
+			0600)) < 0)
+    return FALSE;
+
+  /* new or foreign file; another player may be setting it up too */
+  flock (md->fd, LOCK_EX);
+  if (read (md->fd, magic, sizeof (magic)) != sizeof (magic) ||
+      memcmp (magic, METADATA_MAGIC, sizeof (magic)) != 0) {
+    if (ftruncate (md->fd, 0) < 0 ||
+        write (md->fd, METADATA_MAGIC, sizeof (magic)) != sizeof (magic)) {
+      store_close (md);
+      return FALSE;
+    }
+  }
+  flock (md->fd, LOCK_UN);
+
+  if (!store_map (md)) {
+    store_close (md);
+    return FALSE;
+  }
+
+  /* cut off what an earlier crash left half-written, so that new
+   * records line up again; not while others are appending, as their
+   * records may just not be complete yet */
+  if (fstat (md->fd, &st) == 0 && md->scanned < st.st_size &&
+      flock (md->fd, LOCK_EX | LOCK_NB) == 0) {
+    if (store_map (md) && fstat (md->fd, &st) == 0 &&
+        md->scanned < st.st_size && ftruncate (md->fd, md->scanned) == 0) {
+      g_mapped_file_unref (md->map);
+      md->map = NULL;
+    }
+    flock (md->fd, LOCK_UN);
+    if (!md->map && !store_map (md)) {
+      store_close (md);
+      return FALSE;
+    }
+  }
+
+  if (md->scanned > COMPACT_SIZE && md->stale > md->scanned / 2)
+    store_compact (md);
+
+  return md->fd >= 0;
+}
+
+/*
+ * What's known about uri, or NULL. Free with
+ * gst_player_media_info_free().
+ */
+
+GstPlayerMediaInfo *
+gst_player_metadata_lookup (GstPlayerMetadata *md,
+			    const gchar       *uri)
+{
+  GstPlayerMediaInfo *info = NULL;
+  const gchar *record;
+  gchar *key;
+  gint64 id;
+  gpointer offset;
+
+  if (!uri || !(key = gst_player_metadata_key (uri)))
+    return NULL;
+
+  id = record_id (key);
+  if (store_open (md) &&
+      (offset = g_hash_table_lookup (md->records, &id))) {
+    record = g_mapped_file_get_contents (md->map) +
+        GPOINTER_TO_SIZE (offset);
+    if (!memcmp (record + sizeof (guint32), key, KEY_LEN))
+      info = info_parse (record + HEADER_LEN,
+			 record_size (record) - HEADER_LEN);
+  }
+  g_free (key);
+
+  return info;
+}
+
+/*
+ * Remembers info for uri, replacing what was known. The record is
+ * written with a single append, so concurrent players don't mix up
+ * their records.
+ */
+
+void
+gst_player_metadata_store (GstPlayerMetadata  *md,
+			   const gchar        *uri,
+			   GstPlayerMediaInfo *info)
+{
+  GString *record;
+  gchar *key, *payload;
+  guint32 len;
+  gssize res;
+  gboolean locked = FALSE;
+  gint tries;
+
+  if (!uri || !(key = gst_player_metadata_key (uri)))
+    return;
+  for (tries = 0; tries < 3; tries++) {
+    if (!store_open (md))
+      break;
+
+    /* without flock() support there's no telling */
+    if (flock (md->fd, LOCK_SH) < 0 || store_current (md)) {
+      locked = TRUE;
+      break;
+    }
+    flock (md->fd, LOCK_UN);
+    store_close (md);
+  }
+  if (!locked) {
+    g_free (key);
+    return;
+  }
+
+  payload = info_serialize (info);
+  len = strlen (payload);
+  record = g_string_sized_new (HEADER_LEN + len);
+  g_string_append_len (record, (gchar *) &len, sizeof (len));
+  g_string_append_len (record, key, KEY_LEN);
+  g_string_append_len (record, payload, len);
+
+  do {
+    res = write (md->fd, record->str, record->len);
+  } while (res < 0 && errno == EINTR);
+  flock (md->fd, LOCK_UN);
+  if (res >= 0 && res != record->len) {
+    /* a partial record would misalign everything after it */
+    store_close (md);
+  }
+
+  g_string_free (record, TRUE);
+  g_free (payload);
+  g_free (key);
+}
@@ -0,0 +1,75 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * metadata.h: on-disk media metadata cache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __METADATA_H__
+#define __METADATA_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstPlayerMediaInfo {
+  GstClockTime duration;
+
+  /* GstPlayerStream, without pads */
+  GList *streams;
+
+  /* merged tags, without images and other binary data */
+  GstTagList *tags;
+} GstPlayerMediaInfo;
+
+typedef struct _GstPlayerMetadata {
+  gchar *filename;
+  gint fd;
+
+  /* the store as far as it was scanned, and the records in there,
+   * by the first eight bytes of their key -> offset */
+  GMappedFile *map;
+  gsize scanned;
+  GHashTable *records;
+
+  /* bytes in records that were superseded by later ones */
+  gsize stale;
+} GstPlayerMetadata;
+
+GstPlayerMediaInfo *
+		gst_player_media_info_new	(void);
+void		gst_player_media_info_free	(GstPlayerMediaInfo *info);
+gboolean	gst_player_media_info_equal	(GstPlayerMediaInfo *a,
+						 GstPlayerMediaInfo *b);
+
+GstPlayerMetadata *
+		gst_player_metadata_new		(void);
+void		gst_player_metadata_free	(GstPlayerMetadata *md);
+
+GstPlayerMediaInfo *
+		gst_player_metadata_lookup	(GstPlayerMetadata *md,
+						 const gchar       *uri);
+void		gst_player_metadata_store	(GstPlayerMetadata *md,
+						 const gchar       *uri,
+						 GstPlayerMediaInfo *info);
+
+gchar *		gst_player_metadata_key		(const gchar *uri);
+
+G_END_DECLS
+
+#endif /* __METADATA_H__ */
@@ -0,0 +1,299 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * milestones.c: time-to-first-frame instrumentation. Records when a
+ * newly opened stream passes each stage between setting the URI and
+ * showing the first frame.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "milestones.h"
+#include "pipeline.h"
+
+static const gchar *names[GST_PLAYER_MILESTONE_LAST] = {
+  "URI set",
+  "Type found",
+  "Decoders linked",
+  "Prerolled",
+  "First video buffer",
+  "First audio sample",
+  "First expose"
+};
+
+GstPlayerMilestones *
+gst_player_milestones_new (void)
+{
+  GstPlayerMilestones *ms = g_new0 (GstPlayerMilestones, 1);
+  gint n;
+
+  ms->lock = g_mutex_new ();
+  ms->timer = g_timer_new ();
+  for (n = 0; n < GST_PLAYER_MILESTONE_LAST; n++)
+    ms->stamp[n] = -1.;
+  ms->gap = ms->gap_buffer = -1.;
+
+  return ms;
+}
+
+void
+gst_player_milestones_free (GstPlayerMilestones *ms)
+{
+  g_mutex_lock (ms->lock);
+  if (ms->idle_id != 0)
+    g_source_remove (ms->idle_id);
+  g_mutex_unlock (ms->lock);
+
+  g_timer_destroy (ms->timer);
+  g_mutex_free (ms->lock);
+  g_free (ms);
+}
+
+/*
+ * func is called from the main loop, some time after one or more
+ * milestones were reached.
+ */
+
+void
+gst_player_milestones_set_notify (GstPlayerMilestones *ms,
+				  GFunc                func,
+				  gpointer             data)
+{
+  ms->notify = func;
+  ms->notify_data = data;
+}
+
+static gboolean
+cb_notify (gpointer data)
+{
+  GstPlayerMilestones *ms = data;
+
+  g_mutex_lock (ms->lock);
+  ms->idle_id = 0;
+  g_mutex_unlock (ms->lock);
+
+  if (ms->notify)
+    ms->notify (ms, ms->notify_data);
+
+  /* once */
+  return FALSE;
+}
+
+/*
+ * Starts a new session; the URI was just set.
+ */
+
+void
+gst_player_milestones_start (GstPlayerMilestones *ms)
+{
+  gint n;
+
+  g_mutex_lock (ms->lock);
+  for (n = 0; n < GST_PLAYER_MILESTONE_LAST; n++)
+    ms->stamp[n] = -1.;
+  ms->gap = ms->gap_buffer = -1.;
+  g_timer_start (ms->timer);
+  g_mutex_unlock (ms->lock);
+
+  gst_player_milestones_mark (ms, GST_PLAYER_MILESTONE_URI_SET);
+}
+
+/*
+ * Only the first occurence per session counts. Thread-safe.
+ */
+
+void
+gst_player_milestones_mark (GstPlayerMilestones *ms,
+			    GstPlayerMilestone   which)
+{
+  gdouble stamp;
+
+  g_return_if_fail (which < GST_PLAYER_MILESTONE_LAST);
+
+  g_mutex_lock (ms->lock);
+  if (ms->stamp[which] >= 0. ||
+      (which != GST_PLAYER_MILESTONE_URI_SET &&
+       ms->stamp[GST_PLAYER_MILESTONE_URI_SET] < 0.)) {
+    g_mutex_unlock (ms->lock);
+    return;
+  }
+  stamp = ms->stamp[which] = g_timer_elapsed (ms->timer, NULL) * 1000.;
+  if (ms->idle_id == 0)
+    ms->idle_id = g_idle_add (cb_notify, ms);
+  g_mutex_unlock (ms->lock);
+
+  g_printerr ("%s: %s at +%.01lf ms\n",
+	      g_get_prgname (), names[which], stamp);
+}
+
+gdouble
+gst_player_milestones_get (GstPlayerMilestones *ms,
+			   GstPlayerMilestone   which)
+{
+  gdouble stamp;
+
+  g_return_val_if_fail (which < GST_PLAYER_MILESTONE_LAST, -1.);
+
+  g_mutex_lock (ms->lock);
+  stamp = ms->stamp[which];
+  g_mutex_unlock (ms->lock);
+
+  return stamp;
+}
+
+/*
+ * How long the audio output went without samples when switching from
+ * the previous playlist item to this one, in milliseconds, together
+ * with the duration of the first audio buffer of this item. A gapless
+ * switch has a gap well below one buffer. Thread-safe.
+ */
+
+void
+gst_player_milestones_set_gap (GstPlayerMilestones *ms,
+			       gdouble              gap,
+			       gdouble              buffer)
+{
+  gap = MAX (gap, 0.);
+
+  g_mutex_lock (ms->lock);
+  ms->gap = gap;
+  ms->gap_buffer = buffer;
+  if (ms->idle_id == 0)
+    ms->idle_id = g_idle_add (cb_notify, ms);
+  g_mutex_unlock (ms->lock);
+
+  g_printerr ("%s: Gap after previous item %.01lf ms (buffer %.01lf ms)\n",
+	      g_get_prgname (), gap, buffer);
+}
+
+/*
+ * Negative if this item wasn't switched to from a previous one.
+ */
+
+gdouble
+gst_player_milestones_get_gap (GstPlayerMilestones *ms,
+			       gdouble             *buffer)
+{
+  gdouble gap;
+
+  g_mutex_lock (ms->lock);
+  gap = ms->gap;
+  if (buffer)
+    *buffer = ms->gap_buffer;
+  g_mutex_unlock (ms->lock);
+
+  return gap;
+}
+
+const gchar *
+gst_player_milestone_get_name (GstPlayerMilestone which)
+{
+  g_return_val_if_fail (which < GST_PLAYER_MILESTONE_LAST, NULL);
+
+  return names[which];
+}
+
+/*
+ * Hooks into the pipeline.
+ */
+
+static void
+cb_have_type (GstElement *typefind,
+	      guint       probability,
+	      GstCaps    *caps,
+	      gpointer    data)
+{
+  gst_player_milestones_mark (data, GST_PLAYER_MILESTONE_TYPEFIND);
+}
+
+static void
+cb_no_more_pads (GstElement *decodebin,
+		 gpointer    data)
+{
+  gst_player_milestones_mark (data, GST_PLAYER_MILESTONE_DECODERS);
+}
+
+static void
+cb_element (GstElement *element,
+	    gpointer    data)
+{
+  GstElementFactory *factory = gst_element_get_factory (element);
+  const gchar *name;
+
+  if (!factory)
+    return;
+  name = GST_PLUGIN_FEATURE_NAME (factory);
+
+  if (!strcmp (name, "typefind")) {
+    g_signal_connect (element, "have-type",
+        G_CALLBACK (cb_have_type), data);
+  } else if (!strcmp (name, "decodebin") || !strcmp (name, "decodebin2")) {
+    g_signal_connect (element, "no-more-pads",
+        G_CALLBACK (cb_no_more_pads), data);
+  }
+}
+
+static gboolean
+cb_video_buffer (GstPad    *pad,
+		 GstBuffer *buffer,
+		 gpointer   data)
+{
+  gst_player_milestones_mark (data, GST_PLAYER_MILESTONE_VIDEO_BUFFER);
+
+  return TRUE;
+}
+
+static gboolean
+cb_audio_buffer (GstPad    *pad,
+		 GstBuffer *buffer,
+		 gpointer   data)
+{
+  gst_player_milestones_mark (data, GST_PLAYER_MILESTONE_AUDIO_BUFFER);
+
+  return TRUE;
+}
+
+/*
+ * Typefind and decoder milestones come from the elements that playbin
+ * creates, the buffer milestones from probes on the sinks. Prerolling
+ * and exposing are marked by the window and video widget.
+ */
+
+void
+gst_player_milestones_attach (GstPlayerMilestones *ms,
+			      GstElement          *play,
+			      GstElement          *audio,
+			      GstElement          *video)
+{
+  GstPad *pad;
+
+  gst_player_pipeline_watch_elements (play, cb_element, ms);
+
+  if ((pad = gst_element_get_static_pad (video, "sink"))) {
+    gst_pad_add_buffer_probe (pad, G_CALLBACK (cb_video_buffer), ms);
+    gst_object_unref (GST_OBJECT (pad));
+  }
+  if ((pad = gst_element_get_static_pad (audio, "sink"))) {
+    gst_pad_add_buffer_probe (pad, G_CALLBACK (cb_audio_buffer), ms);
+    gst_object_unref (GST_OBJECT (pad));
+  }
+}
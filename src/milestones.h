@@ -0,0 +1,83 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * milestones.h: time-to-first-frame instrumentation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __MILESTONES_H__
+#define __MILESTONES_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_PLAYER_MILESTONE_URI_SET = 0,
+  GST_PLAYER_MILESTONE_TYPEFIND,
+  GST_PLAYER_MILESTONE_DECODERS,
+  GST_PLAYER_MILESTONE_PREROLL,
+  GST_PLAYER_MILESTONE_VIDEO_BUFFER,
+  GST_PLAYER_MILESTONE_AUDIO_BUFFER,
+  GST_PLAYER_MILESTONE_EXPOSE,
+  GST_PLAYER_MILESTONE_LAST
+} GstPlayerMilestone;
+
+typedef struct _GstPlayerMilestones {
+  GMutex *lock;
+  GTimer *timer;
+
+  /* milliseconds since the URI was set, negative if not reached yet */
+  gdouble stamp[GST_PLAYER_MILESTONE_LAST];
+
+  /* for playlist items: silence after the previous item and the
+   * duration of the first audio buffer, in milliseconds, or negative */
+  gdouble gap, gap_buffer;
+
+  /* main loop notification */
+  GFunc notify;
+  gpointer notify_data;
+  guint idle_id;
+} GstPlayerMilestones;
+
+GstPlayerMilestones *
+		gst_player_milestones_new	(void);
+void		gst_player_milestones_free	(GstPlayerMilestones *ms);
+void		gst_player_milestones_set_notify (GstPlayerMilestones *ms,
+						 GFunc      func,
+						 gpointer   data);
+void		gst_player_milestones_attach	(GstPlayerMilestones *ms,
+						 GstElement *play,
+						 GstElement *audio,
+						 GstElement *video);
+
+void		gst_player_milestones_start	(GstPlayerMilestones *ms);
+void		gst_player_milestones_mark	(GstPlayerMilestones *ms,
+						 GstPlayerMilestone which);
+gdouble		gst_player_milestones_get	(GstPlayerMilestones *ms,
+						 GstPlayerMilestone which);
+void		gst_player_milestones_set_gap	(GstPlayerMilestones *ms,
+						 gdouble    gap,
+						 gdouble    buffer);
+gdouble		gst_player_milestones_get_gap	(GstPlayerMilestones *ms,
+						 gdouble   *buffer);
+const gchar *	gst_player_milestone_get_name	(GstPlayerMilestone which);
+
+G_END_DECLS
+
+#endif /* __MILESTONES_H__ */
@@ -0,0 +1,275 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * performance.c: performance figures display
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnome.h>
+
+#include "performance.h"
+
+#define RESPONSE_SAVE 1
+
+static void	gst_player_performance_class_init (GstPlayerPerformanceClass *klass);
+static void	gst_player_performance_init	(GstPlayerPerformance *perf);
+static void	gst_player_performance_dispose	(GObject   *object);
+
+static void	gst_player_performance_response	(GtkDialog *dialog,
+						 gint       response_id);
+
+static GtkDialogClass *parent_class = NULL;
+
+GType
+gst_player_performance_get_type (void)
+{
+  static GType gst_player_performance_type = 0;
+
+  if (!gst_player_performance_type) {
+    static const GTypeInfo gst_player_performance_info = {
+      sizeof (GstPlayerPerformanceClass),
+      NULL,
+      NULL,
+      (GClassInitFunc) gst_player_performance_class_init,
+      NULL,
+      NULL,
+      sizeof (GstPlayerPerformance),
+      0,
+      (GInstanceInitFunc) gst_player_performance_init,
+      NULL
+    };
+
+    gst_player_performance_type =
+	g_type_register_static (GTK_TYPE_DIALOG, 
+				"GstPlayerPerformance",
+				&gst_player_performance_info, 0);
+  }
+
+  return gst_player_performance_type;
+}
+
+static void
+gst_player_performance_class_init (GstPlayerPerformanceClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GtkDialogClass *gtkdialog_class = GTK_DIALOG_CLASS (klass);
+
+  parent_class = g_type_class_ref (GTK_TYPE_DIALOG);
+
+  gobject_class->dispose = gst_player_performance_dispose;
+  gtkdialog_class->response = gst_player_performance_response;
+}
+
+static void
+gst_player_performance_init (GstPlayerPerformance *perf)
+{
+  GtkWidget *scroll, *view;
+  PangoFontDescription *font;
+
+  perf->timeout_id = 0;
+  perf->tracer = NULL;
+  perf->timer = NULL;
+  perf->stats = NULL;
+  perf->video = NULL;
+
+  gtk_window_set_title (GTK_WINDOW (perf),
+			_("Performance"));
+  gtk_container_set_border_width (GTK_CONTAINER (perf), 6);
+  gtk_window_set_default_size (GTK_WINDOW (perf), 600, 300);
+
+  /* buttons */
+  gtk_dialog_add_button (GTK_DIALOG (perf),
+			 GTK_STOCK_SAVE, RESPONSE_SAVE);
+  gtk_dialog_add_button (GTK_DIALOG (perf),
+			 GTK_STOCK_CLOSE, GTK_RESPONSE_CLOSE);
+  gtk_box_set_spacing (GTK_BOX (GTK_DIALOG (perf)->vbox), 6);
+
+  /* figures */
+  scroll = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scroll),
+				  GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scroll),
+				       GTK_SHADOW_IN);
+  view = gtk_text_view_new ();
+  gtk_text_view_set_editable (GTK_TEXT_VIEW (view), FALSE);
+  gtk_text_view_set_cursor_visible (GTK_TEXT_VIEW (view), FALSE);
+  font = pango_font_description_from_string ("Monospace");
+  gtk_widget_modify_font (view, font);
+  pango_font_description_free (font);
+  perf->buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (view));
+  gtk_container_add (GTK_CONTAINER (scroll), view);
+  gtk_widget_show (view);
+  gtk_box_pack_start (GTK_BOX (GTK_DIALOG (perf)->vbox),
+		      scroll, TRUE, TRUE, 0);
+  gtk_widget_show (scroll);
+}
+
+/*
+ * Text form of everything shown, for pasting into bug reports.
+ */
+
+gchar *
+gst_player_performance_snapshot (GstPlayerPerformance *perf)
+{
+  GString *str = g_string_new (NULL);
+
+  g_return_val_if_fail (GST_PLAYER_IS_PERFORMANCE (perf), NULL);
+
+  if (perf->timer) {
+    g_string_append_printf (str, _("Progress wakeups: %.01f/s\n"),
+			    gst_player_timer_get_wakeup_rate (perf->timer));
+    g_string_append_printf (str, _("Progress queries: %.01f/s\n\n"),
+			    gst_player_timer_get_query_rate (perf->timer));
+    if (perf->timer->seek) {
+      gchar *dump = gst_player_seek_dump (perf->timer->seek);
+
+      g_string_append_printf (str, _("Seeking:\n%s\n"), dump);
+      g_free (dump);
+    }
+  }
+
+  if (perf->stats) {
+    gchar *dump = gst_player_sink_stats_dump (perf->stats);
+
+    g_string_append_printf (str, _("Video output:\n%s\n"), dump);
+    g_free (dump);
+  }
+
+  if (perf->video) {
+    gchar *dump = gst_player_video_dump (perf->video);
+
+    g_string_append_printf (str, _("Video window:\n%s\n"), dump);
+    g_free (dump);
+  }
+
+  if (perf->tracer) {
+    gchar *dump = gst_player_tracer_dump (perf->tracer);
+
+    g_string_append_printf (str, _("Per-element buffer times (usec):\n%s"),
+			    dump);
+    g_free (dump);
+  } else {
+    g_string_append (str, _("Per-element figures are only collected "
+			    "when started with --trace.\n"));
+  }
+
+  return g_string_free (str, FALSE);
+}
+
+static gboolean
+cb_refresh (gpointer data)
+{
+  GstPlayerPerformance *perf = GST_PLAYER_PERFORMANCE (data);
+  gchar *text = gst_player_performance_snapshot (perf);
+
+  gtk_text_buffer_set_text (perf->buffer, text, -1);
+  g_free (text);
+
+  return TRUE;
+}
+
+GtkWidget *
+gst_player_performance_new (GstPlayerTracer    *tracer,
+			    GstPlayerTimer     *timer,
+			    GstPlayerSinkStats *stats,
+			    GstPlayerVideo     *video)
+{
+  GstPlayerPerformance *perf;
+
+  perf = g_object_new (GST_PLAYER_TYPE_PERFORMANCE, NULL);
+  perf->tracer = tracer;
+  perf->timer = timer;
+  perf->stats = stats;
+  perf->video = video;
+
+  cb_refresh (perf);
+  perf->timeout_id = g_timeout_add (1000, cb_refresh, perf);
+
+  return GTK_WIDGET (perf);
+}
+
+static void
+gst_player_performance_dispose (GObject *object)
+{
+  GstPlayerPerformance *perf = GST_PLAYER_PERFORMANCE (object);
+
+  if (perf->timeout_id != 0) {
+    g_source_remove (perf->timeout_id);
+    perf->timeout_id = 0;
+  }
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
+}
+
+static void
+save_snapshot (GstPlayerPerformance *perf)
+{
+  GtkWidget *filesel;
+  GError *error = NULL;
+
+  filesel = gtk_file_chooser_dialog_new (_("Save snapshot"),
+					 GTK_WINDOW (perf),
+					 GTK_FILE_CHOOSER_ACTION_SAVE,
+					 GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+					 GTK_STOCK_SAVE, GTK_RESPONSE_OK,
+					 NULL);
+  gtk_widget_show (filesel);
+  if (gtk_dialog_run (GTK_DIALOG (filesel)) == GTK_RESPONSE_OK) {
+    gchar *filename, *text;
+
+    filename = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (filesel));
+    text = gst_player_performance_snapshot (perf);
+    if (!g_file_set_contents (filename, text, -1, &error)) {
+      GtkWidget *dialog;
+
+      dialog = gtk_message_dialog_new (GTK_WINDOW (perf),
+                                       GTK_DIALOG_DESTROY_WITH_PARENT,
+                                       GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE,
+                                       "%s", error->message);
+      gtk_widget_show (dialog);
+      gtk_dialog_run (GTK_DIALOG (dialog));
+      gtk_widget_destroy (dialog);
+      g_error_free (error);
+    }
+    g_free (text);
+    g_free (filename);
+  }
+  gtk_widget_destroy (filesel);
+}
+
+static void
+gst_player_performance_response (GtkDialog *dialog,
+				 gint       response_id)
+{
+  switch (response_id) {
+    case RESPONSE_SAVE:
+      save_snapshot (GST_PLAYER_PERFORMANCE (dialog));
+      break;
+    case GTK_RESPONSE_CLOSE:
+      gtk_widget_destroy (GTK_WIDGET (dialog));
+      break;
+    default:
+      break;
+  }
+
+  if (parent_class->response)
+    parent_class->response (dialog, response_id);
+}
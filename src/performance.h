@@ -0,0 +1,75 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * performance.h: performance figures display.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __PERFORMANCE_H__
+#define __PERFORMANCE_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gdk/gdk.h>
+#include <gtk/gtkdialog.h>
+#include <gtk/gtktextbuffer.h>
+
+#include "sink.h"
+#include "timer.h"
+#include "tracer.h"
+#include "video.h"
+
+G_BEGIN_DECLS
+
+#define GST_PLAYER_TYPE_PERFORMANCE \
+  (gst_player_performance_get_type())
+#define GST_PLAYER_PERFORMANCE(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_PLAYER_TYPE_PERFORMANCE, GstPlayerPerformance))
+#define GST_PLAYER_PERFORMANCE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), GST_PLAYER_TYPE_PERFORMANCE, GstPlayerPerformanceClass))
+#define GST_PLAYER_IS_PERFORMANCE(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_PLAYER_TYPE_PERFORMANCE))
+#define GST_PLAYER_IS_PERFORMANCE_CLASS(obj) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_PLAYER_TYPE_PERFORMANCE))
+
+typedef struct _GstPlayerPerformance {
+  GtkDialog parent;
+
+  GtkTextBuffer *buffer;
+  guint timeout_id;
+
+  /* sources */
+  GstPlayerTracer *tracer;
+  GstPlayerTimer *timer;
+  GstPlayerSinkStats *stats;
+  GstPlayerVideo *video;
+} GstPlayerPerformance;
+
+typedef struct _GstPlayerPerformanceClass {
+  GtkDialogClass klass;
+} GstPlayerPerformanceClass;
+
+GType		gst_player_performance_get_type	(void);
+GtkWidget *	gst_player_performance_new	(GstPlayerTracer *tracer,
+						 GstPlayerTimer  *timer,
+						 GstPlayerSinkStats *stats,
+						 GstPlayerVideo  *video);
+gchar *		gst_player_performance_snapshot	(GstPlayerPerformance *perf);
+
+G_END_DECLS
+
+#endif /* __PERFORMANCE_H__ */
@@ -0,0 +1,210 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * pipeline.c: playback pipeline setup.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib/gi18n.h>
+
+#include "pipeline.h"
+
+GQuark
+gst_player_error_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (quark == 0)
+    quark = g_quark_from_static_string ("gst-player-error-quark");
+
+  return quark;
+}
+
+/*
+ * Creates the playbin with the given sinks and brings it to READY.
+ * Takes ownership of both sinks, also on failure. Prefers playbin2,
+ * which can preroll the next item while the current one plays (see
+ * its "about-to-finish" signal).
+ */
+
+GstElement *
+gst_player_pipeline_new (GstElement *audio,
+			 GstElement *video,
+			 GError    **err)
+{
+  GstElement *play;
+
+  if (!(play = gst_element_factory_make ("playbin2", "player")) &&
+      !(play = gst_element_factory_make ("playbin", "player"))) {
+    g_set_error (err, GST_PLAYER_ERROR, 1,
+		 _("Failed to create playbin element"));
+    gst_object_unref (GST_OBJECT (audio));
+    gst_object_unref (GST_OBJECT (video));
+    return NULL;
+  }
+
+  g_object_set (play, "audio-sink", audio, "video-sink", video, NULL);
+
+  if (gst_element_set_state (GST_ELEMENT (play),
+			     GST_STATE_READY) == GST_STATE_CHANGE_FAILURE) {
+    g_set_error (err, GST_PLAYER_ERROR, 1,
+		 _("Failed to set player to initial ready state - fatal"));
+    gst_object_unref (GST_OBJECT (play));
+    return NULL;
+  }
+
+  return play;
+}
+
+/*
+ * Calls func for every element inside play, recursively, both for
+ * what is there now and for everything that is added later. Note that
+ * func is mostly called from streaming threads.
+ */
+
+struct _GstPlayerElementWatch {
+  GstPlayerElementFunc func;
+  gpointer data;
+};
+
+static void	cb_element_added		(GstBin     *bin,
+						 GstElement *element,
+						 gpointer    data);
+
+static void
+watch_bin (GstBin                *bin,
+	   GstPlayerElementWatch *watch)
+{
+  GstIterator *it;
+  gpointer item;
+  gboolean done = FALSE;
+
+  g_signal_connect (bin, "element-added",
+      G_CALLBACK (cb_element_added), watch);
+
+  it = gst_bin_iterate_elements (bin);
+  while (!done) {
+    switch (gst_iterator_next (it, &item)) {
+      case GST_ITERATOR_OK:
+        cb_element_added (bin, GST_ELEMENT (item), watch);
+        gst_object_unref (GST_OBJECT (item));
+        break;
+      case GST_ITERATOR_RESYNC:
+        gst_iterator_resync (it);
+        break;
+      default:
+        done = TRUE;
+        break;
+    }
+  }
+  gst_iterator_free (it);
+}
+
+static void
+cb_element_added (GstBin     *bin,
+		  GstElement *element,
+		  gpointer    data)
+{
+  GstPlayerElementWatch *watch = data;
+
+  watch->func (element, watch->data);
+
+  if (GST_IS_BIN (element))
+    watch_bin (GST_BIN (element), watch);
+}
+
+static void
+cb_watch_free (gpointer data,
+	       GObject *where_the_object_was)
+{
+  g_free (data);
+}
+
+/*
+ * The watch lives as long as play does, unless it is dropped earlier
+ * with gst_player_pipeline_unwatch_elements().
+ */
+
+GstPlayerElementWatch *
+gst_player_pipeline_watch_elements (GstElement          *play,
+				    GstPlayerElementFunc func,
+				    gpointer             data)
+{
+  GstPlayerElementWatch *watch;
+
+  g_return_val_if_fail (GST_IS_BIN (play), NULL);
+  g_return_val_if_fail (func != NULL, NULL);
+
+  watch = g_new (GstPlayerElementWatch, 1);
+  watch->func = func;
+  watch->data = data;
+  g_object_weak_ref (G_OBJECT (play), cb_watch_free, watch);
+
+  watch_bin (GST_BIN (play), watch);
+
+  return watch;
+}
+
+static void
+unwatch_bin (GstBin                *bin,
+	     GstPlayerElementWatch *watch)
+{
+  GstIterator *it;
+  gpointer item;
+  gboolean done = FALSE;
+
+  g_signal_handlers_disconnect_by_func (bin, cb_element_added, watch);
+
+  it = gst_bin_iterate_elements (bin);
+  while (!done) {
+    switch (gst_iterator_next (it, &item)) {
+      case GST_ITERATOR_OK:
+        if (GST_IS_BIN (item))
+          unwatch_bin (GST_BIN (item), watch);
+        gst_object_unref (GST_OBJECT (item));
+        break;
+      case GST_ITERATOR_RESYNC:
+        gst_iterator_resync (it);
+        break;
+      default:
+        done = TRUE;
+        break;
+    }
+  }
+  gst_iterator_free (it);
+}
+
+/*
+ * Stops calling the watch's func and frees the watch. play should
+ * not be changing meanwhile, i.e. not be running.
+ */
+
+void
+gst_player_pipeline_unwatch_elements (GstElement            *play,
+				      GstPlayerElementWatch *watch)
+{
+  g_return_if_fail (GST_IS_BIN (play));
+  g_return_if_fail (watch != NULL);
+
+  unwatch_bin (GST_BIN (play), watch);
+  g_object_weak_unref (G_OBJECT (play), cb_watch_free, watch);
+  g_free (watch);
+}
@@ -0,0 +1,52 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * pipeline.h: playback pipeline setup.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_PLAYER_ERROR \
+  (gst_player_error_quark ())
+
+typedef void (* GstPlayerElementFunc) (GstElement *element,
+				       gpointer    data);
+
+typedef struct _GstPlayerElementWatch GstPlayerElementWatch;
+
+GQuark		gst_player_error_quark		(void);
+
+GstElement *	gst_player_pipeline_new		(GstElement *audio,
+						 GstElement *video,
+						 GError    **err);
+GstPlayerElementWatch *
+		gst_player_pipeline_watch_elements (GstElement *play,
+						 GstPlayerElementFunc func,
+						 gpointer    data);
+void		gst_player_pipeline_unwatch_elements (GstElement *play,
+						 GstPlayerElementWatch *watch);
+
+G_END_DECLS
+
+#endif /* __PIPELINE_H__ */
@@ -29,10 +29,30 @@
 
 static void	gst_player_properties_class_init (GstPlayerPropertiesClass *klass);
 static void	gst_player_properties_init	(GstPlayerProperties *props);
+static void	gst_player_properties_finalize	(GObject   *object);
 
 static void	gst_player_properties_response	(GtkDialog *dialog,
 						 gint       response_id);
 
+/*
+ * The dialog is a list of sections with rows of name/value labels.
+ * Rows are created once, and afterwards only have their value updated
+ * or are hidden when they don't apply anymore.
+ */
+
+enum {
+  SECTION_STREAM = 0,
+  SECTION_VIDEO,
+  SECTION_AUDIO,
+  SECTION_TIMING
+};
+
+typedef struct _GstPlayerPropertiesRow {
+  gint section;
+  GtkWidget *name, *value;
+  gboolean seen;
+} GstPlayerPropertiesRow;
+
 static GtkDialogClass *parent_class = NULL;
 
 GType
@@ -66,17 +86,47 @@ gst_player_properties_get_type (void)
 static void
 gst_player_properties_class_init (GstPlayerPropertiesClass *klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GtkDialogClass *gtkdialog_class = GTK_DIALOG_CLASS (klass);
 
   parent_class = g_type_class_ref (GTK_TYPE_DIALOG);
 
+  gobject_class->finalize = gst_player_properties_finalize;
   gtkdialog_class->response = gst_player_properties_response;
 }
 
+static GtkWidget *
+section_new (GstPlayerProperties *props,
+	     const gchar         *title)
+{
+  GtkWidget *box, *label, *table;
+
+  box = gtk_vbox_new (FALSE, 0);
+
+  label = gtk_label_new (title);
+  gtk_label_set_use_markup (GTK_LABEL (label), TRUE);
+  gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
+  gtk_box_pack_start (GTK_BOX (box), label, FALSE, FALSE, 0);
+  gtk_widget_show (label);
+
+  table = gtk_table_new (1, 2, FALSE);
+  gtk_table_set_col_spacings (GTK_TABLE (table), 0);
+  gtk_table_set_row_spacings (GTK_TABLE (table), 0);
+  gtk_box_pack_start (GTK_BOX (box), table, FALSE, FALSE, 0);
+  gtk_widget_show (table);
+  g_object_set_data (G_OBJECT (box), "table", table);
+
+  gtk_box_pack_start (GTK_BOX (props->content), box, FALSE, FALSE, 0);
+
+  return box;
+}
+
 static void
 gst_player_properties_init (GstPlayerProperties *props)
 {
-  props->content = NULL;
+  props->milestones = NULL;
+  props->rows = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, g_free);
 
   gtk_window_set_title (GTK_WINDOW (props),
 			_("Stream properties"));
@@ -86,6 +136,35 @@ gst_player_properties_init (GstPlayerProperties *props)
   gtk_dialog_add_button (GTK_DIALOG (props),
 			 GTK_STOCK_CLOSE, GTK_RESPONSE_CLOSE);
   gtk_box_set_spacing (GTK_BOX (GTK_DIALOG (props)->vbox), 6);
+
+  /* contents */
+  props->content = gtk_vbox_new (FALSE, 12);
+  gtk_box_pack_start (GTK_BOX (GTK_DIALOG (props)->vbox),
+		      props->content, TRUE, TRUE, 0);
+  gtk_widget_show (props->content);
+
+  props->empty = gtk_label_new (_("No media loaded."));
+  gtk_box_pack_start (GTK_BOX (props->content), props->empty,
+		      TRUE, TRUE, 0);
+
+  props->sections[SECTION_STREAM] =
+      section_new (props, _("<b>Stream information</b>"));
+  props->sections[SECTION_VIDEO] =
+      section_new (props, _("<b>Video information</b>"));
+  props->sections[SECTION_AUDIO] =
+      section_new (props, _("<b>Audio information</b>"));
+  props->sections[SECTION_TIMING] =
+      section_new (props, _("<b>Opening time</b>"));
+}
+
+static void
+gst_player_properties_finalize (GObject *object)
+{
+  GstPlayerProperties *props = GST_PLAYER_PROPERTIES (object);
+
+  g_hash_table_destroy (props->rows);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 GtkWidget *
@@ -99,6 +178,20 @@ gst_player_properties_new (void)
   return GTK_WIDGET (props);
 }
 
+/*
+ * Shows the time-to-first-frame milestones of the current session.
+ * Call gst_player_properties_update() afterwards to refresh.
+ */
+
+void
+gst_player_properties_set_milestones (GstPlayerProperties *props,
+				      GstPlayerMilestones *ms)
+{
+  g_return_if_fail (GST_PLAYER_IS_PROPERTIES (props));
+
+  props->milestones = ms;
+}
+
 static void
 gst_player_properties_response (GtkDialog *dialog,
 				gint       response_id)
@@ -115,177 +208,259 @@ gst_player_properties_response (GtkDialog *dialog,
     parent_class->response (dialog, response_id);
 }
 
+/*
+ * Sets the row identified by key to the given name/value, creating it
+ * at the end of its section if it didn't exist yet. Labels are only
+ * touched if their text changed.
+ */
+
+static void
+set_row (GstPlayerProperties *props,
+	 gint                 section,
+	 const gchar         *key,
+	 const gchar         *name,
+	 const gchar         *value)
+{
+  GstPlayerPropertiesRow *row = g_hash_table_lookup (props->rows, key);
+
+  if (!row) {
+    GtkWidget *table =
+        g_object_get_data (G_OBJECT (props->sections[section]), "table");
+    guint n_rows = GTK_TABLE (table)->nrows;
+
+    /* a new table has one empty row to begin with */
+    if (g_object_get_data (G_OBJECT (table), "used"))
+      gtk_table_resize (GTK_TABLE (table), ++n_rows, 2);
+    g_object_set_data (G_OBJECT (table), "used", GINT_TO_POINTER (TRUE));
+
+    row = g_new0 (GstPlayerPropertiesRow, 1);
+    row->section = section;
+    row->name = gtk_label_new (NULL);
+    gtk_misc_set_alignment (GTK_MISC (row->name), 0.0, 0.5);
+    if (value) {
+      row->value = gtk_label_new (NULL);
+      gtk_misc_set_alignment (GTK_MISC (row->value), 0.0, 0.5);
+      gtk_table_attach_defaults (GTK_TABLE (table), row->name,
+				 0, 1, n_rows - 1, n_rows);
+      gtk_table_attach_defaults (GTK_TABLE (table), row->value,
+				 1, 2, n_rows - 1, n_rows);
+    } else {
+      gtk_table_attach_defaults (GTK_TABLE (table), row->name,
+				 0, 2, n_rows - 1, n_rows);
+    }
+    g_hash_table_insert (props->rows, g_strdup (key), row);
+  }
+
+  if (strcmp (gtk_label_get_text (GTK_LABEL (row->name)), name))
+    gtk_label_set_text (GTK_LABEL (row->name), name);
+  if (row->value && value &&
+      strcmp (gtk_label_get_text (GTK_LABEL (row->value)), value))
+    gtk_label_set_text (GTK_LABEL (row->value), value);
+
+  if (!row->seen) {
+    gtk_widget_show (row->name);
+    if (row->value)
+      gtk_widget_show (row->value);
+    row->seen = TRUE;
+  }
+}
+
+/*
+ * Keeps a row that's still shown as it is.
+ */
+
+static gboolean
+keep_row (GstPlayerProperties *props,
+	  const gchar         *key)
+{
+  GstPlayerPropertiesRow *row = g_hash_table_lookup (props->rows, key);
+
+  if (!row || !GTK_WIDGET_VISIBLE (row->name))
+    return FALSE;
+  row->seen = TRUE;
+
+  return TRUE;
+}
+
+/*
+ * Tags that didn't change since they were last shown aren't looked at
+ * again.
+ */
+
+static void
+set_tag_row (GstPlayerProperties *props,
+	     gint                 section,
+	     GstPlayerTags       *tags,
+	     const gchar         *tag,
+	     gboolean            *found)
+{
+  gchar *str, *name;
+
+  if (!tags)
+    return;
+  if (!gst_player_tags_is_dirty (tags, tag) && keep_row (props, tag)) {
+    if (found)
+      *found = TRUE;
+    return;
+  }
+  if (!gst_player_tags_get_string (tags, tag, &str))
+    return;
+
+  name = g_strdup_printf (_("  %s: "), gst_tag_get_nick (tag));
+  set_row (props, section, tag, name, str);
+  g_free (name);
+  g_free (str);
+
+  if (found)
+    *found = TRUE;
+}
+
+/*
+ * Codec from the tags, or as guessed by playbin if there's none.
+ */
+
+static void
+set_codec_row (GstPlayerProperties *props,
+	       gint                 section,
+	       GstPlayerTags       *tags,
+	       const gchar         *tag,
+	       const gchar         *codec)
+{
+  gchar *name, *str = NULL;
+
+  /* the fallback may change without the tag changing, so this row is
+   * always refreshed */
+  if (tags)
+    gst_player_tags_get_string (tags, tag, &str);
+  if (!str && !codec)
+    return;
+
+  name = g_strdup_printf (_("  %s: "), gst_tag_get_nick (tag));
+  set_row (props, section, tag, name, str ? str : codec);
+  g_free (name);
+  g_free (str);
+}
+
+static void
+cb_reset_row (gpointer key,
+	      gpointer value,
+	      gpointer data)
+{
+  GstPlayerPropertiesRow *row = value;
+
+  row->seen = FALSE;
+}
+
+static void
+cb_finish_row (gpointer key,
+	       gpointer value,
+	       gpointer data)
+{
+  GstPlayerPropertiesRow *row = value;
+  gboolean *used = data;
+
+  if (row->seen) {
+    used[row->section] = TRUE;
+  } else if (GTK_WIDGET_VISIBLE (row->name)) {
+    gtk_widget_hide (row->name);
+    if (row->value)
+      gtk_widget_hide (row->value);
+  }
+}
+
 void
 gst_player_properties_update (GstPlayerProperties *props,
-			      GstElement *play,
-			      const GstTagList *taglist)
+			      GstPlayerTopology   *topo,
+			      GstPlayerTags       *tags)
 {
-  GtkWidget *label;
-  GList *streaminfo = NULL;
-  gboolean have_video = FALSE, have_audio = FALSE, have_metadata = FALSE;
+  const GstPlayerStream *video, *audio;
+  gboolean have_metadata = FALSE;
+  gboolean used[G_N_ELEMENTS (props->sections)] = { FALSE, };
   gchar *str;
-  gchar *str2;
-  gdouble fps = 0.;
-  gint width = 0, height = 0, rate = 0, channels = 0, pos = 0, n;
+  gint n;
+  gdouble stamp, buffer;
   const gchar *tgl[] = { GST_TAG_ARTIST, GST_TAG_TITLE, GST_TAG_ALBUM,
       GST_TAG_GENRE, GST_TAG_COMMENT, NULL };
 
-  if (props->content) {
-    gtk_widget_destroy (props->content);
-  }
+  g_hash_table_foreach (props->rows, cb_reset_row, NULL);
 
-  if (!play || GST_STATE (play) <= GST_STATE_READY) {
-    props->content = gtk_label_new (_("No media loaded."));
-    gtk_box_pack_start (GTK_BOX (GTK_DIALOG (props)->vbox),
-			props->content, TRUE, TRUE, 0);
-    gtk_widget_show (props->content);
+  if (!topo || !gst_player_topology_get_streams (topo)) {
+    g_hash_table_foreach (props->rows, cb_finish_row, used);
+    for (n = 0; n < G_N_ELEMENTS (props->sections); n++)
+      gtk_widget_hide (props->sections[n]);
+    gtk_widget_show (props->empty);
     return;
   }
+  gtk_widget_hide (props->empty);
 
-  /* get metadata and streaminfo */
-  g_object_get (G_OBJECT (play), "stream-info",
-		&streaminfo, NULL);
-  for ( ; streaminfo != NULL; streaminfo = streaminfo->next) {
-    GObject *info = streaminfo->data;
-    gint type;
-    GParamSpec *pspec;
-    GEnumValue *val;
-    GstPad *pad = NULL;
-    GstStructure *s = NULL;
-
-    g_object_get (info, "type", &type, NULL);
-    pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (info), "type");
-    val = g_enum_get_value (G_PARAM_SPEC_ENUM (pspec)->enum_class, type);
-    g_object_get (info, "object", &pad, NULL);
-    if (pad && GST_IS_PAD (pad) && GST_PAD_CAPS (pad)) {
-      s = gst_caps_get_structure (GST_PAD_CAPS (pad), 0);
-    }
+  video = gst_player_topology_get_stream (topo, GST_PLAYER_STREAM_VIDEO);
+  audio = gst_player_topology_get_stream (topo, GST_PLAYER_STREAM_AUDIO);
 
-    if (strstr (val->value_name, "AUDIO")) {
-      have_audio = TRUE;
-      gst_structure_get_int (s, "channels", &channels);
-      gst_structure_get_int (s, "rate", &rate);
-    } else if (strstr (val->value_name, "VIDEO")) {
-      have_video = TRUE;
-      gst_structure_get_int (s, "width", &width);
-      gst_structure_get_int (s, "height", &height);
-      gst_structure_get_double (s, "framerate", &fps);
-    }
+  /* general metadata */
+  for (n = 0; tgl[n] != NULL; n++)
+    set_tag_row (props, SECTION_STREAM, tags, tgl[n], &have_metadata);
+  if (!have_metadata) {
+    set_row (props, SECTION_STREAM, "no-metadata",
+	     _("  No stream information found"), NULL);
   }
 
-  props->content = gtk_table_new (2, 1, FALSE);
-  gtk_table_set_col_spacings (GTK_TABLE (props->content), 0);
-  gtk_table_set_row_spacings (GTK_TABLE (props->content), 0);
-
-#define attach(t, w, x1, x2, y) \
-  do { \
-    gtk_table_attach_defaults (GTK_TABLE (t), w, x1, x2, y, y + 1); \
-    y++; \
-    gtk_widget_show (w); \
-  } while (0);
+  if (video) {
+    str = g_strdup_printf (_("%dx%d at %.02lf fps"),
+			   video->width, video->height, video->fps_d ?
+			   (gdouble) video->fps_n / video->fps_d : 0.);
+    set_row (props, SECTION_VIDEO, "video-size",
+	     _("  Video size/framerate: "), str);
+    g_free (str);
 
-  /* general metadata */
-  label = gtk_label_new (_("<b>Stream information</b>"));
-  gtk_label_set_use_markup (GTK_LABEL (label), TRUE);
-  gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-  attach (props->content, label, 0, 2, pos);
-  gtk_widget_show (label);
-
-  if (taglist) {
-    for (n = 0; tgl[n] != NULL; n++) {
-      if (gst_tag_list_get_string (taglist, tgl[n], &str)) {
-        str2 = g_strdup_printf (_("  %s: "), gst_tag_get_nick (tgl[n]));
-        label = gtk_label_new (str2);
-        gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-        g_free (str2);
-        attach (props->content, label, 0, 1, pos);
-        pos--;
-        label = gtk_label_new (str);
-        gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-        attach (props->content, label, 1, 2, pos);
-        have_metadata = TRUE;
-      }
-    }
+    set_codec_row (props, SECTION_VIDEO, tags, GST_TAG_VIDEO_CODEC,
+		   video->codec);
   }
-  if (!have_metadata) {
-    label = gtk_label_new (_("  No stream information found"));
-    gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-    attach (props->content, label, 0, 2, pos);
+
+  if (audio) {
+    str = g_strdup_printf (_("%d channels at %d Hz"),
+			   audio->channels, audio->rate);
+    set_row (props, SECTION_AUDIO, "audio-format",
+	     _("  Audio channels/samplerate: "), str);
+    g_free (str);
+
+    set_codec_row (props, SECTION_AUDIO, tags, GST_TAG_AUDIO_CODEC,
+		   audio->codec);
+    if (audio->language)
+      set_row (props, SECTION_AUDIO, "audio-language",
+	       _("  Language: "), audio->language);
   }
 
-  if (have_video) {
-    label = gtk_label_new (" ");
-    attach (props->content, label, 0, 2, pos);
-
-    label = gtk_label_new (_("<b>Video information</b>"));
-    gtk_label_set_use_markup (GTK_LABEL (label), TRUE);
-    gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-    attach (props->content, label, 0, 2, pos);
-    gtk_widget_show (label);
-
-    label = gtk_label_new (_("  Video size/framerate: "));
-    gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-    attach (props->content, label, 0, 1, pos);
-    pos--;
-    str2 = g_strdup_printf (_("%dx%d at %.02lf fps"),
-			    width, height, fps);
-    label = gtk_label_new (str2);
-    gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-    g_free (str2);
-    attach (props->content, label, 1, 2, pos);
-
-    if (taglist &&
-        gst_tag_list_get_string (taglist, GST_TAG_VIDEO_CODEC, &str)) {
-      str2 = g_strdup_printf (_("  %s: "),
-			      gst_tag_get_nick (GST_TAG_VIDEO_CODEC));
-      label = gtk_label_new (str2);
-      gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-      g_free (str2);
-      attach (props->content, label, 0, 1, pos);
-      pos--;
-      label = gtk_label_new (str);
-      gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-      attach (props->content, label, 1, 2, pos);
+  if (props->milestones) {
+    for (n = 0; n < GST_PLAYER_MILESTONE_LAST; n++) {
+      gchar *name;
+
+      if ((stamp = gst_player_milestones_get (props->milestones, n)) < 0.)
+        continue;
+
+      name = g_strdup_printf (_("  %s: "), gst_player_milestone_get_name (n));
+      str = g_strdup_printf (_("%.01lf ms"), stamp);
+      set_row (props, SECTION_TIMING, gst_player_milestone_get_name (n),
+	       name, str);
+      g_free (name);
+      g_free (str);
     }
-  }
 
-  if (have_audio) {
-    label = gtk_label_new (" ");
-    attach (props->content, label, 0, 2, pos);
-
-    label = gtk_label_new (_("<b>Audio information</b>"));
-    gtk_label_set_use_markup (GTK_LABEL (label), TRUE);
-    gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-    attach (props->content, label, 0, 2, pos);
-    gtk_widget_show (label);
-
-    label = gtk_label_new (_("  Audio channels/samplerate: "));
-    gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-    attach (props->content, label, 0, 1, pos);
-    pos--;
-    str2 = g_strdup_printf (_("%d channels at %d Hz"),
-			    channels, rate);
-    label = gtk_label_new (str2);
-    gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-    g_free (str2);
-    attach (props->content, label, 1, 2, pos);
-
-    if (taglist &&
-        gst_tag_list_get_string (taglist, GST_TAG_AUDIO_CODEC, &str)) {
-      str2 = g_strdup_printf (_("  %s: "),
-			      gst_tag_get_nick (GST_TAG_AUDIO_CODEC));
-      label = gtk_label_new (str2);
-      gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-      g_free (str2);
-      attach (props->content, label, 0, 1, pos);
-      pos--;
-      label = gtk_label_new (str);
-      gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
-      attach (props->content, label, 1, 2, pos);
+    if ((stamp = gst_player_milestones_get_gap (props->milestones,
+						&buffer)) >= 0.) {
+      str = g_strdup_printf (_("%.01lf ms (audio buffer %.01lf ms)"),
+			     stamp, buffer);
+      set_row (props, SECTION_TIMING, "switch-gap",
+	       _("  Gap after previous item: "), str);
+      g_free (str);
     }
   }
 
-  gtk_box_pack_start (GTK_BOX (GTK_DIALOG (props)->vbox),
-		      props->content, TRUE, TRUE, 0);
-  gtk_widget_show (props->content);
+  /* hide what's not there anymore */
+  g_hash_table_foreach (props->rows, cb_finish_row, used);
+  for (n = 0; n < G_N_ELEMENTS (props->sections); n++) {
+    if (used[n])
+      gtk_widget_show (props->sections[n]);
+    else
+      gtk_widget_hide (props->sections[n]);
+  }
 }
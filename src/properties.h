@@ -27,6 +27,10 @@
 #include <gdk/gdk.h>
 #include <gtk/gtkdialog.h>
 
+#include "milestones.h"
+#include "tags.h"
+#include "topology.h"
+
 G_BEGIN_DECLS
 
 #define GST_PLAYER_TYPE_PROPERTIES \
@@ -43,7 +47,15 @@ G_BEGIN_DECLS
 typedef struct _GstPlayerProperties {
   GtkDialog parent;
 
-  GtkWidget *content;
+  GtkWidget *content, *empty;
+
+  /* stream, video, audio and timing information */
+  GtkWidget *sections[4];
+
+  /* row key -> GstPlayerPropertiesRow */
+  GHashTable *rows;
+
+  GstPlayerMilestones *milestones;
 } GstPlayerProperties;
 
 typedef struct _GstPlayerPropertiesClass {
@@ -53,8 +65,10 @@ typedef struct _GstPlayerPropertiesClass {
 GType		gst_player_properties_get_type	(void);
 GtkWidget *	gst_player_properties_new	(void);
 void		gst_player_properties_update	(GstPlayerProperties *props,
-						 GstElement *play,
-						 const GstTagList *taglist);
+						 GstPlayerTopology *topo,
+						 GstPlayerTags *tags);
+void		gst_player_properties_set_milestones (GstPlayerProperties *props,
+						 GstPlayerMilestones *ms);
 
 G_END_DECLS
 
@@ -0,0 +1,497 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * scale.c: slice-threaded bilinear scaler for 32 bit RGB, used in
+ * front of X sinks that can't scale themselves. Output lines are
+ * independent, so each frame is spread over all processors. On x86
+ * processors with SSE2, the lines themselves are done with that.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#if defined (__GNUC__) && (defined (__i386__) || defined (__x86_64__))
+#define SCALE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "scale.h"
+#include "slices.h"
+
+#define SCALE_CAPS \
+  "video/x-raw-rgb, bpp = (int) 32, depth = (int) 24, " \
+  "width = (int) [ 1, MAX ], height = (int) [ 1, MAX ], " \
+  "framerate = (fraction) [ 0, MAX ]"
+
+static GstStaticPadTemplate sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+			 GST_STATIC_CAPS (SCALE_CAPS));
+static GstStaticPadTemplate src_template =
+GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+			 GST_STATIC_CAPS (SCALE_CAPS));
+
+static void	gst_player_scale_base_init	(gpointer klass);
+static void	gst_player_scale_class_init	(GstPlayerScaleClass *klass);
+static void	gst_player_scale_init		(GstPlayerScale *scale);
+static void	gst_player_scale_finalize	(GObject *object);
+
+static GstCaps *gst_player_scale_transform_caps	(GstBaseTransform *trans,
+						 GstPadDirection   direction,
+						 GstCaps          *caps);
+static void	gst_player_scale_fixate_caps	(GstBaseTransform *trans,
+						 GstPadDirection   direction,
+						 GstCaps          *caps,
+						 GstCaps          *othercaps);
+static gboolean	gst_player_scale_get_unit_size	(GstBaseTransform *trans,
+						 GstCaps          *caps,
+						 guint            *size);
+static gboolean	gst_player_scale_set_caps	(GstBaseTransform *trans,
+						 GstCaps          *incaps,
+						 GstCaps          *outcaps);
+static GstFlowReturn
+		gst_player_scale_transform	(GstBaseTransform *trans,
+						 GstBuffer        *inbuf,
+						 GstBuffer        *outbuf);
+
+static GstBaseTransformClass *parent_class = NULL;
+
+GType
+gst_player_scale_get_type (void)
+{
+  static GType gst_player_scale_type = 0;
+
+  if (!gst_player_scale_type) {
+    static const GTypeInfo gst_player_scale_info = {
+      sizeof (GstPlayerScaleClass),
+      gst_player_scale_base_init,
+      NULL,
+      (GClassInitFunc) gst_player_scale_class_init,
+      NULL,
+      NULL,
+      sizeof (GstPlayerScale),
+      0,
+      (GInstanceInitFunc) gst_player_scale_init,
+      NULL
+    };
+
+    gst_player_scale_type =
+	g_type_register_static (GST_TYPE_BASE_TRANSFORM,
+				"GstPlayerScale",
+				&gst_player_scale_info, 0);
+  }
+
+  return gst_player_scale_type;
+}
+
+static void
+gst_player_scale_base_init (gpointer klass)
+{
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  static const GstElementDetails details =
+      GST_ELEMENT_DETAILS ("Threaded video scaler",
+			   "Filter/Effect/Video",
+			   "Scales 32 bit RGB on all processors",
+			   "Ronald Bultje <rbultje@ronald.bitfreak.net>");
+
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&sink_template));
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&src_template));
+  gst_element_class_set_details (element_class, &details);
+}
+
+/*
+ * Line kernels. A line is first blended with the one below it, then
+ * each output pixel from the two source pixels it falls between.
+ * Both steps keep 8 bits, so that all versions give the same result.
+ */
+
+typedef void (* ScaleVerticalFunc)	(const guint8 *top,
+					 const guint8 *bottom,
+					 guint8       *dest,
+					 gint          len,
+					 guint         fy);
+typedef void (* ScaleHorizontalFunc)	(const guint8 *row,
+					 guint8       *dest,
+					 const gint   *off,
+					 const guint  *frac,
+					 gint          width);
+
+/*
+ * Blends two pixels, two bytes per multiplication: neither the
+ * weighted bytes nor their sum get past 16 bits.
+ */
+
+static guint32
+blend_c (guint32 a,
+	 guint32 b,
+	 guint   f)
+{
+  guint32 even, odd;
+
+  even = ((a & 0x00ff00ff) * (256 - f) + (b & 0x00ff00ff) * f) >> 8;
+  odd = ((a >> 8) & 0x00ff00ff) * (256 - f) + ((b >> 8) & 0x00ff00ff) * f;
+
+  return (even & 0x00ff00ff) | (odd & 0xff00ff00);
+}
+
+static void
+vertical_c (const guint8 *top,
+	    const guint8 *bottom,
+	    guint8       *dest,
+	    gint          len,
+	    guint         fy)
+{
+  guint32 t, b;
+  gint n;
+
+  for (n = 0; n < len; n += 4) {
+    memcpy (&t, top + n, 4);
+    memcpy (&b, bottom + n, 4);
+    t = blend_c (t, b, fy);
+    memcpy (dest + n, &t, 4);
+  }
+}
+
+/*
+ * The source pixel right of each off[] must exist.
+ */
+
+static void
+horizontal_c (const guint8 *row,
+	      guint8       *dest,
+	      const gint   *off,
+	      const guint  *frac,
+	      gint          width)
+{
+  guint32 left, right;
+  gint x;
+
+  for (x = 0; x < width; x++) {
+    memcpy (&left, row + off[x] * 4, 4);
+    memcpy (&right, row + off[x] * 4 + 4, 4);
+    left = blend_c (left, right, frac[x]);
+    memcpy (dest + x * 4, &left, 4);
+  }
+}
+
+#ifdef SCALE_SSE2
+
+/*
+ * 16 bytes at a time; the sum of both weighted bytes still fits in
+ * 16 bits.
+ */
+
+static void __attribute__ ((target ("sse2")))
+vertical_sse2 (const guint8 *top,
+	       const guint8 *bottom,
+	       guint8       *dest,
+	       gint          len,
+	       guint         fy)
+{
+  __m128i zero = _mm_setzero_si128 (),
+      wt = _mm_set1_epi16 (256 - fy), wb = _mm_set1_epi16 (fy);
+  gint n;
+
+  for (n = 0; n + 16 <= len; n += 16) {
+    __m128i t = _mm_loadu_si128 ((const __m128i *) (top + n)),
+        b = _mm_loadu_si128 ((const __m128i *) (bottom + n)), lo, hi;
+
+    lo = _mm_add_epi16 (
+        _mm_mullo_epi16 (_mm_unpacklo_epi8 (t, zero), wt),
+        _mm_mullo_epi16 (_mm_unpacklo_epi8 (b, zero), wb));
+    hi = _mm_add_epi16 (
+        _mm_mullo_epi16 (_mm_unpackhi_epi8 (t, zero), wt),
+        _mm_mullo_epi16 (_mm_unpackhi_epi8 (b, zero), wb));
+    _mm_storeu_si128 ((__m128i *) (dest + n),
+        _mm_packus_epi16 (_mm_srli_epi16 (lo, 8), _mm_srli_epi16 (hi, 8)));
+  }
+  vertical_c (top + n, bottom + n, dest + n, len - n, fy);
+}
+
+/*
+ * Two output pixels at a time. Each source pixel pair is one 8 byte
+ * load, its weights one vector; the halves are summed after
+ * multiplying.
+ */
+
+static void __attribute__ ((target ("sse2")))
+horizontal_sse2 (const guint8 *row,
+		 guint8       *dest,
+		 const gint   *off,
+		 const guint  *frac,
+		 gint          width)
+{
+  __m128i zero = _mm_setzero_si128 ();
+  gint x;
+
+  for (x = 0; x + 2 <= width; x += 2) {
+    __m128i p0, p1, w0, w1;
+    guint f0 = frac[x], f1 = frac[x + 1];
+
+    p0 = _mm_unpacklo_epi8 (
+        _mm_loadl_epi64 ((const __m128i *) (row + off[x] * 4)), zero);
+    p1 = _mm_unpacklo_epi8 (
+        _mm_loadl_epi64 ((const __m128i *) (row + off[x + 1] * 4)), zero);
+    w0 = _mm_set_epi16 (f0, f0, f0, f0,
+        256 - f0, 256 - f0, 256 - f0, 256 - f0);
+    w1 = _mm_set_epi16 (f1, f1, f1, f1,
+        256 - f1, 256 - f1, 256 - f1, 256 - f1);
+    p0 = _mm_mullo_epi16 (p0, w0);
+    p1 = _mm_mullo_epi16 (p1, w1);
+    p0 = _mm_add_epi16 (p0, _mm_srli_si128 (p0, 8));
+    p1 = _mm_add_epi16 (p1, _mm_srli_si128 (p1, 8));
+    p0 = _mm_srli_epi16 (_mm_unpacklo_epi64 (p0, p1), 8);
+    _mm_storel_epi64 ((__m128i *) (dest + x * 4),
+        _mm_packus_epi16 (p0, zero));
+  }
+  horizontal_c (row, dest + x * 4, off + x, frac + x, width - x);
+}
+
+#endif
+
+static ScaleVerticalFunc scale_vertical = vertical_c;
+static ScaleHorizontalFunc scale_horizontal = horizontal_c;
+
+static void
+gst_player_scale_class_init (GstPlayerScaleClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  parent_class = g_type_class_ref (GST_TYPE_BASE_TRANSFORM);
+
+#ifdef SCALE_SSE2
+  if (__builtin_cpu_supports ("sse2")) {
+    scale_vertical = vertical_sse2;
+    scale_horizontal = horizontal_sse2;
+  }
+#endif
+
+  gobject_class->finalize = gst_player_scale_finalize;
+
+  trans_class->transform_caps = gst_player_scale_transform_caps;
+  trans_class->fixate_caps = gst_player_scale_fixate_caps;
+  trans_class->get_unit_size = gst_player_scale_get_unit_size;
+  trans_class->set_caps = gst_player_scale_set_caps;
+  trans_class->transform = gst_player_scale_transform;
+}
+
+static void
+gst_player_scale_init (GstPlayerScale *scale)
+{
+  scale->in_width = scale->in_height = 0;
+  scale->out_width = scale->out_height = 0;
+  scale->x_off = scale->y_off = NULL;
+  scale->x_frac = scale->y_frac = NULL;
+  scale->x_inner = 0;
+}
+
+static void
+gst_player_scale_finalize (GObject *object)
+{
+  GstPlayerScale *scale = GST_PLAYER_SCALE (object);
+
+  g_free (scale->x_off);
+  g_free (scale->y_off);
+  g_free (scale->x_frac);
+  g_free (scale->y_frac);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+/*
+ * Any size on the other side; the pixel layout stays the same.
+ */
+
+static GstCaps *
+gst_player_scale_transform_caps (GstBaseTransform *trans,
+				 GstPadDirection   direction,
+				 GstCaps          *caps)
+{
+  GstCaps *res = gst_caps_copy (caps);
+  guint n;
+
+  for (n = 0; n < gst_caps_get_size (res); n++) {
+    GstStructure *s = gst_caps_get_structure (res, n);
+
+    gst_structure_set (s,
+		       "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+		       "height", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL);
+    gst_structure_remove_field (s, "pixel-aspect-ratio");
+  }
+
+  return res;
+}
+
+/*
+ * Without a size from downstream, keep the input size.
+ */
+
+static void
+gst_player_scale_fixate_caps (GstBaseTransform *trans,
+			      GstPadDirection   direction,
+			      GstCaps          *caps,
+			      GstCaps          *othercaps)
+{
+  GstStructure *in, *out;
+  gint width, height;
+
+  if (gst_caps_is_empty (othercaps))
+    return;
+
+  in = gst_caps_get_structure (caps, 0);
+  out = gst_caps_get_structure (othercaps, 0);
+  if (gst_structure_get_int (in, "width", &width) &&
+      gst_structure_get_int (in, "height", &height)) {
+    gst_structure_fixate_field_nearest_int (out, "width", width);
+    gst_structure_fixate_field_nearest_int (out, "height", height);
+  }
+}
+
+static gboolean
+gst_player_scale_get_unit_size (GstBaseTransform *trans,
+				GstCaps          *caps,
+				guint            *size)
+{
+  GstStructure *s = gst_caps_get_structure (caps, 0);
+  gint width, height;
+
+  if (!gst_structure_get_int (s, "width", &width) ||
+      !gst_structure_get_int (s, "height", &height))
+    return FALSE;
+  *size = width * height * 4;
+
+  return TRUE;
+}
+
+/*
+ * Source position of each of the out destination pixels, sampling
+ * at pixel centers.
+ */
+
+static void
+scale_table (gint    in,
+	     gint    out,
+	     gint  **off,
+	     guint **frac)
+{
+  gint n;
+
+  g_free (*off);
+  g_free (*frac);
+  *off = g_new (gint, out);
+  *frac = g_new (guint, out);
+
+  for (n = 0; n < out; n++) {
+    gint64 pos = ((gint64) (2 * n + 1) * in * 65536) / (2 * out) - 32768;
+
+    pos = CLAMP (pos, 0, (gint64) (in - 1) * 65536);
+    (*off)[n] = pos >> 16;
+    (*frac)[n] = (pos >> 8) & 0xff;
+  }
+}
+
+static gboolean
+gst_player_scale_set_caps (GstBaseTransform *trans,
+			   GstCaps          *incaps,
+			   GstCaps          *outcaps)
+{
+  GstPlayerScale *scale = GST_PLAYER_SCALE (trans);
+  GstStructure *in = gst_caps_get_structure (incaps, 0),
+      *out = gst_caps_get_structure (outcaps, 0);
+
+  if (!gst_structure_get_int (in, "width", &scale->in_width) ||
+      !gst_structure_get_int (in, "height", &scale->in_height) ||
+      !gst_structure_get_int (out, "width", &scale->out_width) ||
+      !gst_structure_get_int (out, "height", &scale->out_height))
+    return FALSE;
+
+  scale_table (scale->in_width, scale->out_width,
+	       &scale->x_off, &scale->x_frac);
+  scale_table (scale->in_height, scale->out_height,
+	       &scale->y_off, &scale->y_frac);
+
+  /* offsets only grow */
+  for (scale->x_inner = 0; scale->x_inner < scale->out_width &&
+       scale->x_off[scale->x_inner] + 1 < scale->in_width; scale->x_inner++);
+
+  gst_base_transform_set_passthrough (trans,
+      scale->in_width == scale->out_width &&
+      scale->in_height == scale->out_height);
+
+  return TRUE;
+}
+
+typedef struct _ScaleFrame {
+  GstPlayerScale *scale;
+  const guint8 *src;
+  guint8 *dest;
+} ScaleFrame;
+
+static void
+scale_lines (gint     first,
+	     gint     last,
+	     gpointer data)
+{
+  ScaleFrame *frame = data;
+  GstPlayerScale *scale = frame->scale;
+  gint in_stride = scale->in_width * 4, out_stride = scale->out_width * 4;
+  guint8 *blend = g_malloc (in_stride);
+  gint x, y;
+
+  for (y = first; y < last; y++) {
+    const guint8 *top = frame->src + scale->y_off[y] * in_stride, *row;
+    guint8 *dest = frame->dest + y * out_stride;
+    guint fy = scale->y_frac[y];
+
+    if (fy == 0 || scale->y_off[y] + 1 >= scale->in_height) {
+      row = top;
+    } else {
+      scale_vertical (top, top + in_stride, blend, in_stride, fy);
+      row = blend;
+    }
+
+    /* columns against the right edge, which has no pixel after it;
+     * scale_table() gives those no weight there */
+    scale_horizontal (row, dest, scale->x_off, scale->x_frac,
+		      scale->x_inner);
+    for (x = scale->x_inner; x < scale->out_width; x++)
+      memcpy (dest + x * 4, row + scale->x_off[x] * 4, 4);
+  }
+  g_free (blend);
+}
+
+static GstFlowReturn
+gst_player_scale_transform (GstBaseTransform *trans,
+			    GstBuffer        *inbuf,
+			    GstBuffer        *outbuf)
+{
+  GstPlayerScale *scale = GST_PLAYER_SCALE (trans);
+  ScaleFrame frame;
+
+  frame.scale = scale;
+  frame.src = GST_BUFFER_DATA (inbuf);
+  frame.dest = GST_BUFFER_DATA (outbuf);
+  gst_player_slices_run (scale->out_height, scale_lines, &frame);
+
+  return GST_FLOW_OK;
+}
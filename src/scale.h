@@ -0,0 +1,64 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * scale.h: slice-threaded bilinear scaler for 32 bit RGB.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCALE_H__
+#define __SCALE_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+
+G_BEGIN_DECLS
+
+#define GST_PLAYER_TYPE_SCALE \
+  (gst_player_scale_get_type ())
+#define GST_PLAYER_SCALE(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_PLAYER_TYPE_SCALE, GstPlayerScale))
+#define GST_PLAYER_SCALE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), GST_PLAYER_TYPE_SCALE, GstPlayerScaleClass))
+#define GST_PLAYER_IS_SCALE(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_PLAYER_TYPE_SCALE))
+#define GST_PLAYER_IS_SCALE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), GST_PLAYER_TYPE_SCALE))
+
+typedef struct _GstPlayerScale {
+  GstBaseTransform parent;
+
+  gint in_width, in_height, out_width, out_height;
+
+  /* for each output column and line, the first source pixel
+   * and the weight of the next one, in 1/256 */
+  gint *x_off, *y_off;
+  guint *x_frac, *y_frac;
+
+  /* output columns that have a source pixel right of x_off */
+  gint x_inner;
+} GstPlayerScale;
+
+typedef struct _GstPlayerScaleClass {
+  GstBaseTransformClass klass;
+} GstPlayerScaleClass;
+
+GType		gst_player_scale_get_type	(void);
+
+G_END_DECLS
+
+#endif /* __SCALE_H__ */
@@ -0,0 +1,195 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * seek.c: seek coalescing. Only one flushing seek is executed at a
+ * time; targets asked for while it runs are dropped, except for the
+ * last one, which is executed once the pipeline prerolled again.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib/gi18n.h>
+
+#include "seek.h"
+
+/* give up waiting for a seek to complete after this (in ms) */
+#define SEEK_TIMEOUT 2000
+
+static void	seek_execute	(GstPlayerSeek *seek,
+				 GstClockTime   position,
+				 gboolean       accurate);
+
+static void
+seek_done (GstPlayerSeek *seek,
+	   gboolean       completed)
+{
+  if (!seek->in_flight)
+    return;
+
+  seek->in_flight = FALSE;
+  if (seek->timeout_id != 0) {
+    g_source_remove (seek->timeout_id);
+    seek->timeout_id = 0;
+  }
+
+  if (completed) {
+    seek->last = g_timer_elapsed (seek->timer, NULL) * 1000.;
+    seek->total += seek->last;
+    seek->seeks++;
+  }
+
+  if (GST_CLOCK_TIME_IS_VALID (seek->pending)) {
+    GstClockTime position = seek->pending;
+
+    seek->pending = GST_CLOCK_TIME_NONE;
+    seek_execute (seek, position, seek->pending_accurate);
+  }
+}
+
+static gboolean
+cb_timeout (gpointer data)
+{
+  GstPlayerSeek *seek = data;
+
+  seek->timeout_id = 0;
+  seek_done (seek, FALSE);
+
+  return FALSE;
+}
+
+static void
+cb_message (GstMessage *message,
+	    gpointer    data)
+{
+  GstPlayerSeek *seek = data;
+
+  switch (GST_MESSAGE_TYPE (message)) {
+    case GST_MESSAGE_ASYNC_DONE:
+      /* the new position was prerolled */
+      seek_done (seek, TRUE);
+      break;
+    case GST_MESSAGE_STATE_CHANGED: {
+      GstState new_state;
+
+      gst_message_parse_state_changed (message, NULL, &new_state, NULL);
+      if (new_state <= GST_STATE_READY) {
+        seek->pending = GST_CLOCK_TIME_NONE;
+        seek_done (seek, FALSE);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+GstPlayerSeek *
+gst_player_seek_new (GstElement          *play,
+		     GstPlayerDispatcher *disp)
+{
+  GstPlayerSeek *seek = g_new0 (GstPlayerSeek, 1);
+
+  seek->play = gst_object_ref (play);
+  seek->disp = disp;
+  seek->sub_id = gst_player_dispatcher_subscribe (disp,
+      GST_MESSAGE_ASYNC_DONE | GST_MESSAGE_STATE_CHANGED,
+      GST_OBJECT (play), cb_message, seek);
+  seek->pending = GST_CLOCK_TIME_NONE;
+  seek->timer = g_timer_new ();
+
+  return seek;
+}
+
+void
+gst_player_seek_free (GstPlayerSeek *seek)
+{
+  if (seek->timeout_id != 0)
+    g_source_remove (seek->timeout_id);
+  gst_player_dispatcher_unsubscribe (seek->disp, seek->sub_id);
+  gst_object_unref (seek->play);
+  g_timer_destroy (seek->timer);
+  g_free (seek);
+}
+
+void
+gst_player_seek_set_index (GstPlayerSeek  *seek,
+			   GstPlayerIndex *index)
+{
+  seek->index = index;
+}
+
+static void
+seek_execute (GstPlayerSeek *seek,
+	      GstClockTime   position,
+	      gboolean       accurate)
+{
+  GstSeekFlags flags = GST_SEEK_FLAG_FLUSH;
+
+  flags |= accurate ? GST_SEEK_FLAG_ACCURATE : GST_SEEK_FLAG_KEY_UNIT;
+  g_timer_start (seek->timer);
+
+  /* demuxers without an index of their own go straight to the
+   * keyframe's byte offset, if we know it */
+  if (seek->index &&
+      gst_player_index_seek (seek->index, position, accurate)) {
+    seek->indexed++;
+  } else if (!gst_element_seek_simple (seek->play, GST_FORMAT_TIME,
+				       flags, position)) {
+    return;
+  }
+
+  seek->in_flight = TRUE;
+  seek->timeout_id = g_timeout_add (SEEK_TIMEOUT, cb_timeout, seek);
+}
+
+/*
+ * Seeks to position, or remembers it if another seek is still being
+ * executed. Key unit seeks are fast but land on a keyframe, accurate
+ * seeks decode up to the exact position.
+ */
+
+void
+gst_player_seek_request (GstPlayerSeek *seek,
+			 GstClockTime   position,
+			 gboolean       accurate)
+{
+  if (!seek->in_flight) {
+    seek_execute (seek, position, accurate);
+    return;
+  }
+
+  if (GST_CLOCK_TIME_IS_VALID (seek->pending))
+    seek->dropped++;
+  seek->pending = position;
+  seek->pending_accurate = accurate;
+}
+
+/*
+ * Text summary for the performance dialog.
+ */
+
+gchar *
+gst_player_seek_dump (GstPlayerSeek *seek)
+{
+  return g_strdup_printf (_("%u seeks, %u dropped, %u from index, "
+			    "%.01lf ms last, %.01lf ms average\n"),
+			  seek->seeks, seek->dropped, seek->indexed, seek->last,
+			  seek->seeks ? seek->total / seek->seeks : 0.);
+}
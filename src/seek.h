@@ -0,0 +1,66 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * seek.h: seek coalescing
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SEEK_H__
+#define __SEEK_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "dispatcher.h"
+#include "index.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GstPlayerSeek {
+  GstElement *play;
+  GstPlayerDispatcher *disp;
+  guint sub_id;
+
+  /* known keyframes of the current media, optional */
+  GstPlayerIndex *index;
+
+  /* the seek being executed and the latest one asked for meanwhile */
+  gboolean in_flight;
+  guint timeout_id;
+  GstClockTime pending;
+  gboolean pending_accurate;
+
+  /* seek-to-frame latency */
+  GTimer *timer;
+  guint seeks, dropped, indexed;
+  gdouble last, total;
+} GstPlayerSeek;
+
+GstPlayerSeek *	gst_player_seek_new		(GstElement *play,
+						 GstPlayerDispatcher *disp);
+void		gst_player_seek_free		(GstPlayerSeek *seek);
+void		gst_player_seek_set_index	(GstPlayerSeek *seek,
+						 GstPlayerIndex *index);
+
+void		gst_player_seek_request		(GstPlayerSeek *seek,
+						 GstClockTime   position,
+						 gboolean       accurate);
+gchar *		gst_player_seek_dump		(GstPlayerSeek *seek);
+
+G_END_DECLS
+
+#endif /* __SEEK_H__ */
@@ -0,0 +1,700 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * sink.c: video sink selection. The first time we run, every X
+ * overlay sink that works on this display is timed on a short test
+ * stream at screen resolution and the fastest one is remembered in
+ * GConf.
+ *
+ * It also counts how many frames reach the sink in a buffer it did
+ * not allocate. Those have to be copied into an XImage/XvImage before
+ * display, while buffers from the sink's own (shared memory) pool are
+ * shown as they are.
+ *
+ * Sinks that can't scale get a videoscale in front, which passes
+ * frames through untouched unless the window size differs from the
+ * stream size, and the fastest colorspace converter available.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <glib/gi18n.h>
+#include <gdk/gdk.h>
+#include <gconf/gconf-client.h>
+#include <gst/interfaces/xoverlay.h>
+
+#include "convert.h"
+#include "pipeline.h"
+#include "scale.h"
+#include "sink.h"
+
+#define GCONF_KEY_VIDEO_SINK "/apps/aldegonde/video_sink"
+#define GCONF_KEY_VIDEO_CONVERTER "/apps/aldegonde/video_converter"
+
+/* number of frames and maximum time per candidate */
+#define CALIBRATE_FRAMES 60
+#define CALIBRATE_TIMEOUT 10
+
+/* in order of preference if they're equally fast */
+static const gchar *candidates[] = {
+  "xvimagesink",
+  "ximagesink",
+  NULL
+};
+
+/* these scale in hardware */
+static const gchar *scaling[] = {
+  "xvimagesink",
+  NULL
+};
+
+/*
+ * Creates the sink and checks that it can open the display.
+ */
+
+static GstElement *
+sink_try (const gchar *factory)
+{
+  GstElement *sink;
+
+  if (!(sink = gst_element_factory_make (factory, "video-sink")))
+    return NULL;
+
+  if (gst_element_set_state (sink,
+			     GST_STATE_READY) == GST_STATE_CHANGE_FAILURE) {
+    gst_element_set_state (sink, GST_STATE_NULL);
+    gst_object_unref (GST_OBJECT (sink));
+    return NULL;
+  }
+  gst_element_set_state (sink, GST_STATE_NULL);
+
+  return sink;
+}
+
+/*
+ * Frames per second the sink manages at the given size, including
+ * the colorspace conversion it would need, or a negative value if
+ * it doesn't work at all.
+ */
+
+static gdouble
+sink_calibrate (const gchar *factory,
+		gint         width,
+		gint         height)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GTimer *timer;
+  GError *error = NULL;
+  gchar *desc;
+  gdouble fps = -1.;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d ! "
+			  "video/x-raw-yuv,format=(fourcc)I420,"
+			  "width=%d,height=%d,framerate=30/1 ! "
+			  "ffmpegcolorspace ! %s sync=false",
+			  CALIBRATE_FRAMES, width, height, factory);
+  pipeline = gst_parse_launch (desc, &error);
+  g_free (desc);
+  if (!pipeline) {
+    g_message ("%s: %s", factory, error->message);
+    g_error_free (error);
+    return -1.;
+  } else if (error) {
+    /* missing elements, not usable */
+    g_error_free (error);
+    gst_object_unref (GST_OBJECT (pipeline));
+    return -1.;
+  }
+
+  bus = gst_element_get_bus (pipeline);
+  timer = g_timer_new ();
+  if (gst_element_set_state (pipeline,
+			     GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE) {
+    msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR,
+			CALIBRATE_TIMEOUT * GST_SECOND);
+    if (msg) {
+      if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS)
+        fps = CALIBRATE_FRAMES / g_timer_elapsed (timer, NULL);
+      gst_message_unref (msg);
+    }
+  }
+  g_timer_destroy (timer);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (GST_OBJECT (bus));
+  gst_object_unref (GST_OBJECT (pipeline));
+
+  return fps;
+}
+
+static void
+screen_size (gint *width,
+	     gint *height)
+{
+  GdkScreen *screen = gdk_screen_get_default ();
+
+  *width = 720;
+  *height = 576;
+  if (screen) {
+    *width = gdk_screen_get_width (screen);
+    *height = gdk_screen_get_height (screen);
+  }
+
+  /* I420 needs even sizes */
+  *width &= ~1;
+  *height &= ~1;
+}
+
+/*
+ * Calibration runs in its own thread, since it takes a few seconds
+ * per candidate. The thread only measures; the caller keeps its main
+ * loop running and stores the result.
+ */
+
+typedef struct _Calibration {
+  GMutex *lock;
+  gint width, height;
+
+  /* progress not yet shown, and the result */
+  gchar *message;
+  gdouble fraction;
+  gboolean changed, done;
+  const gchar *sink, *converter;
+} Calibration;
+
+static void
+calibration_progress (Calibration *cal,
+		      gchar       *message,
+		      gdouble      fraction)
+{
+  g_mutex_lock (cal->lock);
+  g_free (cal->message);
+  cal->message = message;
+  cal->fraction = fraction;
+  cal->changed = TRUE;
+  g_mutex_unlock (cal->lock);
+
+  g_main_context_wakeup (NULL);
+}
+
+static const gchar *
+sink_choose (Calibration *cal)
+{
+  const gchar *best = NULL;
+  gdouble best_fps = 0.;
+  gint n;
+
+  for (n = 0; candidates[n] != NULL; n++) {
+    GstElement *sink;
+    gdouble fps;
+
+    /* the last step is for the converters */
+    calibration_progress (cal,
+        g_strdup_printf (_("Measuring %s"), candidates[n]),
+        (gdouble) n / G_N_ELEMENTS (candidates));
+
+    if (!(sink = sink_try (candidates[n])))
+      continue;
+    gst_object_unref (GST_OBJECT (sink));
+
+    fps = sink_calibrate (candidates[n], cal->width, cal->height);
+    g_message ("video sink %s: %.01lf fps at %dx%d",
+	       candidates[n], fps, cal->width, cal->height);
+    if (fps > best_fps) {
+      best = candidates[n];
+      best_fps = fps;
+    }
+  }
+
+  return best;
+}
+
+static gpointer
+calibration_thread (gpointer data)
+{
+  Calibration *cal = data;
+  const gchar *sink, *converter;
+
+  sink = sink_choose (cal);
+  calibration_progress (cal, g_strdup (_("Measuring colorspace converters")),
+      (G_N_ELEMENTS (candidates) - 1.) / G_N_ELEMENTS (candidates));
+  converter = gst_player_convert_choose (cal->width, cal->height);
+
+  g_mutex_lock (cal->lock);
+  cal->sink = sink;
+  cal->converter = converter;
+  cal->done = TRUE;
+  g_mutex_unlock (cal->lock);
+  g_main_context_wakeup (NULL);
+
+  return NULL;
+}
+
+/*
+ * The colorspace converter to use in front of RGB sinks: the one
+ * calibration found fastest, else the first one available.
+ */
+
+static GstElement *
+converter_new (GConfClient *client)
+{
+  GstElement *conv = NULL;
+  gchar *name;
+  gint n;
+
+  if ((name = gconf_client_get_string (client,
+				       GCONF_KEY_VIDEO_CONVERTER, NULL))) {
+    conv = gst_element_factory_make (name, "convert");
+    g_free (name);
+  }
+
+  for (n = 0; !conv && gst_player_converters[n] != NULL; n++)
+    conv = gst_element_factory_make (gst_player_converters[n], "convert");
+
+  return conv;
+}
+
+/*
+ * Whether the sink (in READY, so that it knows the display) takes
+ * what the scaler makes, 32 bpp RGB.
+ */
+
+static gboolean
+sink_takes_scaled (GstElement *sink,
+		   GstElement *scale)
+{
+  GstPad *sinkpad, *srcpad;
+  GstCaps *caps;
+  gboolean res = FALSE;
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  srcpad = gst_element_get_static_pad (scale, "src");
+  if (sinkpad && srcpad) {
+    caps = gst_pad_get_caps (sinkpad);
+    res = gst_caps_can_intersect (caps,
+        gst_pad_get_pad_template_caps (srcpad));
+    gst_caps_unref (caps);
+  }
+  if (sinkpad)
+    gst_object_unref (GST_OBJECT (sinkpad));
+  if (srcpad)
+    gst_object_unref (GST_OBJECT (srcpad));
+
+  return res;
+}
+
+/*
+ * Puts the fastest colorspace converter and a scaler in front of
+ * sinks that can't scale themselves. Those only take RGB too. On
+ * 16 or 24 bpp displays, a generic converter adapts the scaler's
+ * output; without one, or if anything doesn't link, the sink is
+ * used as is and playbin converts for it.
+ */
+
+static GstElement *
+sink_wrap (GstElement  *sink,
+	   GConfClient *client)
+{
+  GstElementFactory *factory = gst_element_get_factory (sink);
+  GstElement *bin, *conv, *scale, *filter, *depth = NULL, *first;
+  GstPad *pad;
+  gchar *name;
+  gboolean linked;
+  gint n;
+
+  for (n = 0; scaling[n] != NULL; n++) {
+    if (!strcmp (GST_PLUGIN_FEATURE_NAME (factory), scaling[n]))
+      return sink;
+  }
+
+  scale = g_object_new (GST_PLAYER_TYPE_SCALE, "name", "scale", NULL);
+  if (!sink_takes_scaled (sink, scale) &&
+      !(depth = gst_element_factory_make ("ffmpegcolorspace", "depth"))) {
+    gst_object_unref (GST_OBJECT (scale));
+    return sink;
+  }
+  filter = gst_element_factory_make ("capsfilter", "scale-caps");
+
+  /* the bin takes over the sink's name; keep a reference to get the
+   * sink back out if this doesn't work */
+  name = gst_object_get_name (GST_OBJECT (sink));
+  gst_object_set_name (GST_OBJECT (sink), "overlay");
+  gst_object_ref (GST_OBJECT (sink));
+  bin = gst_bin_new ("video-sink");
+  gst_bin_add_many (GST_BIN (bin), scale, filter, sink, NULL);
+  if (depth) {
+    gst_bin_add (GST_BIN (bin), depth);
+    linked = gst_element_link_many (scale, filter, depth, sink, NULL);
+  } else {
+    linked = gst_element_link_many (scale, filter, sink, NULL);
+  }
+  first = scale;
+
+  if (linked && (conv = converter_new (client))) {
+    gst_bin_add (GST_BIN (bin), conv);
+    linked = gst_element_link (conv, scale);
+    first = conv;
+  }
+
+  if (!linked) {
+    g_warning ("Failed to link scaler to %s, not scaling",
+	       GST_PLUGIN_FEATURE_NAME (factory));
+    gst_bin_remove (GST_BIN (bin), sink);
+    gst_object_unref (GST_OBJECT (bin));
+    gst_object_set_name (GST_OBJECT (sink), name);
+    g_free (name);
+
+    /* floating again, like what gst_element_factory_make() gave us */
+    GST_OBJECT_FLAG_SET (sink, GST_OBJECT_FLOATING);
+
+    return sink;
+  }
+  gst_object_unref (GST_OBJECT (sink));
+  g_free (name);
+
+  pad = gst_element_get_static_pad (first, "sink");
+  gst_element_add_pad (bin, gst_ghost_pad_new ("sink", pad));
+  gst_object_unref (GST_OBJECT (pad));
+
+  return bin;
+}
+
+/*
+ * Tells the sink how large the video window is, so that a scaler in
+ * front of it can produce frames of that size. Does nothing for
+ * sinks that scale themselves.
+ */
+
+void
+gst_player_video_sink_set_size (GstElement *sink,
+				gint        width,
+				gint        height)
+{
+  GstElement *scale, *filter;
+  GstPad *pad;
+  GstCaps *caps = NULL;
+  gint in_width = 0, in_height = 0;
+
+  if (!GST_IS_BIN (sink) ||
+      !(filter = gst_bin_get_by_name (GST_BIN (sink), "scale-caps")))
+    return;
+
+  /* same size as the stream: let the scaler pass frames through */
+  if ((scale = gst_bin_get_by_name (GST_BIN (sink), "scale"))) {
+    if ((pad = gst_element_get_static_pad (scale, "sink"))) {
+      if (GST_PAD_CAPS (pad)) {
+        GstStructure *s = gst_caps_get_structure (GST_PAD_CAPS (pad), 0);
+
+        gst_structure_get_int (s, "width", &in_width);
+        gst_structure_get_int (s, "height", &in_height);
+      }
+      gst_object_unref (GST_OBJECT (pad));
+    }
+    gst_object_unref (GST_OBJECT (scale));
+  }
+
+  if (width > 0 && height > 0 &&
+      (width != in_width || height != in_height)) {
+    caps = gst_caps_new_simple ("video/x-raw-rgb",
+				"width", G_TYPE_INT, width,
+				"height", G_TYPE_INT, height,
+				"pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1,
+				NULL);
+  }
+  g_object_set (filter, "caps", caps, NULL);
+  if (caps)
+    gst_caps_unref (caps);
+  gst_object_unref (GST_OBJECT (filter));
+}
+
+/*
+ * Whether an earlier calibration chose a video sink.
+ */
+
+gboolean
+gst_player_video_sink_calibrated (void)
+{
+  GConfClient *client = gconf_client_get_default ();
+  gchar *name;
+  gboolean res;
+
+  name = gconf_client_get_string (client, GCONF_KEY_VIDEO_SINK, NULL);
+  res = name != NULL;
+  g_free (name);
+  g_object_unref (G_OBJECT (client));
+
+  return res;
+}
+
+/*
+ * Times the available sinks and converters and remembers the fastest
+ * ones. The test pipelines open windows of their own, so call this
+ * before the main window is shown. The default main loop keeps
+ * running meanwhile and progress is called from it.
+ */
+
+void
+gst_player_video_sink_calibrate (GstPlayerSinkProgressFunc progress,
+				 gpointer                  data)
+{
+  Calibration cal = { NULL, 0, 0, NULL, 0., FALSE, FALSE, NULL, NULL };
+  GConfClient *client;
+  GThread *thread;
+
+  cal.lock = g_mutex_new ();
+  screen_size (&cal.width, &cal.height);
+  if (!(thread = g_thread_create (calibration_thread, &cal, TRUE, NULL))) {
+    g_mutex_free (cal.lock);
+    return;
+  }
+
+  g_mutex_lock (cal.lock);
+  while (!cal.done) {
+    if (cal.changed && progress) {
+      gchar *message = g_strdup (cal.message);
+      gdouble fraction = cal.fraction;
+
+      cal.changed = FALSE;
+      g_mutex_unlock (cal.lock);
+      progress (message, fraction, data);
+      g_free (message);
+    } else {
+      g_mutex_unlock (cal.lock);
+      g_main_context_iteration (NULL, TRUE);
+    }
+    g_mutex_lock (cal.lock);
+  }
+  g_mutex_unlock (cal.lock);
+  g_thread_join (thread);
+
+  client = gconf_client_get_default ();
+  if (cal.sink)
+    gconf_client_set_string (client, GCONF_KEY_VIDEO_SINK, cal.sink, NULL);
+  if (cal.converter)
+    gconf_client_set_string (client, GCONF_KEY_VIDEO_CONVERTER,
+			     cal.converter, NULL);
+  g_object_unref (G_OBJECT (client));
+
+  g_free (cal.message);
+  g_mutex_free (cal.lock);
+}
+
+/*
+ * Returns the video sink to use: the one remembered from calibration
+ * if it still works, else the first one that opens the display. This
+ * never calibrates by itself.
+ */
+
+GstElement *
+gst_player_video_sink_new (GError **err)
+{
+  GConfClient *client = gconf_client_get_default ();
+  GstElement *sink = NULL;
+  gchar *name;
+  gint n;
+
+  if ((name = gconf_client_get_string (client,
+				       GCONF_KEY_VIDEO_SINK, NULL))) {
+    sink = sink_try (name);
+    g_free (name);
+  }
+
+  for (n = 0; !sink && candidates[n] != NULL; n++)
+    sink = sink_try (candidates[n]);
+
+  if (!sink) {
+    g_set_error (err, GST_PLAYER_ERROR, 1,
+		 _("No working video output found"));
+    g_object_unref (G_OBJECT (client));
+    return NULL;
+  }
+
+  sink = sink_wrap (sink, client);
+  g_object_unref (G_OBJECT (client));
+
+  return sink;
+}
+
+/*
+ * Forgets the calibration, so that the next start calibrates again.
+ */
+
+void
+gst_player_video_sink_forget (void)
+{
+  GConfClient *client = gconf_client_get_default ();
+
+  gconf_client_unset (client, GCONF_KEY_VIDEO_SINK, NULL);
+  gconf_client_unset (client, GCONF_KEY_VIDEO_CONVERTER, NULL);
+  g_object_unref (G_OBJECT (client));
+}
+
+static gboolean
+cb_buffer (GstPad    *pad,
+	   GstBuffer *buf,
+	   gpointer   data)
+{
+  GstPlayerSinkStats *stats = data;
+
+  g_mutex_lock (stats->lock);
+  stats->frames++;
+
+  /* the X sinks hand out subclasses of GstBuffer wrapping their
+   * shared memory images; anything else gets copied */
+  if (G_TYPE_FROM_INSTANCE (buf) == GST_TYPE_BUFFER) {
+    stats->copied++;
+    stats->bytes += GST_BUFFER_SIZE (buf);
+  }
+  g_mutex_unlock (stats->lock);
+
+  return TRUE;
+}
+
+/*
+ * The scaler works synchronously, so a frame leaving it belongs to
+ * the last one that came in. When it passes frames through, the same
+ * buffer comes out and nothing is counted.
+ */
+
+static gboolean
+cb_scale_in (GstPad    *pad,
+	     GstBuffer *buf,
+	     gpointer   data)
+{
+  GstPlayerSinkStats *stats = data;
+
+  g_mutex_lock (stats->lock);
+  stats->scale_buf = buf;
+  stats->scale_start = gst_util_get_timestamp ();
+  g_mutex_unlock (stats->lock);
+
+  return TRUE;
+}
+
+static gboolean
+cb_scale_out (GstPad    *pad,
+	      GstBuffer *buf,
+	      gpointer   data)
+{
+  GstPlayerSinkStats *stats = data;
+
+  g_mutex_lock (stats->lock);
+  if (stats->scale_buf && stats->scale_buf != buf) {
+    stats->scale_time += gst_util_get_timestamp () - stats->scale_start;
+    stats->scaled++;
+  }
+  stats->scale_buf = NULL;
+  g_mutex_unlock (stats->lock);
+
+  return TRUE;
+}
+
+/*
+ * Starts counting copies on the video sink.
+ */
+
+GstPlayerSinkStats *
+gst_player_sink_stats_new (GstElement *sink)
+{
+  GstPlayerSinkStats *stats = g_new0 (GstPlayerSinkStats, 1);
+
+  stats->lock = g_mutex_new ();
+  if (GST_IS_BIN (sink)) {
+    GstElement *scale;
+
+    if ((scale = gst_bin_get_by_name (GST_BIN (sink), "scale"))) {
+      stats->scale_in = gst_element_get_static_pad (scale, "sink");
+      stats->scale_in_id = gst_pad_add_buffer_probe (stats->scale_in,
+          G_CALLBACK (cb_scale_in), stats);
+      stats->scale_out = gst_element_get_static_pad (scale, "src");
+      stats->scale_out_id = gst_pad_add_buffer_probe (stats->scale_out,
+          G_CALLBACK (cb_scale_out), stats);
+      gst_object_unref (GST_OBJECT (scale));
+    }
+
+    sink = gst_bin_get_by_interface (GST_BIN (sink), GST_TYPE_X_OVERLAY);
+  } else
+    gst_object_ref (GST_OBJECT (sink));
+
+  if (sink) {
+    if ((stats->pad = gst_element_get_static_pad (sink, "sink")))
+      stats->probe_id = gst_pad_add_buffer_probe (stats->pad,
+						  G_CALLBACK (cb_buffer), stats);
+    gst_object_unref (GST_OBJECT (sink));
+  }
+
+  return stats;
+}
+
+void
+gst_player_sink_stats_free (GstPlayerSinkStats *stats)
+{
+  if (stats->pad) {
+    gst_pad_remove_buffer_probe (stats->pad, stats->probe_id);
+    gst_object_unref (GST_OBJECT (stats->pad));
+  }
+  if (stats->scale_in) {
+    gst_pad_remove_buffer_probe (stats->scale_in, stats->scale_in_id);
+    gst_object_unref (GST_OBJECT (stats->scale_in));
+    gst_pad_remove_buffer_probe (stats->scale_out, stats->scale_out_id);
+    gst_object_unref (GST_OBJECT (stats->scale_out));
+  }
+  g_mutex_free (stats->lock);
+  g_free (stats);
+}
+
+void
+gst_player_sink_stats_reset (GstPlayerSinkStats *stats)
+{
+  g_mutex_lock (stats->lock);
+  stats->frames = stats->copied = 0;
+  stats->bytes = 0;
+  stats->scale_time = 0;
+  stats->scaled = 0;
+  g_mutex_unlock (stats->lock);
+}
+
+/*
+ * Text summary for the performance dialog.
+ */
+
+gchar *
+gst_player_sink_stats_dump (GstPlayerSinkStats *stats)
+{
+  GString *str = g_string_new (NULL);
+
+  g_mutex_lock (stats->lock);
+  g_string_append_printf (str, _("%u of %u frames copied, "
+				 "%" G_GUINT64_FORMAT " bytes/frame\n"),
+			  stats->copied, stats->frames,
+			  stats->frames ? stats->bytes / stats->frames : 0);
+  if (stats->scale_in) {
+    g_string_append_printf (str, _("%u frames scaled, "
+				   "%" G_GUINT64_FORMAT " usec/frame\n"),
+			    stats->scaled, stats->scaled ?
+			    stats->scale_time / stats->scaled / GST_USECOND : 0);
+  }
+  g_mutex_unlock (stats->lock);
+
+  return g_string_free (str, FALSE);
+}
@@ -0,0 +1,69 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * sink.h: video sink selection
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SINK_H__
+#define __SINK_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstPlayerSinkStats {
+  GMutex *lock;
+  GstPad *pad;
+  gulong probe_id;
+
+  /* frames that reached the sink, frames the sink had to copy
+   * into its own image first and the number of bytes copied */
+  guint frames, copied;
+  guint64 bytes;
+
+  /* software scaler in front of the sink, if any */
+  GstPad *scale_in, *scale_out;
+  gulong scale_in_id, scale_out_id;
+  GstBuffer *scale_buf;
+  GstClockTime scale_start, scale_time;
+  guint scaled;
+} GstPlayerSinkStats;
+
+typedef void (* GstPlayerSinkProgressFunc)	(const gchar *message,
+						 gdouble      fraction,
+						 gpointer     data);
+
+GstElement *	gst_player_video_sink_new	(GError **err);
+gboolean	gst_player_video_sink_calibrated (void);
+void		gst_player_video_sink_calibrate	(GstPlayerSinkProgressFunc progress,
+						 gpointer                  data);
+void		gst_player_video_sink_forget	(void);
+void		gst_player_video_sink_set_size	(GstElement *sink,
+						 gint        width,
+						 gint        height);
+
+GstPlayerSinkStats *
+		gst_player_sink_stats_new	(GstElement *sink);
+void		gst_player_sink_stats_free	(GstPlayerSinkStats *stats);
+void		gst_player_sink_stats_reset	(GstPlayerSinkStats *stats);
+gchar *		gst_player_sink_stats_dump	(GstPlayerSinkStats *stats);
+
+G_END_DECLS
+
+#endif /* __SINK_H__ */
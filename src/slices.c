@@ -0,0 +1,139 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * slices.c: run per-line video work on all processors. A frame is
+ * cut into horizontal slices of whole lines; the calling streaming
+ * thread does one slice itself and a shared thread pool the others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <unistd.h>
+
+#include "slices.h"
+
+/* fewer lines than this aren't worth a thread switch */
+#define MIN_SLICE_LINES 16
+
+typedef struct _SliceJob {
+  GstPlayerSliceFunc func;
+  gpointer data;
+
+  GMutex *lock;
+  GCond *cond;
+  gint pending;
+} SliceJob;
+
+typedef struct _Slice {
+  SliceJob *job;
+  gint first, last;
+} Slice;
+
+static GStaticMutex pool_lock = G_STATIC_MUTEX_INIT;
+static GThreadPool *pool = NULL;
+static gint processors = 0;
+
+static void
+slice_run (gpointer data,
+	   gpointer user_data)
+{
+  Slice *slice = data;
+  SliceJob *job = slice->job;
+
+  job->func (slice->first, slice->last, job->data);
+
+  g_mutex_lock (job->lock);
+  if (--job->pending == 0)
+    g_cond_signal (job->cond);
+  g_mutex_unlock (job->lock);
+}
+
+/*
+ * The pool is shared by all elements and lives as long as the
+ * program. Returns the number of processors, or 1 if there's no
+ * pool to help out.
+ */
+
+static gint
+pool_get (void)
+{
+  g_static_mutex_lock (&pool_lock);
+  if (!processors) {
+    processors = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+    processors = CLAMP (sysconf (_SC_NPROCESSORS_ONLN), 1, 64);
+#endif
+    if (processors > 1 &&
+        !(pool = g_thread_pool_new (slice_run, NULL, processors - 1,
+				    FALSE, NULL)))
+      processors = 1;
+  }
+  g_static_mutex_unlock (&pool_lock);
+
+  return processors;
+}
+
+/*
+ * Calls func for consecutive ranges of lines covering 0 to lines,
+ * concurrently, and returns when all of them are done.
+ */
+
+void
+gst_player_slices_run (gint               lines,
+		       GstPlayerSliceFunc func,
+		       gpointer           data)
+{
+  SliceJob job;
+  Slice *slices;
+  gint n, count;
+
+  count = MIN (pool_get (), lines / MIN_SLICE_LINES);
+  if (count <= 1) {
+    func (0, lines, data);
+    return;
+  }
+
+  job.func = func;
+  job.data = data;
+  job.lock = g_mutex_new ();
+  job.cond = g_cond_new ();
+  job.pending = count - 1;
+
+  slices = g_new (Slice, count);
+  for (n = 0; n < count; n++) {
+    slices[n].job = &job;
+    slices[n].first = lines * n / count;
+    slices[n].last = lines * (n + 1) / count;
+  }
+  for (n = 1; n < count; n++)
+    g_thread_pool_push (pool, &slices[n], NULL);
+
+  /* the first slice is ours */
+  func (slices[0].first, slices[0].last, data);
+
+  g_mutex_lock (job.lock);
+  while (job.pending > 0)
+    g_cond_wait (job.cond, job.lock);
+  g_mutex_unlock (job.lock);
+
+  g_cond_free (job.cond);
+  g_mutex_free (job.lock);
+  g_free (slices);
+}
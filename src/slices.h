@@ -0,0 +1,40 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * slices.h: run per-line video work on all processors.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SLICES_H__
+#define __SLICES_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* handles lines first up to, but not including, last */
+typedef void (* GstPlayerSliceFunc)	(gint     first,
+					 gint     last,
+					 gpointer data);
+
+void		gst_player_slices_run		(gint               lines,
+						 GstPlayerSliceFunc func,
+						 gpointer           data);
+
+G_END_DECLS
+
+#endif /* __SLICES_H__ */
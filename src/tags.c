@@ -0,0 +1,286 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * tags.c: incremental tag store. Keeps the latest value of each tag,
+ * remembers which ones changed and tells the UI about it at most a
+ * few times per second.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "tags.h"
+
+static void
+value_free (GValue *value)
+{
+  g_value_unset (value);
+  g_free (value);
+}
+
+GstPlayerTags *
+gst_player_tags_new (void)
+{
+  GstPlayerTags *tags = g_new0 (GstPlayerTags, 1);
+
+  tags->values = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) value_free);
+  tags->dirty = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  return tags;
+}
+
+void
+gst_player_tags_free (GstPlayerTags *tags)
+{
+  if (tags->refresh_id != 0)
+    g_source_remove (tags->refresh_id);
+
+  g_hash_table_destroy (tags->values);
+  g_hash_table_destroy (tags->dirty);
+  g_free (tags);
+}
+
+/*
+ * func is called from the main loop at most once per interval (in
+ * milliseconds), if anything changed in between.
+ */
+
+void
+gst_player_tags_set_notify (GstPlayerTags *tags,
+			    guint          interval,
+			    GFunc          func,
+			    gpointer       data)
+{
+  tags->interval = interval;
+  tags->notify = func;
+  tags->notify_data = data;
+}
+
+static gboolean
+cb_refresh (gpointer data)
+{
+  GstPlayerTags *tags = data;
+
+  tags->refresh_id = 0;
+  if (tags->notify)
+    tags->notify (tags, tags->notify_data);
+  g_hash_table_remove_all (tags->dirty);
+
+  /* once */
+  return FALSE;
+}
+
+static void
+mark_dirty (GstPlayerTags *tags,
+	    const gchar   *tag)
+{
+  g_hash_table_insert (tags->dirty, (gpointer) tag, (gpointer) tag);
+
+  if (tags->refresh_id == 0)
+    tags->refresh_id = g_timeout_add (tags->interval, cb_refresh, tags);
+}
+
+static gboolean
+cb_mark_dirty (gpointer key,
+	       gpointer value,
+	       gpointer data)
+{
+  mark_dirty (data, key);
+
+  return TRUE;
+}
+
+/*
+ * Forget everything, e.g. when the media is discarded.
+ */
+
+void
+gst_player_tags_clear (GstPlayerTags *tags)
+{
+  g_hash_table_foreach_remove (tags->values, cb_mark_dirty, tags);
+}
+
+typedef struct _MergeData {
+  GstPlayerTags *tags;
+  gboolean changed;
+} MergeData;
+
+static gboolean
+values_equal (const GValue *a,
+	      const GValue *b)
+{
+  if (G_VALUE_TYPE (a) != G_VALUE_TYPE (b))
+    return FALSE;
+
+  /* images and other binary data: don't compare the contents, a new
+   * buffer is as good as a change */
+  if (G_VALUE_HOLDS (a, GST_TYPE_BUFFER))
+    return gst_value_get_buffer (a) == gst_value_get_buffer (b);
+
+  return gst_value_compare (a, b) == GST_VALUE_EQUAL;
+}
+
+static void
+cb_merge_tag (const GstTagList *list,
+	      const gchar      *tag,
+	      gpointer          data)
+{
+  MergeData *md = data;
+  GValue *old, *value;
+
+  /* all values of the tag, as one; for buffers, this only takes a
+   * reference */
+  tag = g_intern_string (tag);
+  value = g_new0 (GValue, 1);
+  if (!gst_tag_list_copy_value (value, list, tag)) {
+    g_free (value);
+    return;
+  }
+
+  old = g_hash_table_lookup (md->tags->values, tag);
+  if (old && values_equal (old, value)) {
+    value_free (value);
+    return;
+  }
+  g_hash_table_insert (md->tags->values, (gpointer) tag, value);
+
+  mark_dirty (md->tags, tag);
+  md->changed = TRUE;
+}
+
+/*
+ * Takes over every tag in list whose value differs from what we have.
+ * Later values replace earlier ones. Returns TRUE if anything changed.
+ */
+
+gboolean
+gst_player_tags_merge (GstPlayerTags    *tags,
+		       const GstTagList *list)
+{
+  MergeData md = { tags, FALSE };
+
+  g_return_val_if_fail (tags != NULL, FALSE);
+
+  if (list)
+    gst_tag_list_foreach (list, cb_merge_tag, &md);
+
+  return md.changed;
+}
+
+static void
+cb_add_tag (gpointer key,
+	    gpointer value,
+	    gpointer data)
+{
+  const gchar *tag = key;
+  const GValue *val = value;
+  guint n;
+
+  if (!GST_VALUE_HOLDS_LIST (val)) {
+    gst_tag_list_add_values (data, GST_TAG_MERGE_APPEND, tag, val, NULL);
+    return;
+  }
+
+  for (n = 0; n < gst_value_list_get_size (val); n++) {
+    gst_tag_list_add_values (data, GST_TAG_MERGE_APPEND, tag,
+			     gst_value_list_get_value (val, n), NULL);
+  }
+}
+
+/*
+ * Everything we have, as a new tag list, or NULL if there's nothing.
+ */
+
+GstTagList *
+gst_player_tags_to_list (GstPlayerTags *tags)
+{
+  GstTagList *list;
+
+  g_return_val_if_fail (tags != NULL, NULL);
+
+  if (g_hash_table_size (tags->values) == 0)
+    return NULL;
+  list = gst_tag_list_new ();
+  g_hash_table_foreach (tags->values, cb_add_tag, list);
+
+  return list;
+}
+
+/*
+ * Like gst_tag_list_get_string(): value is a newly allocated copy.
+ * Multiple values are joined with commas.
+ */
+
+gboolean
+gst_player_tags_get_string (GstPlayerTags *tags,
+			    const gchar   *tag,
+			    gchar        **value)
+{
+  GValue *val;
+  GString *str;
+  guint n;
+
+  g_return_val_if_fail (tags != NULL, FALSE);
+
+  val = g_hash_table_lookup (tags->values, g_intern_string (tag));
+  if (!val)
+    return FALSE;
+
+  if (G_VALUE_HOLDS_STRING (val)) {
+    if (!g_value_get_string (val))
+      return FALSE;
+    *value = g_value_dup_string (val);
+    return TRUE;
+  }
+
+  if (!GST_VALUE_HOLDS_LIST (val))
+    return FALSE;
+
+  str = g_string_new (NULL);
+  for (n = 0; n < gst_value_list_get_size (val); n++) {
+    const GValue *item = gst_value_list_get_value (val, n);
+
+    if (!G_VALUE_HOLDS_STRING (item) || !g_value_get_string (item))
+      continue;
+    if (str->len)
+      g_string_append (str, ", ");
+    g_string_append (str, g_value_get_string (item));
+  }
+  if (!str->len) {
+    g_string_free (str, TRUE);
+    return FALSE;
+  }
+  *value = g_string_free (str, FALSE);
+
+  return TRUE;
+}
+
+/*
+ * Whether tag changed since the last notification. Whatever was shown
+ * when the notification function last ran is still current for the
+ * other tags.
+ */
+
+gboolean
+gst_player_tags_is_dirty (GstPlayerTags *tags,
+			  const gchar   *tag)
+{
+  return g_hash_table_lookup (tags->dirty, g_intern_string (tag)) != NULL;
+}
@@ -0,0 +1,65 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * tags.h: incremental tag store.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __TAGS_H__
+#define __TAGS_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstPlayerTags {
+  /* interned tag name -> GValue, all values of the tag merged into
+   * one (a list, or joined text for most text tags) */
+  GHashTable *values;
+
+  /* interned tag names changed since the last notification */
+  GHashTable *dirty;
+
+  /* batched notification */
+  guint interval;
+  guint refresh_id;
+  GFunc notify;
+  gpointer notify_data;
+} GstPlayerTags;
+
+GstPlayerTags *	gst_player_tags_new		(void);
+void		gst_player_tags_free		(GstPlayerTags *tags);
+void		gst_player_tags_set_notify	(GstPlayerTags *tags,
+						 guint          interval,
+						 GFunc          func,
+						 gpointer       data);
+
+void		gst_player_tags_clear		(GstPlayerTags *tags);
+gboolean	gst_player_tags_merge		(GstPlayerTags *tags,
+						 const GstTagList *list);
+GstTagList *	gst_player_tags_to_list		(GstPlayerTags *tags);
+
+gboolean	gst_player_tags_get_string	(GstPlayerTags *tags,
+						 const gchar   *tag,
+						 gchar        **value);
+gboolean	gst_player_tags_is_dirty	(GstPlayerTags *tags,
+						 const gchar   *tag);
+
+G_END_DECLS
+
+#endif /* __TAGS_H__ */
@@ -0,0 +1,153 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * test-discfs.c: prints what cd_fs_detect() makes of a disc image,
+ * for check-discfs.sh. With --damage, every sector of the image is
+ * in turn overwritten with garbage and the image cut off there, and
+ * detection run on each, so that the bounds checks get exercised.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "discfs.h"
+
+#define SECTOR_SIZE 2048
+
+static const gchar *
+type_name (CdType type)
+{
+  switch (type) {
+    case CD_TYPE_DATA:
+      return "data";
+    case CD_TYPE_VCD:
+      return "vcd";
+    case CD_TYPE_SVCD:
+      return "svcd";
+    case CD_TYPE_DVD:
+      return "dvd";
+    default:
+      return "error";
+  }
+}
+
+static CdType
+detect_fd (gint fd)
+{
+  CdFs *fs;
+  CdType type;
+
+  if (!(fs = cd_fs_open_fd (fd, NULL)))
+    return CD_TYPE_ERROR;
+  type = cd_fs_detect (fs);
+  cd_fs_free (fs);
+
+  return type;
+}
+
+/*
+ * Whatever detection makes of a damaged image, it must not crash or
+ * read outside its buffers (run under valgrind to see the latter).
+ */
+
+static gint
+run_damage (const gchar *image)
+{
+  guint8 garbage[SECTOR_SIZE];
+  gchar *contents, *tmp;
+  gsize len, sectors, n;
+  GError *err = NULL;
+  gint fd;
+
+  if (!g_file_get_contents (image, &contents, &len, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    return EXIT_FAILURE;
+  }
+  if ((fd = g_file_open_tmp ("test-discfs-XXXXXX", &tmp, &err)) < 0) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    g_free (contents);
+    return EXIT_FAILURE;
+  }
+
+  /* long record and name lengths, invalid tags and huge sizes */
+  memset (garbage, 0xff, sizeof (garbage));
+
+  sectors = len / SECTOR_SIZE;
+  for (n = 0; n < sectors; n++) {
+    gsize off = n * SECTOR_SIZE;
+
+    /* overwritten */
+    if (ftruncate (fd, 0) < 0 ||
+        pwrite (fd, contents, len, 0) != len ||
+        pwrite (fd, garbage, SECTOR_SIZE, off) != SECTOR_SIZE)
+      break;
+    detect_fd (fd);
+
+    /* cut off */
+    if (ftruncate (fd, off) < 0)
+      break;
+    detect_fd (fd);
+  }
+
+  close (fd);
+  g_unlink (tmp);
+  g_free (tmp);
+  g_free (contents);
+
+  if (n < sectors) {
+    g_printerr ("Failed to write damaged image\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  gint fd;
+
+  if (argc == 3 && !strcmp (argv[1], "--damage"))
+    return run_damage (argv[2]);
+
+  if (argc != 2) {
+    g_printerr ("Usage: %s [--damage] IMAGE\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if ((fd = open (argv[1], O_RDONLY)) < 0) {
+    g_printerr ("Failed to open %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  g_print ("%s\n", type_name (detect_fd (fd)));
+  close (fd);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,405 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * thumbnailer.c: timeline preview images. A low-priority thread runs
+ * its own, separate playbin on the same media, seeks it to keyframes
+ * only and keeps small RGB snapshots in a size-capped LRU cache. The
+ * main pipeline is never touched.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thumbnailer.h"
+
+/* thumbnails are this high, and one per this much media time */
+#define THUMB_HEIGHT	90
+#define THUMB_STEP	(2 * GST_SECOND)
+
+/* memory cap of the cache, in bytes */
+#define THUMB_CACHE_SIZE (4 * 1024 * 1024)
+
+/* how long to wait for the secondary pipeline */
+#define THUMB_TIMEOUT	(5 * GST_SECOND)
+
+#define THUMB_CAPS \
+  "video/x-raw-rgb,bpp=24,depth=24,endianness=4321," \
+  "red_mask=16711680,green_mask=65280,blue_mask=255," \
+  "pixel-aspect-ratio=1/1,height=" G_STRINGIFY (THUMB_HEIGHT)
+
+typedef struct _GstPlayerThumbnail {
+  GstClockTime position;
+  GdkPixbuf *pixbuf;
+} GstPlayerThumbnail;
+
+static gpointer	thumbnailer_thread	(gpointer data);
+
+#define SLOT(position) GUINT_TO_POINTER ((guint) ((position) / THUMB_STEP))
+
+static gsize
+pixbuf_size (GdkPixbuf *pixbuf)
+{
+  return gdk_pixbuf_get_rowstride (pixbuf) * gdk_pixbuf_get_height (pixbuf);
+}
+
+GstPlayerThumbnailer *
+gst_player_thumbnailer_new (GstPlayerThumbnailFunc func,
+			    gpointer               data)
+{
+  GstPlayerThumbnailer *th = g_new0 (GstPlayerThumbnailer, 1);
+
+  th->lock = g_mutex_new ();
+  th->cond = g_cond_new ();
+  th->request = GST_CLOCK_TIME_NONE;
+  th->cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, g_object_unref);
+  th->lru = g_queue_new ();
+  th->func = func;
+  th->data = data;
+
+  th->thread = g_thread_create_full (thumbnailer_thread, th, 0, TRUE,
+				     FALSE, G_THREAD_PRIORITY_LOW, NULL);
+
+  return th;
+}
+
+static void
+cache_clear (GstPlayerThumbnailer *th)
+{
+  g_hash_table_remove_all (th->cache);
+  g_queue_clear (th->lru);
+  th->cache_size = 0;
+}
+
+static void
+results_clear (GstPlayerThumbnailer *th)
+{
+  GList *item;
+
+  for (item = th->results; item != NULL; item = item->next) {
+    GstPlayerThumbnail *thumb = item->data;
+
+    g_object_unref (thumb->pixbuf);
+    g_free (thumb);
+  }
+  g_list_free (th->results);
+  th->results = NULL;
+}
+
+void
+gst_player_thumbnailer_free (GstPlayerThumbnailer *th)
+{
+  g_mutex_lock (th->lock);
+  th->quit = TRUE;
+  g_cond_signal (th->cond);
+  g_mutex_unlock (th->lock);
+
+  if (th->thread)
+    g_thread_join (th->thread);
+
+  if (th->notify_id != 0)
+    g_source_remove (th->notify_id);
+  results_clear (th);
+  cache_clear (th);
+  g_hash_table_destroy (th->cache);
+  g_queue_free (th->lru);
+  g_free (th->uri);
+  g_cond_free (th->cond);
+  g_mutex_free (th->lock);
+  g_free (th);
+}
+
+/*
+ * Switches to other media (or none), forgetting all thumbnails.
+ */
+
+void
+gst_player_thumbnailer_set_uri (GstPlayerThumbnailer *th,
+				const gchar          *uri)
+{
+  g_mutex_lock (th->lock);
+  g_free (th->uri);
+  th->uri = g_strdup (uri);
+  th->generation++;
+  th->request = GST_CLOCK_TIME_NONE;
+  cache_clear (th);
+  results_clear (th);
+  g_mutex_unlock (th->lock);
+}
+
+/*
+ * A new reference to the cached thumbnail near position, or NULL.
+ */
+
+GdkPixbuf *
+gst_player_thumbnailer_lookup (GstPlayerThumbnailer *th,
+			       GstClockTime          position)
+{
+  GdkPixbuf *pixbuf;
+
+  g_mutex_lock (th->lock);
+  if ((pixbuf = g_hash_table_lookup (th->cache, SLOT (position)))) {
+    g_object_ref (pixbuf);
+    g_queue_remove (th->lru, SLOT (position));
+    g_queue_push_head (th->lru, SLOT (position));
+  }
+  g_mutex_unlock (th->lock);
+
+  return pixbuf;
+}
+
+/*
+ * Asks for a thumbnail near position. Replaces earlier requests that
+ * weren't started yet; func is called when it's done.
+ */
+
+void
+gst_player_thumbnailer_request (GstPlayerThumbnailer *th,
+				GstClockTime          position)
+{
+  g_mutex_lock (th->lock);
+  if (th->uri && !g_hash_table_lookup (th->cache, SLOT (position))) {
+    th->request = position;
+    g_cond_signal (th->cond);
+  }
+  g_mutex_unlock (th->lock);
+}
+
+static gboolean
+cb_notify (gpointer data)
+{
+  GstPlayerThumbnailer *th = data;
+  GList *results, *item;
+
+  g_mutex_lock (th->lock);
+  results = g_list_reverse (th->results);
+  th->results = NULL;
+  th->notify_id = 0;
+  g_mutex_unlock (th->lock);
+
+  for (item = results; item != NULL; item = item->next) {
+    GstPlayerThumbnail *thumb = item->data;
+
+    if (th->func)
+      th->func (thumb->position, thumb->pixbuf, th->data);
+    g_object_unref (thumb->pixbuf);
+    g_free (thumb);
+  }
+  g_list_free (results);
+
+  return FALSE;
+}
+
+/*
+ * Called with the lock held.
+ */
+
+static void
+cache_add (GstPlayerThumbnailer *th,
+	   GstClockTime          position,
+	   GdkPixbuf            *pixbuf)
+{
+  GstPlayerThumbnail *thumb;
+
+  if (!g_hash_table_lookup (th->cache, SLOT (position))) {
+    g_hash_table_insert (th->cache, SLOT (position), g_object_ref (pixbuf));
+    g_queue_push_head (th->lru, SLOT (position));
+    th->cache_size += pixbuf_size (pixbuf);
+  }
+
+  while (th->cache_size > THUMB_CACHE_SIZE && th->lru->length > 1) {
+    gpointer slot = g_queue_pop_tail (th->lru);
+
+    th->cache_size -= pixbuf_size (g_hash_table_lookup (th->cache, slot));
+    g_hash_table_remove (th->cache, slot);
+  }
+
+  thumb = g_new (GstPlayerThumbnail, 1);
+  thumb->position = position;
+  thumb->pixbuf = g_object_ref (pixbuf);
+  th->results = g_list_prepend (th->results, thumb);
+  if (th->notify_id == 0)
+    th->notify_id = g_idle_add (cb_notify, th);
+}
+
+/*
+ * Secondary pipeline, only used from the thumbnailer thread.
+ */
+
+static gboolean
+pipeline_wait (GstElement *pipeline)
+{
+  GstBus *bus = gst_element_get_bus (pipeline);
+  GstMessage *msg;
+  gboolean res = FALSE;
+
+  msg = gst_bus_timed_pop_filtered (bus, THUMB_TIMEOUT,
+      GST_MESSAGE_ASYNC_DONE | GST_MESSAGE_ERROR);
+  if (msg) {
+    res = GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ASYNC_DONE;
+    gst_message_unref (msg);
+  }
+  gst_object_unref (GST_OBJECT (bus));
+
+  return res;
+}
+
+static void
+pipeline_free (GstElement *pipeline,
+	       GstElement *sink)
+{
+  if (sink)
+    gst_object_unref (GST_OBJECT (sink));
+  if (pipeline) {
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (GST_OBJECT (pipeline));
+  }
+}
+
+static GstElement *
+pipeline_new (const gchar *uri,
+	      GstElement **sink)
+{
+  GstElement *play, *video, *audio;
+
+  *sink = NULL;
+  if (!(play = gst_element_factory_make ("playbin", "thumbnailer")))
+    return NULL;
+  if (!(video = gst_parse_bin_from_description ("ffmpegcolorspace ! "
+           "videoscale ! " THUMB_CAPS " ! fakesink name=thumb-sink",
+           TRUE, NULL)) ||
+      !(audio = gst_element_factory_make ("fakesink", "thumb-audio"))) {
+    if (video)
+      gst_object_unref (GST_OBJECT (video));
+    gst_object_unref (GST_OBJECT (play));
+    return NULL;
+  }
+  *sink = gst_bin_get_by_name (GST_BIN (video), "thumb-sink");
+  g_object_set (play, "uri", uri,
+		"video-sink", video, "audio-sink", audio, NULL);
+
+  if (gst_element_set_state (play,
+          GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE ||
+      !pipeline_wait (play)) {
+    pipeline_free (play, *sink);
+    *sink = NULL;
+    return NULL;
+  }
+
+  return play;
+}
+
+static GdkPixbuf *
+pipeline_grab (GstElement  *pipeline,
+	       GstElement  *sink,
+	       GstClockTime position)
+{
+  GstBuffer *buf = NULL;
+  GstStructure *s;
+  GdkPixbuf *pixbuf = NULL;
+  gint width = 0, height = 0, stride;
+
+  if (!gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT, position) ||
+      !pipeline_wait (pipeline))
+    return NULL;
+
+  g_object_get (sink, "last-buffer", &buf, NULL);
+  if (!buf)
+    return NULL;
+
+  if (GST_BUFFER_CAPS (buf)) {
+    s = gst_caps_get_structure (GST_BUFFER_CAPS (buf), 0);
+    gst_structure_get_int (s, "width", &width);
+    gst_structure_get_int (s, "height", &height);
+  }
+  stride = GST_ROUND_UP_4 (width * 3);
+  if (width > 0 && height > 0 && GST_BUFFER_SIZE (buf) >= stride * height) {
+    pixbuf = gdk_pixbuf_new_from_data (
+        g_memdup (GST_BUFFER_DATA (buf), stride * height),
+        GDK_COLORSPACE_RGB, FALSE, 8, width, height, stride,
+        (GdkPixbufDestroyNotify) g_free, NULL);
+  }
+  gst_buffer_unref (buf);
+
+  return pixbuf;
+}
+
+static gpointer
+thumbnailer_thread (gpointer data)
+{
+  GstPlayerThumbnailer *th = data;
+  GstElement *pipeline = NULL, *sink = NULL;
+  guint generation = 0;
+  gboolean broken = FALSE, grabbed = FALSE;
+
+  g_mutex_lock (th->lock);
+  while (!th->quit) {
+    GstClockTime position;
+    GdkPixbuf *pixbuf = NULL;
+    gchar *uri;
+
+    if (!GST_CLOCK_TIME_IS_VALID (th->request)) {
+      g_cond_wait (th->cond, th->lock);
+      continue;
+    }
+    position = th->request;
+    th->request = GST_CLOCK_TIME_NONE;
+
+    /* other media, start over */
+    if (generation != th->generation) {
+      pipeline_free (pipeline, sink);
+      pipeline = sink = NULL;
+      generation = th->generation;
+      broken = grabbed = FALSE;
+    }
+    uri = g_strdup (th->uri);
+    g_mutex_unlock (th->lock);
+
+    if (!pipeline && !broken && uri) {
+      if (!(pipeline = pipeline_new (uri, &sink)))
+        broken = TRUE;
+    }
+    g_free (uri);
+
+    if (pipeline) {
+      if ((pixbuf = pipeline_grab (pipeline, sink,
+                        position - position % THUMB_STEP))) {
+        grabbed = TRUE;
+      } else {
+        /* audio-only media never has a frame, don't keep trying */
+        pipeline_free (pipeline, sink);
+        pipeline = sink = NULL;
+        broken = !grabbed;
+      }
+    }
+
+    g_mutex_lock (th->lock);
+    if (pixbuf) {
+      if (generation == th->generation)
+        cache_add (th, position, pixbuf);
+      g_object_unref (pixbuf);
+    }
+  }
+  g_mutex_unlock (th->lock);
+
+  pipeline_free (pipeline, sink);
+
+  return NULL;
+}
@@ -0,0 +1,73 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * thumbnailer.h: timeline preview images
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __THUMBNAILER_H__
+#define __THUMBNAILER_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+typedef void (* GstPlayerThumbnailFunc) (GstClockTime position,
+					 GdkPixbuf   *thumb,
+					 gpointer     data);
+
+typedef struct _GstPlayerThumbnailer {
+  GThread *thread;
+  GMutex *lock;
+  GCond *cond;
+  gboolean quit;
+
+  /* media and the latest position asked for; the generation
+   * changes with the media */
+  gchar *uri;
+  guint generation;
+  GstClockTime request;
+
+  /* LRU cache of position slot -> GdkPixbuf, newest first */
+  GHashTable *cache;
+  GQueue *lru;
+  gsize cache_size;
+
+  /* finished thumbnails, handed to func from the main loop */
+  GList *results;
+  guint notify_id;
+  GstPlayerThumbnailFunc func;
+  gpointer data;
+} GstPlayerThumbnailer;
+
+GstPlayerThumbnailer *
+		gst_player_thumbnailer_new	(GstPlayerThumbnailFunc func,
+						 gpointer data);
+void		gst_player_thumbnailer_free	(GstPlayerThumbnailer *th);
+
+void		gst_player_thumbnailer_set_uri	(GstPlayerThumbnailer *th,
+						 const gchar *uri);
+GdkPixbuf *	gst_player_thumbnailer_lookup	(GstPlayerThumbnailer *th,
+						 GstClockTime position);
+void		gst_player_thumbnailer_request	(GstPlayerThumbnailer *th,
+						 GstClockTime position);
+
+G_END_DECLS
+
+#endif /* __THUMBNAILER_H__ */
@@ -39,6 +39,15 @@ static gboolean	cb_button_press			(GtkWidget      *widget,
 static gboolean	cb_button_release		(GtkWidget      *widget,
 						 GdkEventButton *event,
 						 gpointer        data);
+static gboolean	cb_motion			(GtkWidget      *widget,
+						 GdkEventMotion *event,
+						 gpointer        data);
+static gboolean	cb_leave			(GtkWidget      *widget,
+						 GdkEventCrossing *event,
+						 gpointer        data);
+static void	cb_thumbnail			(GstClockTime    position,
+						 GdkPixbuf      *thumb,
+						 gpointer        data);
 
 static void	cb_state			(GstElement     *play,
 						 GstState        old_state,
@@ -98,10 +107,29 @@ gst_player_timer_init (GstPlayerTimer *timer)
   GtkBox *box = GTK_BOX (timer);
 
   timer->play = NULL;
+  timer->disp = NULL;
+  timer->sub_id = 0;
   timer->lock = FALSE;
   timer->seeking = FALSE;
+  timer->dragged = FALSE;
+  timer->seek = NULL;
+  timer->settle_id = 0;
+  timer->thumbs = NULL;
+  timer->hover = GST_CLOCK_TIME_NONE;
+  timer->hover_x = 0;
   timer->len = GST_CLOCK_TIME_NONE;
   timer->pos = GST_CLOCK_TIME_NONE;
+  timer->known_len = GST_CLOCK_TIME_NONE;
+  timer->len_cached = FALSE;
+  timer->timeout_id = 0;
+  timer->wakeups = 0;
+  timer->wakeup_timer = g_timer_new ();
+  timer->anchor_pos = GST_CLOCK_TIME_NONE;
+  timer->anchor_time = GST_CLOCK_TIME_NONE;
+  timer->anchor_base = GST_CLOCK_TIME_NONE;
+  timer->queries = 0;
+  timer->query_rate = 0.;
+  timer->wakeup_rate = 0.;
 
   /* how-do-I-look stuff */
   gtk_container_set_border_width (GTK_CONTAINER (timer), 6);
@@ -116,7 +144,7 @@ gst_player_timer_init (GstPlayerTimer *timer)
 
   slider = gtk_hscale_new (NULL);
   timer->range = GTK_RANGE (slider);
-  gtk_range_set_update_policy (timer->range, GTK_UPDATE_DISCONTINUOUS);
+  gtk_range_set_update_policy (timer->range, GTK_UPDATE_CONTINUOUS);
   gtk_scale_set_draw_value (GTK_SCALE (slider), FALSE);
   gtk_box_pack_start (box, slider, TRUE, TRUE, 0);
   gtk_widget_show (slider);
@@ -125,6 +153,18 @@ gst_player_timer_init (GstPlayerTimer *timer)
       G_CALLBACK (cb_button_press), timer);
   g_signal_connect (slider, "button-release-event",
       G_CALLBACK (cb_button_release), timer);
+  gtk_widget_add_events (slider,
+      GDK_POINTER_MOTION_MASK | GDK_LEAVE_NOTIFY_MASK);
+  g_signal_connect (slider, "motion-notify-event",
+      G_CALLBACK (cb_motion), timer);
+  g_signal_connect (slider, "leave-notify-event",
+      G_CALLBACK (cb_leave), timer);
+
+  /* preview popup */
+  timer->preview = gtk_window_new (GTK_WINDOW_POPUP);
+  timer->preview_image = gtk_image_new ();
+  gtk_container_add (GTK_CONTAINER (timer->preview), timer->preview_image);
+  gtk_widget_show (timer->preview_image);
 
   /* FIXME:
    * - show time we're seeking too if user moves slider.
@@ -132,8 +172,7 @@ gst_player_timer_init (GstPlayerTimer *timer)
 }
 
 static void
-cb_message (GstBus    *bus,
-            GstMessage*message,
+cb_message (GstMessage*message,
             gpointer   user_data)
 {
   switch (message->type) {
@@ -158,7 +197,8 @@ cb_message (GstBus    *bus,
 }
 
 GtkWidget *
-gst_player_timer_new (GstElement *play)
+gst_player_timer_new (GstElement          *play,
+		      GstPlayerDispatcher *disp)
 {
   GstPlayerTimer *timer =
       g_object_new (GST_PLAYER_TYPE_TIMER, NULL);
@@ -167,7 +207,12 @@ gst_player_timer_new (GstElement *play)
     gst_object_ref (GST_OBJECT (play));
     timer->play = play;
 
-    g_signal_connect (gst_pipeline_get_bus (GST_PIPELINE (play)), "message", G_CALLBACK (cb_message), timer);
+    /* only the pipeline's own state matters to us */
+    timer->disp = disp;
+    timer->sub_id = gst_player_dispatcher_subscribe (disp,
+        GST_MESSAGE_STATE_CHANGED, GST_OBJECT (play), cb_message, timer);
+    timer->seek = gst_player_seek_new (play, disp);
+    timer->thumbs = gst_player_thumbnailer_new (cb_thumbnail, timer);
   }
   cb_state (NULL, GST_STATE_PLAYING, GST_STATE_NULL, timer);
 
@@ -179,6 +224,38 @@ gst_player_timer_dispose (GObject *object)
 {
   GstPlayerTimer *timer = GST_PLAYER_TIMER (object);
 
+  gst_player_timer_stop (timer);
+
+  if (timer->settle_id != 0) {
+    g_source_remove (timer->settle_id);
+    timer->settle_id = 0;
+  }
+
+  if (timer->seek) {
+    gst_player_seek_free (timer->seek);
+    timer->seek = NULL;
+  }
+
+  if (timer->thumbs) {
+    gst_player_thumbnailer_free (timer->thumbs);
+    timer->thumbs = NULL;
+  }
+
+  if (timer->preview) {
+    gtk_widget_destroy (timer->preview);
+    timer->preview = NULL;
+  }
+
+  if (timer->sub_id != 0) {
+    gst_player_dispatcher_unsubscribe (timer->disp, timer->sub_id);
+    timer->sub_id = 0;
+  }
+
+  if (timer->wakeup_timer) {
+    g_timer_destroy (timer->wakeup_timer);
+    timer->wakeup_timer = NULL;
+  }
+
   if (timer->play) {
     gst_object_unref (GST_OBJECT (timer->play));
     timer->play = NULL;
@@ -214,6 +291,69 @@ time_to_string (guint64 time)
 			  (guint) ((time / GST_SECOND) % 60));
 }
 
+/*
+ * Position from the pipeline clock: the running time since the last
+ * real query is added to the position it returned. This only works
+ * while playing at normal rate, and only until the base time changes,
+ * which it does after every pause and flushing seek.
+ */
+
+#define RESYNC_INTERVAL	(5 * GST_SECOND)
+
+static gboolean
+position_extrapolate (GstPlayerTimer *timer,
+		      gint64         *value)
+{
+  GstClock *clock;
+  GstClockTime now, base;
+
+  if (!GST_CLOCK_TIME_IS_VALID (timer->anchor_pos) ||
+      GST_STATE (timer->play) != GST_STATE_PLAYING ||
+      GST_STATE_PENDING (timer->play) != GST_STATE_VOID_PENDING)
+    return FALSE;
+
+  if (!(clock = gst_element_get_clock (timer->play)))
+    return FALSE;
+  now = gst_clock_get_time (clock);
+  gst_object_unref (GST_OBJECT (clock));
+  base = gst_element_get_base_time (timer->play);
+
+  /* correct drift now and then */
+  if (base != timer->anchor_base || now < base + timer->anchor_time ||
+      now - base - timer->anchor_time >= RESYNC_INTERVAL)
+    return FALSE;
+
+  *value = timer->anchor_pos + (now - base - timer->anchor_time);
+  if (GST_CLOCK_TIME_IS_VALID (timer->len) && *value > timer->len)
+    *value = timer->len;
+
+  return TRUE;
+}
+
+static void
+position_anchor (GstPlayerTimer *timer,
+		 gint64          value)
+{
+  GstClock *clock;
+  GstClockTime now, base;
+
+  timer->anchor_pos = GST_CLOCK_TIME_NONE;
+  if (GST_STATE (timer->play) != GST_STATE_PLAYING ||
+      GST_STATE_PENDING (timer->play) != GST_STATE_VOID_PENDING ||
+      !(clock = gst_element_get_clock (timer->play)))
+    return;
+
+  now = gst_clock_get_time (clock);
+  gst_object_unref (GST_OBJECT (clock));
+  base = gst_element_get_base_time (timer->play);
+  if (now < base)
+    return;
+
+  timer->anchor_pos = value;
+  timer->anchor_time = now - base;
+  timer->anchor_base = base;
+}
+
 void
 gst_player_timer_progress (GstPlayerTimer *timer)
 {
@@ -225,23 +365,40 @@ gst_player_timer_progress (GstPlayerTimer *timer)
   gboolean new_len = FALSE, new_pos = FALSE;
 
   /* get length/position */
-  if (!GST_CLOCK_TIME_IS_VALID (timer->len)) {
+  if (!GST_CLOCK_TIME_IS_VALID (timer->len) || timer->len_cached) {
     query = gst_query_new_duration (fmt);
+    timer->queries++;
     if (gst_element_query (timer->play, query)) {
       gst_query_parse_duration (query, &fmt, &value);
+      if (timer->len != value)
+        new_len = TRUE;
       timer->len = value;
+      timer->len_cached = FALSE;
+    } else if (!GST_CLOCK_TIME_IS_VALID (timer->len) &&
+	       GST_CLOCK_TIME_IS_VALID (timer->known_len)) {
+      /* keep asking until the pipeline knows */
+      timer->len = timer->known_len;
+      timer->len_cached = TRUE;
       new_len = TRUE;
     }
     gst_query_unref (query);
   }
-  query = gst_query_new_position (fmt);
-  if (gst_element_query (timer->play, query)) {
-    gst_query_parse_position (query, &fmt, &value);
+  if (position_extrapolate (timer, &value)) {
     if ((timer->pos / GST_SECOND) != (value / GST_SECOND))
       new_pos = TRUE;
     timer->pos = value;
+  } else {
+    query = gst_query_new_position (fmt);
+    timer->queries++;
+    if (gst_element_query (timer->play, query)) {
+      gst_query_parse_position (query, &fmt, &value);
+      if ((timer->pos / GST_SECOND) != (value / GST_SECOND))
+        new_pos = TRUE;
+      timer->pos = value;
+      position_anchor (timer, value);
+    }
+    gst_query_unref (query);
   }
-  gst_query_unref (query);
 
   if (GST_CLOCK_TIME_IS_VALID (timer->pos)) {
     gboolean new_label = FALSE;
@@ -290,6 +447,119 @@ gst_player_timer_progress (GstPlayerTimer *timer)
   timer->lock = FALSE;
 }
 
+/*
+ * Progress scheduling. Rather than polling, we compute when the next
+ * visible change will happen (the label's second flips or the slider
+ * handle moves by one pixel) and sleep until then.
+ */
+
+#define MIN_INTERVAL	(40 * GST_MSECOND)
+#define MAX_INTERVAL	(GST_SECOND)
+
+static guint
+next_interval (GstPlayerTimer *timer)
+{
+  GstClockTime interval = MAX_INTERVAL;
+  gint width = GTK_WIDGET (timer->range)->allocation.width;
+
+  if (GST_CLOCK_TIME_IS_VALID (timer->pos)) {
+    /* label */
+    interval = GST_SECOND - (timer->pos % GST_SECOND);
+
+    /* slider */
+    if (GST_CLOCK_TIME_IS_VALID (timer->len) && width > 1) {
+      GstClockTime pixel = timer->len / width;
+
+      if (pixel > 0 && pixel - (timer->pos % pixel) < interval)
+        interval = pixel - (timer->pos % pixel);
+    }
+  }
+
+  interval = CLAMP (interval, MIN_INTERVAL, MAX_INTERVAL);
+
+  return interval / GST_MSECOND;
+}
+
+static gboolean
+cb_tick (gpointer data)
+{
+  GstPlayerTimer *timer = GST_PLAYER_TIMER (data);
+  gdouble elapsed;
+
+  timer->wakeups++;
+  elapsed = g_timer_elapsed (timer->wakeup_timer, NULL);
+  if (elapsed >= 1.) {
+    timer->wakeup_rate = timer->wakeups / elapsed;
+    timer->query_rate = timer->queries / elapsed;
+    timer->wakeups = 0;
+    timer->queries = 0;
+    g_timer_start (timer->wakeup_timer);
+  }
+
+  gst_player_timer_progress (timer);
+
+  /* and sleep until the next visible change */
+  timer->timeout_id = g_timeout_add (next_interval (timer), cb_tick, timer);
+
+  return FALSE;
+}
+
+void
+gst_player_timer_start (GstPlayerTimer *timer)
+{
+  g_return_if_fail (GST_PLAYER_IS_TIMER (timer));
+
+  gst_player_timer_stop (timer);
+
+  timer->wakeups = 0;
+  timer->wakeup_rate = 0.;
+  timer->queries = 0;
+  timer->query_rate = 0.;
+  g_timer_start (timer->wakeup_timer);
+
+  gst_player_timer_progress (timer);
+  timer->timeout_id = g_timeout_add (next_interval (timer), cb_tick, timer);
+}
+
+void
+gst_player_timer_stop (GstPlayerTimer *timer)
+{
+  g_return_if_fail (GST_PLAYER_IS_TIMER (timer));
+
+  if (timer->timeout_id != 0) {
+    g_source_remove (timer->timeout_id);
+    timer->timeout_id = 0;
+  }
+  timer->wakeup_rate = 0.;
+  timer->query_rate = 0.;
+}
+
+/*
+ * Number of progress wakeups per second during the last second of
+ * playback. Should stay around one for most media.
+ */
+
+gfloat
+gst_player_timer_get_wakeup_rate (GstPlayerTimer *timer)
+{
+  g_return_val_if_fail (GST_PLAYER_IS_TIMER (timer), 0.);
+
+  return timer->wakeup_rate;
+}
+
+/*
+ * Number of duration and position queries per second, over the same
+ * period. Most positions should come from the clock instead.
+ */
+
+gfloat
+gst_player_timer_get_query_rate (GstPlayerTimer *timer)
+{
+  g_return_val_if_fail (GST_PLAYER_IS_TIMER (timer), 0.);
+
+  return timer->query_rate;
+}
+
 static gboolean
 cb_button_press (GtkWidget      *widget,
 		 GdkEventButton *event,
@@ -298,6 +568,15 @@ cb_button_press (GtkWidget      *widget,
   GstPlayerTimer *timer = GST_PLAYER_TIMER (data);
 
   timer->seeking = TRUE;
+  timer->dragged = FALSE;
+
+  /* a keyboard or wheel seek still waiting to settle must not land
+   * after the release; the release seeks accurately instead */
+  if (timer->settle_id != 0) {
+    g_source_remove (timer->settle_id);
+    timer->settle_id = 0;
+    timer->dragged = TRUE;
+  }
 
   return FALSE;
 }
@@ -311,9 +590,99 @@ cb_button_release (GtkWidget      *widget,
 
   timer->seeking = FALSE;
 
+  /* land exactly where the user let go */
+  if (timer->dragged && timer->seek) {
+    gst_player_seek_request (timer->seek,
+			     gtk_range_get_value (timer->range), TRUE);
+  }
+  timer->dragged = FALSE;
+
   return FALSE;
 }
 
+/*
+ * Previews. The popup sits right above the slider, centered on the
+ * pointer.
+ */
+
+static void
+preview_update (GstPlayerTimer *timer)
+{
+  GtkWidget *range = GTK_WIDGET (timer->range);
+  GdkPixbuf *thumb;
+  gint x, y;
+
+  if (!GST_CLOCK_TIME_IS_VALID (timer->hover) ||
+      !(thumb = gst_player_thumbnailer_lookup (timer->thumbs, timer->hover)))
+    return;
+
+  gtk_image_set_from_pixbuf (GTK_IMAGE (timer->preview_image), thumb);
+  gdk_window_get_origin (range->window, &x, &y);
+  gtk_window_move (GTK_WINDOW (timer->preview),
+      timer->hover_x - gdk_pixbuf_get_width (thumb) / 2,
+      y + range->allocation.y - gdk_pixbuf_get_height (thumb) - 6);
+  gtk_widget_show (timer->preview);
+  g_object_unref (thumb);
+}
+
+static void
+cb_thumbnail (GstClockTime position,
+	      GdkPixbuf   *thumb,
+	      gpointer     data)
+{
+  preview_update (GST_PLAYER_TIMER (data));
+}
+
+static gboolean
+cb_motion (GtkWidget      *widget,
+	   GdkEventMotion *event,
+	   gpointer        data)
+{
+  GstPlayerTimer *timer = GST_PLAYER_TIMER (data);
+  gint width = widget->allocation.width;
+
+  if (!timer->thumbs || !GST_CLOCK_TIME_IS_VALID (timer->len) ||
+      timer->len == 0 || width <= 0)
+    return FALSE;
+
+  timer->hover = timer->len * CLAMP (event->x / width, 0., 1.);
+  timer->hover_x = event->x_root;
+  gst_player_thumbnailer_request (timer->thumbs, timer->hover);
+  preview_update (timer);
+
+  return FALSE;
+}
+
+static gboolean
+cb_leave (GtkWidget        *widget,
+	  GdkEventCrossing *event,
+	  gpointer          data)
+{
+  GstPlayerTimer *timer = GST_PLAYER_TIMER (data);
+
+  timer->hover = GST_CLOCK_TIME_NONE;
+  gtk_widget_hide (timer->preview);
+
+  return FALSE;
+}
+
+static void
+show_known_len (GstPlayerTimer *timer)
+{
+  gchar *tmp, *label;
+
+  if (!GST_CLOCK_TIME_IS_VALID (timer->known_len)) {
+    gtk_label_set_text (timer->label, "0:00");
+    return;
+  }
+
+  tmp = time_to_string (timer->known_len);
+  label = g_strdup_printf ("0:00 / %s", tmp);
+  gtk_label_set_text (timer->label, label);
+  g_free (label);
+  g_free (tmp);
+}
+
 static void
 cb_state (GstElement*play,
 	  GstState   old_state,
@@ -325,27 +694,86 @@ cb_state (GstElement*play,
   if (old_state <= GST_STATE_READY &&
       new_state >= GST_STATE_PAUSED) {
     gtk_widget_set_sensitive (GTK_WIDGET (timer), TRUE);
+    if (timer->thumbs) {
+      gchar *uri = NULL;
+
+      g_object_get (timer->play, "uri", &uri, NULL);
+      gst_player_thumbnailer_set_uri (timer->thumbs, uri);
+      g_free (uri);
+    }
   } else if (old_state >= GST_STATE_PAUSED &&
              new_state <= GST_STATE_READY) {
+    if (timer->thumbs)
+      gst_player_thumbnailer_set_uri (timer->thumbs, NULL);
+    timer->hover = GST_CLOCK_TIME_NONE;
+    gtk_widget_hide (timer->preview);
     gtk_widget_set_sensitive (GTK_WIDGET (timer), FALSE);
     gtk_widget_set_sensitive (GTK_WIDGET (timer->range), FALSE);
-    gtk_label_set_text (timer->label, "0:00");
     gtk_range_set_adjustment (timer->range, NULL);
     timer->len = GST_CLOCK_TIME_NONE;
+    timer->len_cached = FALSE;
     timer->pos = GST_CLOCK_TIME_NONE;
+    timer->anchor_pos = GST_CLOCK_TIME_NONE;
+    show_known_len (timer);
   }
 }
 
+/*
+ * Duration of the media that's about to be played, as far as known
+ * beforehand, or GST_CLOCK_TIME_NONE. It's shown right away and
+ * used until the pipeline can answer the duration query itself.
+ * The media may also have changed while playing, on a gapless
+ * playlist switch, so everything is queried again.
+ */
+
+void
+gst_player_timer_set_duration (GstPlayerTimer *timer,
+			       GstClockTime    duration)
+{
+  g_return_if_fail (GST_PLAYER_IS_TIMER (timer));
+
+  timer->known_len = duration;
+  timer->len = GST_CLOCK_TIME_NONE;
+  timer->len_cached = FALSE;
+  timer->anchor_pos = GST_CLOCK_TIME_NONE;
+  show_known_len (timer);
+}
+
+#define SETTLE_INTERVAL	250
+
+static gboolean
+cb_settle (gpointer data)
+{
+  GstPlayerTimer *timer = GST_PLAYER_TIMER (data);
+
+  timer->settle_id = 0;
+  if (!timer->seeking) {
+    gst_player_seek_request (timer->seek,
+			     gtk_range_get_value (timer->range), TRUE);
+  }
+
+  return FALSE;
+}
+
 static void
 cb_seek (GtkRange *range,
 	 gpointer  data)
 {
   GstPlayerTimer *timer = GST_PLAYER_TIMER (data);
 
-  if (!timer->lock) {
+  if (!timer->lock && timer->seek) {
     guint64 seek_val = gtk_range_get_value (range);
 
-    /* try on video first */
-    gst_element_seek_simple (timer->play, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH, seek_val);
+    /* fast, keyframe-only seeks while scrubbing */
+    gst_player_seek_request (timer->seek, seek_val, FALSE);
+
+    if (timer->seeking) {
+      timer->dragged = TRUE;
+    } else {
+      /* keyboard or wheel: seek accurately once it stops */
+      if (timer->settle_id != 0)
+        g_source_remove (timer->settle_id);
+      timer->settle_id = g_timeout_add (SETTLE_INTERVAL, cb_settle, timer);
+    }
   }
 }
@@ -27,6 +27,10 @@
 #include <gdk/gdk.h>
 #include <gtk/gtkhbox.h>
 
+#include "dispatcher.h"
+#include "seek.h"
+#include "thumbnailer.h"
+
 G_BEGIN_DECLS
 
 #define GST_PLAYER_TYPE_TIMER \
@@ -44,12 +48,41 @@ typedef struct _GstPlayerTimer {
   GtkVBox parent;
 
   GstElement *play;
+  GstPlayerDispatcher *disp;
+  guint sub_id;
 
   GtkLabel *label;
   GtkRange *range;
-  gboolean lock, seeking;
+  gboolean lock, seeking, dragged;
+
+  /* coalesced seeking, finished by an accurate seek */
+  GstPlayerSeek *seek;
+  guint settle_id;
+
+  /* preview of the position under the pointer */
+  GstPlayerThumbnailer *thumbs;
+  GtkWidget *preview, *preview_image;
+  GstClockTime hover;
+  gint hover_x;
 
   guint64 len, pos;
+
+  /* duration from the metadata cache, until the pipeline knows;
+   * len_cached while len is that one */
+  GstClockTime known_len;
+  gboolean len_cached;
+
+  /* progress scheduling */
+  guint timeout_id;
+  guint wakeups;
+  GTimer *wakeup_timer;
+  gfloat wakeup_rate;
+
+  /* while playing, the position is extrapolated from the pipeline
+   * clock, starting at the last real position query */
+  GstClockTime anchor_pos, anchor_time, anchor_base;
+  guint queries;
+  gfloat query_rate;
 } GstPlayerTimer;
 
 typedef struct _GstPlayerTimerClass {
@@ -57,8 +90,15 @@ typedef struct _GstPlayerTimerClass {
 } GstPlayerTimerClass;
 
 GType		gst_player_timer_get_type	(void);
-GtkWidget *	gst_player_timer_new		(GstElement *play);
+GtkWidget *	gst_player_timer_new		(GstElement *play,
+						 GstPlayerDispatcher *disp);
 void		gst_player_timer_progress	(GstPlayerTimer *timer);
+void		gst_player_timer_start		(GstPlayerTimer *timer);
+void		gst_player_timer_stop		(GstPlayerTimer *timer);
+void		gst_player_timer_set_duration	(GstPlayerTimer *timer,
+						 GstClockTime    duration);
+gfloat		gst_player_timer_get_wakeup_rate (GstPlayerTimer *timer);
+gfloat		gst_player_timer_get_query_rate	(GstPlayerTimer *timer);
 
 G_END_DECLS
 
@@ -0,0 +1,328 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * topology.c: streams of the loaded media. Playbin's stream-info
+ * list is walked once after preroll and kept until the pipeline
+ * goes back to READY.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "topology.h"
+
+GstPlayerTopology *
+gst_player_topology_new (GstElement *play)
+{
+  GstPlayerTopology *topo = g_new0 (GstPlayerTopology, 1);
+
+  topo->play = gst_object_ref (play);
+
+  return topo;
+}
+
+void
+gst_player_topology_free (GstPlayerTopology *topo)
+{
+  gst_player_topology_invalidate (topo);
+  gst_object_unref (topo->play);
+  g_free (topo);
+}
+
+void
+gst_player_stream_free (GstPlayerStream *stream)
+{
+  if (stream->pad)
+    gst_object_unref (stream->pad);
+  g_free (stream->caps);
+  g_free (stream->codec);
+  g_free (stream->language);
+  g_free (stream);
+}
+
+/*
+ * Forget the streams. Call this whenever the pipeline goes back to
+ * READY or switches to the next item, new media will have other
+ * streams.
+ */
+
+void
+gst_player_topology_invalidate (GstPlayerTopology *topo)
+{
+  g_list_foreach (topo->streams, (GFunc) gst_player_stream_free, NULL);
+  g_list_free (topo->streams);
+  topo->streams = NULL;
+  topo->valid = FALSE;
+}
+
+/*
+ * Streams to report until the new media prerolled, e.g. from the
+ * metadata cache. The list is not copied and has to stay around
+ * until it's replaced; the streams have no pads.
+ */
+
+void
+gst_player_topology_set_cached (GstPlayerTopology *topo,
+				const GList       *streams)
+{
+  topo->cached = streams;
+}
+
+/*
+ * Copy of the streams of the prerolled media, without pads.
+ */
+
+GList *
+gst_player_topology_copy_streams (GstPlayerTopology *topo)
+{
+  const GList *item;
+  GList *copy = NULL;
+
+  if (GST_STATE (topo->play) <= GST_STATE_READY)
+    return NULL;
+
+  for (item = gst_player_topology_get_streams (topo);
+       item != NULL; item = item->next) {
+    const GstPlayerStream *stream = item->data;
+    GstPlayerStream *dup = g_memdup (stream, sizeof (GstPlayerStream));
+
+    dup->pad = NULL;
+    dup->caps = g_strdup (stream->caps);
+    dup->codec = g_strdup (stream->codec);
+    dup->language = g_strdup (stream->language);
+    copy = g_list_append (copy, dup);
+  }
+
+  return copy;
+}
+
+static GstPlayerStreamType
+stream_type (GObject *info)
+{
+  GParamSpec *pspec;
+  GEnumValue *val;
+  gint type;
+
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (info), "type");
+  if (!pspec || !G_IS_PARAM_SPEC_ENUM (pspec))
+    return GST_PLAYER_STREAM_UNKNOWN;
+
+  g_object_get (info, "type", &type, NULL);
+  val = g_enum_get_value (G_PARAM_SPEC_ENUM (pspec)->enum_class, type);
+  if (!val)
+    return GST_PLAYER_STREAM_UNKNOWN;
+
+  if (strstr (val->value_name, "AUDIO"))
+    return GST_PLAYER_STREAM_AUDIO;
+  else if (strstr (val->value_name, "VIDEO"))
+    return GST_PLAYER_STREAM_VIDEO;
+  else if (strstr (val->value_name, "TEXT") ||
+	   strstr (val->value_name, "SUBPICTURE"))
+    return GST_PLAYER_STREAM_TEXT;
+  else if (strstr (val->value_name, "UNKNOWN"))
+    return GST_PLAYER_STREAM_UNKNOWN;
+
+  return GST_PLAYER_STREAM_OTHER;
+}
+
+static gchar *
+stream_string (GObject     *info,
+	       const gchar *name)
+{
+  gchar *str = NULL;
+
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (info), name))
+    g_object_get (info, name, &str, NULL);
+
+  if (str && !*str) {
+    g_free (str);
+    str = NULL;
+  }
+
+  return str;
+}
+
+/*
+ * Fills in the caps-derived fields. Also used later on for pads
+ * that didn't have caps yet at preroll.
+ */
+
+static void
+stream_parse_caps (GstPlayerStream *stream)
+{
+  GstStructure *s;
+
+  if (stream->caps || !stream->pad || !GST_PAD_CAPS (stream->pad))
+    return;
+
+  s = gst_caps_get_structure (GST_PAD_CAPS (stream->pad), 0);
+  stream->caps = g_strdup (gst_structure_get_name (s));
+
+  switch (stream->type) {
+    case GST_PLAYER_STREAM_VIDEO:
+      gst_structure_get_int (s, "width", &stream->width);
+      gst_structure_get_int (s, "height", &stream->height);
+      gst_structure_get_fraction (s, "framerate",
+				  &stream->fps_n, &stream->fps_d);
+      break;
+    case GST_PLAYER_STREAM_AUDIO:
+      gst_structure_get_int (s, "channels", &stream->channels);
+      gst_structure_get_int (s, "rate", &stream->rate);
+      break;
+    default:
+      break;
+  }
+}
+
+/*
+ * playbin2 has no stream-info; it counts the streams per type and
+ * has action signals for their tags and (in newer versions) pads.
+ */
+
+static void
+build_playbin2 (GstPlayerTopology *topo)
+{
+  static const struct {
+    GstPlayerStreamType type;
+    const gchar *count, *tags, *pad, *codec;
+  } kinds[] = {
+    { GST_PLAYER_STREAM_VIDEO, "n-video", "get-video-tags", "get-video-pad",
+      GST_TAG_VIDEO_CODEC },
+    { GST_PLAYER_STREAM_AUDIO, "n-audio", "get-audio-tags", "get-audio-pad",
+      GST_TAG_AUDIO_CODEC },
+    { GST_PLAYER_STREAM_TEXT, "n-text", "get-text-tags", "get-text-pad",
+      NULL }
+  };
+  GType type = G_OBJECT_TYPE (topo->play);
+  gint k, n, num;
+
+  for (k = 0; k < G_N_ELEMENTS (kinds); k++) {
+    num = 0;
+    g_object_get (G_OBJECT (topo->play), kinds[k].count, &num, NULL);
+
+    for (n = 0; n < num; n++) {
+      GstPlayerStream *stream = g_new0 (GstPlayerStream, 1);
+      GstTagList *tags = NULL;
+      GstPad *pad = NULL;
+
+      stream->type = kinds[k].type;
+      if (g_signal_lookup (kinds[k].pad, type)) {
+        g_signal_emit_by_name (topo->play, kinds[k].pad, n, &pad);
+        stream->pad = pad;
+      }
+      g_signal_emit_by_name (topo->play, kinds[k].tags, n, &tags);
+      if (tags) {
+        if (kinds[k].codec)
+          gst_tag_list_get_string (tags, kinds[k].codec, &stream->codec);
+        gst_tag_list_get_string (tags, GST_TAG_LANGUAGE_CODE,
+				 &stream->language);
+        gst_tag_list_free (tags);
+      }
+      stream_parse_caps (stream);
+
+      topo->streams = g_list_append (topo->streams, stream);
+    }
+  }
+
+  topo->valid = TRUE;
+}
+
+static void
+build (GstPlayerTopology *topo)
+{
+  const GList *streaminfo = NULL;
+
+  if (!g_object_class_find_property (G_OBJECT_GET_CLASS (topo->play),
+				     "stream-info")) {
+    build_playbin2 (topo);
+    return;
+  }
+
+  g_object_get (G_OBJECT (topo->play), "stream-info",
+		&streaminfo, NULL);
+  for ( ; streaminfo != NULL; streaminfo = streaminfo->next) {
+    GObject *info = streaminfo->data;
+    GstPlayerStream *stream = g_new0 (GstPlayerStream, 1);
+    GstObject *object = NULL;
+
+    stream->type = stream_type (info);
+    g_object_get (info, "object", &object, NULL);
+    if (object && GST_IS_PAD (object))
+      stream->pad = GST_PAD (object);
+    else if (object)
+      gst_object_unref (object);
+    stream->codec = stream_string (info, "codec");
+    stream->language = stream_string (info, "language-code");
+    stream_parse_caps (stream);
+
+    topo->streams = g_list_append (topo->streams, stream);
+  }
+
+  topo->valid = TRUE;
+}
+
+/*
+ * Streams of the current media. Until the pipeline prerolled, these
+ * are the cached ones, if any. The list is built on first use after
+ * preroll.
+ */
+
+const GList *
+gst_player_topology_get_streams (GstPlayerTopology *topo)
+{
+  GList *item;
+
+  if (GST_STATE (topo->play) <= GST_STATE_READY) {
+    if (topo->valid)
+      gst_player_topology_invalidate (topo);
+    return topo->cached;
+  }
+
+  if (!topo->valid)
+    build (topo);
+
+  /* pads may have received caps since */
+  for (item = topo->streams; item != NULL; item = item->next)
+    stream_parse_caps (item->data);
+
+  return topo->streams;
+}
+
+/*
+ * First stream of the given type, or NULL.
+ */
+
+const GstPlayerStream *
+gst_player_topology_get_stream (GstPlayerTopology   *topo,
+				GstPlayerStreamType  type)
+{
+  const GList *item;
+
+  for (item = gst_player_topology_get_streams (topo);
+       item != NULL; item = item->next) {
+    const GstPlayerStream *stream = item->data;
+
+    if (stream->type == type)
+      return stream;
+  }
+
+  return NULL;
+}
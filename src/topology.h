@@ -0,0 +1,82 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * topology.h: streams of the loaded media
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __TOPOLOGY_H__
+#define __TOPOLOGY_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_PLAYER_STREAM_UNKNOWN = 0,
+  GST_PLAYER_STREAM_AUDIO,
+  GST_PLAYER_STREAM_VIDEO,
+  GST_PLAYER_STREAM_TEXT,
+  GST_PLAYER_STREAM_OTHER
+} GstPlayerStreamType;
+
+typedef struct _GstPlayerStream {
+  GstPlayerStreamType type;
+
+  /* decoded pad, may not have caps yet */
+  GstPad *pad;
+
+  /* media type of the caps, codec and language (or NULL) */
+  gchar *caps, *codec, *language;
+
+  /* video */
+  gint width, height, fps_n, fps_d;
+
+  /* audio */
+  gint channels, rate;
+} GstPlayerStream;
+
+typedef struct _GstPlayerTopology {
+  GstElement *play;
+
+  /* list of GstPlayerStream, valid while prerolled */
+  GList *streams;
+  gboolean valid;
+
+  /* streams known from an earlier run, until the pipeline prerolls */
+  const GList *cached;
+} GstPlayerTopology;
+
+GstPlayerTopology *
+		gst_player_topology_new		(GstElement *play);
+void		gst_player_topology_free	(GstPlayerTopology *topo);
+
+void		gst_player_topology_invalidate	(GstPlayerTopology *topo);
+void		gst_player_topology_set_cached	(GstPlayerTopology *topo,
+						 const GList       *streams);
+GList *		gst_player_topology_copy_streams (GstPlayerTopology *topo);
+const GList *	gst_player_topology_get_streams	(GstPlayerTopology *topo);
+const GstPlayerStream *
+		gst_player_topology_get_stream	(GstPlayerTopology *topo,
+						 GstPlayerStreamType type);
+
+void		gst_player_stream_free		(GstPlayerStream *stream);
+
+G_END_DECLS
+
+#endif /* __TOPOLOGY_H__ */
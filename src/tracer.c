@@ -0,0 +1,423 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * tracer.c: per-element processing latency. Buffer probes on every
+ * pad of every element that playbin creates measure how long each
+ * element holds on to a buffer.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipeline.h"
+#include "tracer.h"
+
+/* number of samples the rolling figures are computed over */
+#define WINDOW 512
+
+/* buffers that never came out of a queue (leaky queues drop them) are
+ * forgotten once a lane holds this many and they are this old */
+#define MAX_PENDING	1024
+#define MAX_RESIDENCY	(10 * GST_SECOND)
+
+/*
+ * For normal elements, the time between a buffer arriving on a sink
+ * pad and the next buffer leaving on a source pad is processing time.
+ * Queues decouple threads, so there we look up when each outgoing
+ * buffer came in and report how long it sat in the queue. A multiqueue
+ * has one such lane per sink/source pad pair.
+ */
+
+typedef struct _GstPlayerTracerProbe {
+  GstPad *pad;
+  gulong buffer_id, event_id;
+} GstPlayerTracerProbe;
+
+typedef struct _GstPlayerTracerElement {
+  GstPlayerTracer *tracer;
+  GstElement *element;
+
+  gchar *name;
+  gboolean is_queue;
+
+  /* no longer in the pipeline */
+  gboolean gone;
+
+  /* what's connected to the element and its pads, so that it can be
+   * undone if the tracer goes first */
+  gulong pad_added_id, parent_unset_id;
+  GSList *probes;
+
+  /* arrival time of pending input; for queues, lane number -> buffer
+   * -> arrival time */
+  GstClockTime last_in;
+  GHashTable *lanes;
+
+  /* rolling window of samples */
+  GstClockTime samples[WINDOW];
+  guint n_samples, next;
+  guint64 total;
+} GstPlayerTracerElement;
+
+static void
+add_sample (GstPlayerTracerElement *te,
+	    GstClockTime            sample)
+{
+  te->samples[te->next] = sample;
+  te->next = (te->next + 1) % WINDOW;
+  if (te->n_samples < WINDOW)
+    te->n_samples++;
+  te->total++;
+}
+
+/*
+ * Pads of a multiqueue are numbered, "sink0" goes with "src0".
+ */
+
+static GHashTable *
+lane_get (GstPlayerTracerElement *te,
+	  GstPad                 *pad,
+	  gboolean                create)
+{
+  const gchar *name = GST_PAD_NAME (pad);
+  GHashTable *lane;
+  gint num;
+
+  while (*name && !g_ascii_isdigit (*name))
+    name++;
+  num = atoi (name);
+
+  lane = g_hash_table_lookup (te->lanes, GINT_TO_POINTER (num));
+  if (!lane && create) {
+    lane = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+				  NULL, g_free);
+    g_hash_table_insert (te->lanes, GINT_TO_POINTER (num), lane);
+  }
+
+  return lane;
+}
+
+static gboolean
+cb_expired (gpointer key,
+	    gpointer value,
+	    gpointer data)
+{
+  return *(GstClockTime *) data - *(GstClockTime *) value > MAX_RESIDENCY;
+}
+
+static gboolean
+cb_buffer (GstPad    *pad,
+	   GstBuffer *buffer,
+	   gpointer   data)
+{
+  GstPlayerTracerElement *te = data;
+  GstClockTime now = gst_util_get_timestamp ();
+  GHashTable *lane;
+
+  g_mutex_lock (te->tracer->lock);
+  if (te->is_queue) {
+    if (GST_PAD_DIRECTION (pad) == GST_PAD_SINK) {
+      lane = lane_get (te, pad, TRUE);
+      if (g_hash_table_size (lane) >= MAX_PENDING)
+        g_hash_table_foreach_remove (lane, cb_expired, &now);
+      g_hash_table_insert (lane, buffer, g_memdup (&now, sizeof (now)));
+    } else if ((lane = lane_get (te, pad, FALSE))) {
+      GstClockTime *in = g_hash_table_lookup (lane, buffer);
+
+      if (in) {
+        add_sample (te, now - *in);
+        g_hash_table_remove (lane, buffer);
+      }
+    }
+  } else if (GST_PAD_DIRECTION (pad) == GST_PAD_SINK) {
+    te->last_in = now;
+  } else if (GST_CLOCK_TIME_IS_VALID (te->last_in)) {
+    add_sample (te, now - te->last_in);
+
+    /* further output for the same input counts from here */
+    te->last_in = now;
+  }
+  g_mutex_unlock (te->tracer->lock);
+
+  return TRUE;
+}
+
+/*
+ * A flush empties the queue without anything coming out.
+ */
+
+static gboolean
+cb_event (GstPad   *pad,
+	  GstEvent *event,
+	  gpointer  data)
+{
+  GstPlayerTracerElement *te = data;
+  GHashTable *lane;
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    g_mutex_lock (te->tracer->lock);
+    if ((lane = lane_get (te, pad, FALSE)))
+      g_hash_table_remove_all (lane);
+    g_mutex_unlock (te->tracer->lock);
+  }
+
+  return TRUE;
+}
+
+/*
+ * Called with the tracer lock, or before the element is known to
+ * anyone else.
+ */
+
+static void
+probe_pad (GstPlayerTracerElement *te,
+	   GstPad                 *pad)
+{
+  GstPlayerTracerProbe *probe = g_new0 (GstPlayerTracerProbe, 1);
+
+  probe->pad = GST_PAD (gst_object_ref (GST_OBJECT (pad)));
+  probe->buffer_id = gst_pad_add_buffer_probe (pad,
+      G_CALLBACK (cb_buffer), te);
+  if (te->is_queue && GST_PAD_DIRECTION (pad) == GST_PAD_SINK)
+    probe->event_id = gst_pad_add_event_probe (pad,
+        G_CALLBACK (cb_event), te);
+  te->probes = g_slist_prepend (te->probes, probe);
+}
+
+static void
+cb_pad_added (GstElement *element,
+	      GstPad     *pad,
+	      gpointer    data)
+{
+  GstPlayerTracerElement *te = data;
+
+  g_mutex_lock (te->tracer->lock);
+  probe_pad (te, pad);
+  g_mutex_unlock (te->tracer->lock);
+}
+
+static void
+element_free (GstPlayerTracerElement *te)
+{
+  GSList *item;
+
+  /* pads may outlive their element */
+  for (item = te->probes; item != NULL; item = item->next) {
+    GstPlayerTracerProbe *probe = item->data;
+
+    gst_pad_remove_buffer_probe (probe->pad, probe->buffer_id);
+    if (probe->event_id)
+      gst_pad_remove_event_probe (probe->pad, probe->event_id);
+    gst_object_unref (GST_OBJECT (probe->pad));
+    g_free (probe);
+  }
+  g_slist_free (te->probes);
+  g_hash_table_destroy (te->lanes);
+  g_free (te->name);
+  g_free (te);
+}
+
+/*
+ * Elements that left the pipeline (e.g. when playbin rebuilt itself
+ * for new media) aren't shown anymore. The probes may still run until
+ * the element is disposed, so it's only forgotten then.
+ */
+
+static void
+cb_parent_unset (GstObject *object,
+		 GstObject *parent,
+		 gpointer   data)
+{
+  GstPlayerTracerElement *te = data;
+
+  g_mutex_lock (te->tracer->lock);
+  te->gone = TRUE;
+  g_mutex_unlock (te->tracer->lock);
+}
+
+static void
+cb_element_gone (gpointer data,
+		 GObject *where_the_object_was)
+{
+  GstPlayerTracerElement *te = data;
+
+  g_mutex_lock (te->tracer->lock);
+  te->tracer->elements = g_list_remove (te->tracer->elements, te);
+  g_mutex_unlock (te->tracer->lock);
+
+  element_free (te);
+}
+
+static void
+cb_element (GstElement *element,
+	    gpointer    data)
+{
+  GstPlayerTracer *tracer = data;
+  GstPlayerTracerElement *te;
+  GstElementFactory *factory;
+  GList *pads;
+
+  /* bins are only containers, sources have no input and sinks have
+   * no output; none of those can be measured this way */
+  if (GST_IS_BIN (element) ||
+      GST_OBJECT_FLAG_IS_SET (element, GST_ELEMENT_IS_SINK) ||
+      element->numsinkpads == 0)
+    return;
+
+  te = g_new0 (GstPlayerTracerElement, 1);
+  te->tracer = tracer;
+  te->element = element;
+  te->name = gst_element_get_name (element);
+  factory = gst_element_get_factory (element);
+  te->is_queue = factory &&
+      (!strcmp (GST_PLUGIN_FEATURE_NAME (factory), "queue") ||
+       !strcmp (GST_PLUGIN_FEATURE_NAME (factory), "queue2") ||
+       !strcmp (GST_PLUGIN_FEATURE_NAME (factory), "multiqueue"));
+  te->last_in = GST_CLOCK_TIME_NONE;
+  te->lanes = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) g_hash_table_destroy);
+
+  GST_OBJECT_LOCK (element);
+  for (pads = element->pads; pads != NULL; pads = pads->next)
+    probe_pad (te, GST_PAD (pads->data));
+  GST_OBJECT_UNLOCK (element);
+  te->pad_added_id = g_signal_connect (element, "pad-added",
+      G_CALLBACK (cb_pad_added), te);
+  te->parent_unset_id = g_signal_connect (element, "parent-unset",
+      G_CALLBACK (cb_parent_unset), te);
+  g_object_weak_ref (G_OBJECT (element), cb_element_gone, te);
+
+  g_mutex_lock (tracer->lock);
+  tracer->elements = g_list_append (tracer->elements, te);
+  g_mutex_unlock (tracer->lock);
+}
+
+GstPlayerTracer *
+gst_player_tracer_new (GstElement *play)
+{
+  GstPlayerTracer *tracer = g_new0 (GstPlayerTracer, 1);
+
+  tracer->lock = g_mutex_new ();
+  tracer->play = GST_ELEMENT (gst_object_ref (GST_OBJECT (play)));
+  tracer->watch = gst_player_pipeline_watch_elements (play,
+      cb_element, tracer);
+
+  return tracer;
+}
+
+/*
+ * Takes everything out of the pipeline again. The pipeline may live
+ * on, but must be stopped.
+ */
+
+void
+gst_player_tracer_free (GstPlayerTracer *tracer)
+{
+  GList *item;
+
+  gst_player_pipeline_unwatch_elements (tracer->play, tracer->watch);
+
+  for (item = tracer->elements; item != NULL; item = item->next) {
+    GstPlayerTracerElement *te = item->data;
+
+    g_signal_handler_disconnect (te->element, te->pad_added_id);
+    g_signal_handler_disconnect (te->element, te->parent_unset_id);
+    g_object_weak_unref (G_OBJECT (te->element), cb_element_gone, te);
+    element_free (te);
+  }
+  g_list_free (tracer->elements);
+  gst_object_unref (GST_OBJECT (tracer->play));
+  g_mutex_free (tracer->lock);
+  g_free (tracer);
+}
+
+/*
+ * Forget the figures so far, e.g. when new media is loaded.
+ */
+
+void
+gst_player_tracer_reset (GstPlayerTracer *tracer)
+{
+  GList *item;
+
+  g_mutex_lock (tracer->lock);
+  for (item = tracer->elements; item != NULL; item = item->next) {
+    GstPlayerTracerElement *te = item->data;
+
+    te->n_samples = te->next = 0;
+    te->total = 0;
+    te->last_in = GST_CLOCK_TIME_NONE;
+    g_hash_table_remove_all (te->lanes);
+  }
+  g_mutex_unlock (tracer->lock);
+}
+
+static gint
+compare_time (gconstpointer a,
+	      gconstpointer b)
+{
+  GstClockTime ta = *(const GstClockTime *) a,
+      tb = *(const GstClockTime *) b;
+
+  return (ta > tb) - (ta < tb);
+}
+
+/*
+ * Text snapshot, one line per element with min/avg/p99 over the last
+ * samples. Times are in microseconds.
+ */
+
+gchar *
+gst_player_tracer_dump (GstPlayerTracer *tracer)
+{
+  GString *str = g_string_new (NULL);
+  GstClockTime sorted[WINDOW];
+  GList *item;
+
+  g_string_append_printf (str, "%-24s %-9s %10s %10s %10s %10s\n",
+      "element", "kind", "buffers", "min", "avg", "p99");
+
+  g_mutex_lock (tracer->lock);
+  for (item = tracer->elements; item != NULL; item = item->next) {
+    GstPlayerTracerElement *te = item->data;
+    guint64 sum = 0;
+    guint n;
+
+    if (te->gone || te->n_samples == 0)
+      continue;
+
+    memcpy (sorted, te->samples, te->n_samples * sizeof (GstClockTime));
+    qsort (sorted, te->n_samples, sizeof (GstClockTime), compare_time);
+    for (n = 0; n < te->n_samples; n++)
+      sum += sorted[n];
+
+    g_string_append_printf (str,
+        "%-24s %-9s %10" G_GUINT64_FORMAT " %10.01lf %10.01lf %10.01lf\n",
+        te->name, te->is_queue ? "residency" : "process", te->total,
+        (gdouble) sorted[0] / GST_USECOND,
+        (gdouble) sum / te->n_samples / GST_USECOND,
+        (gdouble) sorted[(te->n_samples * 99 + 99) / 100 - 1] / GST_USECOND);
+  }
+  g_mutex_unlock (tracer->lock);
+
+  return g_string_free (str, FALSE);
+}
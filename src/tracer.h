@@ -0,0 +1,51 @@
+/* GStreamer Media Player
+ * (c) 2004 Ronald Bultje <rbultje@ronald.bitfreak.net>
+ *
+ * tracer.h: per-element processing latency.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __TRACER_H__
+#define __TRACER_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "pipeline.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GstPlayerTracer {
+  /* kept until the tracer is freed, with the watch on its elements */
+  GstElement *play;
+  GstPlayerElementWatch *watch;
+
+  GMutex *lock;
+
+  /* GstPlayerTracerElement, in order of appearance */
+  GList *elements;
+} GstPlayerTracer;
+
+GstPlayerTracer *
+		gst_player_tracer_new		(GstElement *play);
+void		gst_player_tracer_free		(GstPlayerTracer *tracer);
+void		gst_player_tracer_reset		(GstPlayerTracer *tracer);
+gchar *		gst_player_tracer_dump		(GstPlayerTracer *tracer);
+
+G_END_DECLS
+
+#endif /* __TRACER_H__ */
@@ -82,17 +82,6 @@ gst_player_video_get_type (void)
   return gst_player_video_type;
 }
 
-static gboolean
-gst_player_video_configure_event (GtkWidget        * widget,
-                                  GdkEventConfigure* event)
-{
-  GdkRectangle rect = {0,0, widget->allocation.width, widget->allocation.height};
-  gdk_window_invalidate_rect (GST_PLAYER_VIDEO (widget)->full_window,
-                              &rect, TRUE);
-
-  return FALSE;
-}
-
 static void
 gst_player_video_class_init (GstPlayerVideoClass *klass)
 {
@@ -123,33 +112,43 @@ static void
 gst_player_video_init (GstPlayerVideo *video)
 {
   GstPlayerVideoClass *klass = GST_PLAYER_VIDEO_GET_CLASS (video);
-  GdkPixbuf* logo = klass->logo;
+  GdkPixbuf* logo;
 
-  if (!logo)
+  if (klass->logo)
+    {
+      logo = g_object_ref (klass->logo);
+    }
+  else
     {
       logo = gtk_widget_render_icon (GTK_WIDGET (video),
                                      GTK_STOCK_MISSING_IMAGE,
                                      GTK_ICON_SIZE_DIALOG,
                                      NULL);
     }
+  video->logo_levels = g_ptr_array_new ();
+  g_ptr_array_add (video->logo_levels, logo);
+  video->logo_pixmap = NULL;
+  video->logo_width = video->logo_height = 0;
+  video->rect.x = video->rect.y = 0;
+  video->rect.width = video->rect.height = 0;
+  video->rect_changed = TRUE;
+  video->exposes = video->fills = video->overlay_exposes = 0;
 
   video->element = NULL;
+  video->sink = NULL;
+  video->disp = NULL;
   video->id = 0;
+  video->milestones = NULL;
+  video->topo = NULL;
   video->width = gdk_pixbuf_get_width (logo);
   video->height = gdk_pixbuf_get_height (logo);
 
   video->id2 = g_signal_connect (video, "size-request",
       G_CALLBACK (cb_preferred_video_size), NULL);
-
-  if (logo != klass->logo)
-    {
-      g_object_unref (logo);
-    }
 }
 
 static void
-cb_message (GstBus    *bus,
-            GstMessage*message,
+cb_message (GstMessage*message,
             gpointer   user_data)
 {
   switch (message->type) {
@@ -174,8 +173,9 @@ cb_message (GstBus    *bus,
 }
 
 GtkWidget *
-gst_player_video_new (GstElement *element,
-		      GstElement *play)
+gst_player_video_new (GstElement          *element,
+		      GstElement          *play,
+		      GstPlayerDispatcher *disp)
 {
   GstPlayerVideo *video =
       g_object_new (GST_PLAYER_TYPE_VIDEO, NULL);
@@ -185,14 +185,16 @@ gst_player_video_new (GstElement *element,
       video->element = gst_bin_get_by_interface (GST_BIN (element),
 						 GST_TYPE_X_OVERLAY);
     } else {
-      video->element = element;
+      video->element = gst_object_ref (GST_OBJECT (element));
     }
+    video->sink = element;
     video->play = play;
 
-    gst_object_ref (GST_OBJECT (video->element));
+    gst_object_ref (GST_OBJECT (video->sink));
     gst_object_ref (GST_OBJECT (video->play));
-    video->id = g_signal_connect (gst_pipeline_get_bus (GST_PIPELINE (play)), "message",
-        G_CALLBACK (cb_message), video);
+    video->disp = disp;
+    video->id = gst_player_dispatcher_subscribe (disp,
+        GST_MESSAGE_STATE_CHANGED, GST_OBJECT (play), cb_message, video);
   }
   
   return GTK_WIDGET (video);
@@ -204,7 +206,7 @@ gst_player_video_dispose (GObject *object)
   GstPlayerVideo *video = GST_PLAYER_VIDEO (object);
 
   if (video->id != 0) {
-    g_signal_handler_disconnect (gst_pipeline_get_bus (GST_PIPELINE (video->play)), video->id);
+    gst_player_dispatcher_unsubscribe (video->disp, video->id);
     video->id = 0;
   }
 
@@ -214,21 +216,57 @@ gst_player_video_dispose (GObject *object)
     video->element = NULL;
   }
 
+  if (video->sink) {
+    gst_object_unref (GST_OBJECT (video->sink));
+    video->sink = NULL;
+  }
+
   if (video->play) {
     gst_object_unref (GST_OBJECT (video->play));
     video->play = NULL;
   }
 
+  if (video->logo_levels) {
+    g_ptr_array_foreach (video->logo_levels, (GFunc) g_object_unref, NULL);
+    g_ptr_array_free (video->logo_levels, TRUE);
+    video->logo_levels = NULL;
+  }
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
+/*
+ * Where the letterboxed video goes inside the widget.
+ */
+
+static void
+video_rect (GstPlayerVideo *video,
+            GdkRectangle   *rect)
+{
+  GtkWidget *widget = GTK_WIDGET (video);
+  gfloat ratio, width = video->width, height = video->height;
+
+  if ((gfloat) widget->allocation.width / video->width >
+      (gfloat) widget->allocation.height / video->height) {
+    ratio = (gfloat) widget->allocation.height / video->height;
+  } else {
+    ratio = (gfloat) widget->allocation.width / video->width;
+  }
+  width *= ratio;
+  height *= ratio;
+
+  rect->x = (widget->allocation.width - width) / 2;
+  rect->y = (widget->allocation.height - height) / 2;
+  rect->width = width;
+  rect->height = height;
+}
+
 static void
 gst_player_video_realize (GtkWidget *widget)
 {
   GstPlayerVideo *video = GST_PLAYER_VIDEO (widget);
   GdkWindowAttr attributes;
   gint attributes_mask;
-  gfloat ratio;
 
   g_return_if_fail (widget != NULL);
   g_return_if_fail (GST_PLAYER_IS_VIDEO (widget));
@@ -259,18 +297,12 @@ gst_player_video_realize (GtkWidget *widget)
   gdk_window_set_user_data (video->full_window, widget);
 
   /* specific for video only */
-  attributes.x = 0;
-  attributes.y = 0;
-  attributes.width = video->width;
-  attributes.height = video->height;
-  if ((gfloat) video->width / widget->allocation.width >
-      (gfloat) video->height / widget->allocation.height) {
-    ratio = (gfloat) video->height / widget->allocation.height;
-  } else {
-    ratio = (gfloat) video->width / widget->allocation.width;
-  }
-  attributes.width *= ratio;
-  attributes.height *= ratio;
+  video_rect (video, &video->rect);
+  video->rect_changed = TRUE;
+  attributes.x = video->rect.x;
+  attributes.y = video->rect.y;
+  attributes.width = MAX (video->rect.width, 1);
+  attributes.height = MAX (video->rect.height, 1);
   attributes.wclass = GDK_INPUT_OUTPUT;
   attributes.window_type = GDK_WINDOW_CHILD;
   attributes.event_mask = gtk_widget_get_events (widget) | 
@@ -295,21 +327,26 @@ gst_player_video_realize (GtkWidget *widget)
   gdk_window_set_user_data (widget->window, widget);
 
   gtk_style_set_background (widget->style, widget->window, GTK_STATE_ACTIVE);
+  /* we paint all of it, don't let the server clear it first */
+  gdk_window_set_back_pixmap (video->video_window, NULL, FALSE);
 
   gst_x_overlay_set_xwindow_id (GST_X_OVERLAY (video->element), GDK_WINDOW_XWINDOW (video->video_window));
-
-  g_signal_connect_swapped (gtk_widget_get_toplevel (widget), "configure-event",
-                            G_CALLBACK (gst_player_video_configure_event), widget);
+  if (video->sink)
+    gst_player_video_sink_set_size (video->sink,
+                                    video->rect.width, video->rect.height);
 }
 
 static void
 gst_player_video_unrealize (GtkWidget* widget)
 {
-  g_signal_handlers_disconnect_by_func (gtk_widget_get_toplevel (widget),
-                                        gst_player_video_configure_event,
-                                        widget);
+  GstPlayerVideo *video = GST_PLAYER_VIDEO (widget);
+
+  gst_x_overlay_set_xwindow_id (GST_X_OVERLAY (video->element), 0);
 
-  gst_x_overlay_set_xwindow_id (GST_X_OVERLAY (GST_PLAYER_VIDEO (widget)->element), 0);
+  if (video->logo_pixmap) {
+    g_object_unref (video->logo_pixmap);
+    video->logo_pixmap = NULL;
+  }
 
   GTK_WIDGET_CLASS (parent_class)->unrealize (widget);
 }
@@ -369,24 +406,111 @@ gst_player_video_size_allocate (GtkWidget     *widget,
 
   if (GTK_WIDGET_REALIZED (widget)) {
     GstPlayerVideo *video = GST_PLAYER_VIDEO (widget);
-    gfloat ratio, width = video->width, height = video->height;
+    GdkRectangle rect;
 
     gdk_window_move_resize (video->full_window,
                             allocation->x, allocation->y,
                             allocation->width, allocation->height);
-    if ((gfloat) widget->allocation.width / video->width >
-        (gfloat) widget->allocation.height / video->height) {
-      ratio = (gfloat) widget->allocation.height / video->height;
-    } else {
-      ratio = (gfloat) widget->allocation.width / video->width;
-    }
-    width *= ratio;
-    height *= ratio;
+    video_rect (video, &rect);
+    if (rect.x == video->rect.x && rect.y == video->rect.y &&
+        rect.width == video->rect.width && rect.height == video->rect.height)
+      return;
+
     gdk_window_move_resize (video->video_window,
-                            (allocation->width - width) / 2,
-			    (allocation->height - height) / 2,
-                            width, height);
+                            rect.x, rect.y, rect.width, rect.height);
+    if (video->sink)
+      gst_player_video_sink_set_size (video->sink, rect.width, rect.height);
+
+    /* what the video covered before and is now bars; newly uncovered
+     * parts of a grown window are exposed by X already */
+    if (video->rect.width > 0 && video->rect.height > 0) {
+      GdkRegion *damage = gdk_region_rectangle (&video->rect);
+      GdkRegion *covered = gdk_region_rectangle (&rect);
+
+      gdk_region_subtract (damage, covered);
+      gdk_window_invalidate_region (video->full_window, damage, FALSE);
+      gdk_region_destroy (covered);
+      gdk_region_destroy (damage);
+    }
+
+    video->rect = rect;
+    video->rect_changed = TRUE;
+  }
+}
+
+/*
+ * Pre-downscaled logo that is at least the given size, halving the
+ * smallest one we have as far as needed. Scaling from there is cheap.
+ */
+
+static GdkPixbuf *
+logo_level (GstPlayerVideo *video,
+            gint            width,
+            gint            height)
+{
+  GPtrArray *levels = video->logo_levels;
+  GdkPixbuf *last;
+  gint n;
+
+  last = g_ptr_array_index (levels, levels->len - 1);
+  while (gdk_pixbuf_get_width (last) / 2 >= width &&
+         gdk_pixbuf_get_height (last) / 2 >= height) {
+    last = gdk_pixbuf_scale_simple (last,
+        gdk_pixbuf_get_width (last) / 2, gdk_pixbuf_get_height (last) / 2,
+        GDK_INTERP_BILINEAR);
+    g_ptr_array_add (levels, last);
+  }
+
+  for (n = levels->len - 1; n > 0; n--) {
+    GdkPixbuf *level = g_ptr_array_index (levels, n);
+
+    if (gdk_pixbuf_get_width (level) >= width &&
+        gdk_pixbuf_get_height (level) >= height)
+      return level;
   }
+
+  return g_ptr_array_index (levels, 0);
+}
+
+/*
+ * The logo at the given size on a black background, on the server.
+ * Only rendered again when the size changes.
+ */
+
+static GdkPixmap *
+logo_pixmap (GstPlayerVideo *video,
+             gint            width,
+             gint            height)
+{
+  GtkWidget *widget = GTK_WIDGET (video);
+  GdkPixbuf *level, *logo;
+
+  if (video->logo_pixmap &&
+      video->logo_width == width && video->logo_height == height)
+    return video->logo_pixmap;
+
+  if (video->logo_pixmap)
+    g_object_unref (video->logo_pixmap);
+
+  level = logo_level (video, width, height);
+  if (gdk_pixbuf_get_width (level) == width &&
+      gdk_pixbuf_get_height (level) == height)
+    logo = g_object_ref (level);
+  else
+    logo = gdk_pixbuf_scale_simple (level, width, height,
+                                    GDK_INTERP_BILINEAR);
+
+  video->logo_pixmap = gdk_pixmap_new (video->video_window,
+                                       width, height, -1);
+  video->logo_width = width;
+  video->logo_height = height;
+  gdk_draw_rectangle (video->logo_pixmap, widget->style->black_gc,
+      TRUE, 0, 0, width, height);
+  gdk_draw_pixbuf (video->logo_pixmap, widget->style->fg_gc[0], logo,
+      0, 0, 0, 0, width, height, GDK_RGB_DITHER_NONE, 0, 0);
+  g_object_unref (logo);
+
+  return video->logo_pixmap;
 }
 
 static gboolean
@@ -403,11 +527,29 @@ gst_player_video_expose (GtkWidget      *widget,
   g_return_val_if_fail (event != NULL, FALSE);
 
   video = GST_PLAYER_VIDEO (widget);
+  video->exposes++;
 
   if (event->window == video->full_window)
     {
-      gdk_draw_rectangle (video->full_window, widget->style->black_gc,
-          TRUE, 0, 0, widget->allocation.width, widget->allocation.height);
+      GdkRectangle full = { 0, 0,
+          widget->allocation.width, widget->allocation.height };
+      GdkRegion *bars = gdk_region_rectangle (&full);
+      GdkRegion *covered = gdk_region_rectangle (&video->rect);
+      GdkRectangle *rects;
+      gint n, n_rects;
+
+      /* only the damaged parts of the letterbox bars */
+      gdk_region_subtract (bars, covered);
+      gdk_region_intersect (bars, event->region);
+      gdk_region_get_rectangles (bars, &rects, &n_rects);
+      for (n = 0; n < n_rects; n++) {
+        gdk_draw_rectangle (video->full_window, widget->style->black_gc,
+            TRUE, rects[n].x, rects[n].y, rects[n].width, rects[n].height);
+      }
+      video->fills += n_rects;
+      g_free (rects);
+      gdk_region_destroy (covered);
+      gdk_region_destroy (bars);
 
       return FALSE;
     }
@@ -418,51 +560,40 @@ gst_player_video_expose (GtkWidget      *widget,
     if (!GST_IS_X_OVERLAY (video->element))
       return TRUE;
 
-    gst_x_overlay_expose (GST_X_OVERLAY (video->element));
-  } else {
-    GstPlayerVideoClass *klass = GST_PLAYER_VIDEO_GET_CLASS (video);
-    GdkPixbuf *main_logo;
-    GdkPixbuf *logo;
-    gfloat width = video->width, height = video->height;
-    gfloat ratio;
-
-    if ((gfloat) widget->allocation.width / video->width >
-        (gfloat) widget->allocation.height / video->height) {
-      ratio = (gfloat) widget->allocation.height / video->height;
-    } else {
-      ratio = (gfloat) widget->allocation.width / video->width;
-    }
-    width *= ratio;
-    height *= ratio;
-
-    gdk_draw_rectangle (video->video_window, widget->style->black_gc,
-        TRUE, 0, 0, widget->allocation.width, widget->allocation.height);
-
-    main_logo = klass->logo ? g_object_ref (klass->logo) : NULL;
-
-    if (!main_logo)
-      main_logo = gtk_widget_render_icon (widget,
-                                          GTK_STOCK_MISSING_IMAGE,
-                                          GTK_ICON_SIZE_DIALOG,
-                                          NULL);
+    /* while playing, the next frame repaints anyway */
+    if (GST_STATE (video->element) == GST_STATE_PLAYING &&
+        !video->rect_changed)
+      return FALSE;
 
-    /* FIXME: it's totally uncool to do this on every expose... */
-    logo = gdk_pixbuf_scale_simple (main_logo,
-        width, height, GDK_INTERP_BILINEAR);
+    gst_x_overlay_expose (GST_X_OVERLAY (video->element));
+    video->overlay_exposes++;
+    video->rect_changed = FALSE;
+    if (video->milestones)
+      gst_player_milestones_mark (video->milestones,
+                                  GST_PLAYER_MILESTONE_EXPOSE);
+  } else if (video->rect.width > 0 && video->rect.height > 0) {
+    gdk_draw_drawable (video->video_window, widget->style->fg_gc[0],
+        logo_pixmap (video, video->rect.width, video->rect.height),
+        0, 0, 0, 0, video->rect.width, video->rect.height);
+  }
 
-    gdk_draw_pixbuf (GDK_DRAWABLE (video->video_window),
-        widget->style->fg_gc[0], logo, 0, 0, 0, 0,
-        width, height, GDK_RGB_DITHER_NONE, 0, 0);
+  return FALSE;
+}
 
-    gdk_pixbuf_unref (logo);
-    g_object_unref (main_logo);
-  }
+/*
+ * Expose and fill counts, to check that moving or resizing the
+ * window doesn't cause redraw storms.
+ */
 
-  gdk_window_invalidate_rect (video->full_window,
-                              &widget->allocation,
-                              FALSE);
+gchar *
+gst_player_video_dump (GstPlayerVideo *video)
+{
+  g_return_val_if_fail (GST_PLAYER_IS_VIDEO (video), NULL);
 
-  return FALSE;
+  return g_strdup_printf (_("%u exposes, %u bar fills, "
+			    "%u overlay exposes\n"),
+			  video->exposes, video->fills,
+			  video->overlay_exposes);
 }
 
 /*
@@ -538,48 +669,28 @@ cb_state_change (GstElement*element,
    * handler. Resize window after that. */
   if ((old_state >= GST_STATE_PAUSED &&
        new_state <= GST_STATE_READY)) {
-    GstPlayerVideoClass *klass = GST_PLAYER_VIDEO_GET_CLASS (video);
-    GdkPixbuf* logo;
-
-    if (klass->logo)
-      logo = g_object_ref (klass->logo);
-    else
-      logo = gtk_widget_render_icon (GTK_WIDGET (video),
-                                     GTK_STOCK_MISSING_IMAGE,
-                                     GTK_ICON_SIZE_DIALOG,
-                                     NULL);
+    GdkPixbuf *logo = g_ptr_array_index (video->logo_levels, 0);
 
     video->width = gdk_pixbuf_get_width (logo);
     video->height = gdk_pixbuf_get_height (logo);
 
     g_object_ref (G_OBJECT (video));
     idle_desired_size (video);
-
-    g_object_unref (logo);
   } else if ((new_state >= GST_STATE_PAUSED &&
 	      old_state <= GST_STATE_READY)) {
-    const GList *sinfo = NULL;
-
-    g_object_get (G_OBJECT (element), "stream-info", &sinfo, NULL);
-    for (; sinfo != NULL; sinfo = sinfo->next) {
-      GObject *info = sinfo->data;
-      gint type;
-      GParamSpec *pspec;
-      GEnumValue *val;
-      GstPad *pad = NULL;
-
-      g_object_get (info, "type", &type, NULL);
-      pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (info), "type");
-      val = g_enum_get_value (G_PARAM_SPEC_ENUM (pspec)->enum_class, type);
-      g_object_get (info, "object", &pad, NULL);
-
-      if (strstr (val->value_name, "VIDEO") && pad && GST_IS_PAD (pad)) {
-        if (GST_PAD_CAPS (pad)) {
-          cb_caps_set (G_OBJECT (pad), NULL, video);
-        } else {
-          g_signal_connect (pad, "notify::caps",
-              G_CALLBACK (cb_caps_set), video);
-        }
+    const GstPlayerStream *stream;
+
+    if (!video->topo)
+      return;
+
+    stream = gst_player_topology_get_stream (video->topo,
+					     GST_PLAYER_STREAM_VIDEO);
+    if (stream && stream->pad) {
+      if (GST_PAD_CAPS (stream->pad)) {
+        cb_caps_set (G_OBJECT (stream->pad), NULL, video);
+      } else {
+        g_signal_connect (stream->pad, "notify::caps",
+            G_CALLBACK (cb_caps_set), video);
       }
     }
   }
@@ -596,3 +707,29 @@ gst_player_video_default_size (GstPlayerVideo *video)
 
   g_idle_add (idle_desired_size, video);
 }
+
+/*
+ * Where to record the first expose of newly loaded media.
+ */
+
+void
+gst_player_video_set_milestones (GstPlayerVideo      *video,
+				 GstPlayerMilestones *ms)
+{
+  g_return_if_fail (GST_PLAYER_IS_VIDEO (video));
+
+  video->milestones = ms;
+}
+
+/*
+ * Streams of the loaded media, shared with the window.
+ */
+
+void
+gst_player_video_set_topology (GstPlayerVideo    *video,
+			       GstPlayerTopology *topo)
+{
+  g_return_if_fail (GST_PLAYER_IS_VIDEO (video));
+
+  video->topo = topo;
+}
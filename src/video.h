@@ -27,6 +27,11 @@
 #include <gdk/gdk.h>
 #include <gtk/gtkwidget.h>
 
+#include "dispatcher.h"
+#include "milestones.h"
+#include "sink.h"
+#include "topology.h"
+
 G_BEGIN_DECLS
 
 #define GST_PLAYER_TYPE_VIDEO \
@@ -45,11 +50,26 @@ G_BEGIN_DECLS
 typedef struct _GstPlayerVideo {
   GtkWidget widget;
 
-  /* video overlay element */
-  GstElement *element, *play;
+  /* video overlay element and the sink it lives in */
+  GstElement *element, *sink, *play;
+  GstPlayerDispatcher *disp;
   gulong id, id2;
   gint width, height;
   GdkWindow *full_window, *video_window;
+
+  /* letterboxed video inside the widget, as last allocated */
+  GdkRectangle rect;
+  gboolean rect_changed;
+  guint exposes, fills, overlay_exposes;
+
+  /* idle logo: the original first, then pre-downscaled halves,
+   * and the last size drawn into a server-side pixmap */
+  GPtrArray *logo_levels;
+  GdkPixmap *logo_pixmap;
+  gint logo_width, logo_height;
+
+  GstPlayerMilestones *milestones;
+  GstPlayerTopology *topo;
 } GstPlayerVideo;
 
 typedef struct _GstPlayerVideoClass {
@@ -60,8 +80,14 @@ typedef struct _GstPlayerVideoClass {
 
 GType		gst_player_video_get_type	(void);
 GtkWidget *	gst_player_video_new		(GstElement *element,
-						 GstElement *play);
+						 GstElement *play,
+						 GstPlayerDispatcher *disp);
 void		gst_player_video_default_size	(GstPlayerVideo *video);
+void		gst_player_video_set_milestones	(GstPlayerVideo *video,
+						 GstPlayerMilestones *ms);
+void		gst_player_video_set_topology	(GstPlayerVideo *video,
+						 GstPlayerTopology *topo);
+gchar *		gst_player_video_dump		(GstPlayerVideo *video);
 
 G_END_DECLS
 
@@ -23,6 +23,8 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+
 #include <gtk/gtk.h>
 #include <gtk/gtkmain.h>
 #include <gtk/gtksignal.h>
@@ -32,7 +34,11 @@
 #include <libgnomeui/libgnomeui.h>
 
 #include "disc.h"
+#include "drives.h"
+#include "performance.h"
+#include "pipeline.h"
 #include "properties.h"
+#include "sink.h"
 #include "stock.h"
 #include "video.h"
 #include "window.h"
@@ -40,6 +46,7 @@
 static void	gst_player_window_class_init	(GstPlayerWindowClass *klass);
 static void	gst_player_window_init		(GstPlayerWindow *win);
 static void	gst_player_window_dispose	(GObject         *object);
+static void	gst_player_window_finalize	(GObject         *object);
 
 static gboolean	gst_player_window_keypress	(GtkWidget       *widget,
 						 GdkEventKey     *event);
@@ -52,6 +59,8 @@ static void	cb_open_location		(GtkWidget       *widget,
 						 gpointer         data);
 static void	cb_properties			(GtkWidget       *widget,
 						 gpointer         data);
+static void	cb_performance			(GtkWidget       *widget,
+						 gpointer         data);
 static void	cb_play_or_pause		(GtkWidget       *widget,
 						 gpointer         data);
 
@@ -81,21 +90,20 @@ static void	cb_found_tag			(GstElement      *play,
 static void	cb_eos				(GstElement      *play,
 						 gpointer         data);
 
-static GnomeAppClass *parent_class = NULL;
-
-#define GST_PLAYER_ERROR \
-  (gst_player_error_quark ())
-
-static GQuark
-gst_player_error_quark (void)
-{
-  static GQuark quark = 0;
-
-  if (quark == 0)
-    quark = g_quark_from_static_string ("gst-player-error-quark");
+static void	media_close			(GstPlayerWindow *win);
+static void	media_start			(GstPlayerWindow *win,
+						 const gchar     *uri);
+static void	media_loaded			(GstPlayerWindow *win);
+
+/* playlist switch in progress, see cb_audio_buffer() */
+enum {
+  SWITCH_NONE = 0,
+  SWITCH_RESTART,	/* the pipeline was restarted after EOS */
+  SWITCH_GAPLESS,	/* the next uri is set, the previous item plays */
+  SWITCH_SEGMENT	/* the next item's segment reached the audio sink */
+};
 
-  return quark;
-}
+static GnomeAppClass *parent_class = NULL;
 
 GType
 gst_player_window_get_type (void)
@@ -134,6 +142,7 @@ gst_player_window_class_init (GstPlayerWindowClass *klass)
   parent_class = g_type_class_ref (GNOME_TYPE_APP);
 
   gobject_class->dispose = gst_player_window_dispose;
+  gobject_class->finalize = gst_player_window_finalize;
   gtkwidget_class->key_press_event = gst_player_window_keypress;
 }
 
@@ -165,6 +174,9 @@ static GnomeUIInfo file_menu[] = {
   GNOMEUIINFO_ITEM_QUICKKEY (N_("Propertie_s"), N_("Stream properties"),
 			     cb_properties, GTK_STOCK_PROPERTIES,
 			     GDK_CONTROL_MASK, 's'),
+  GNOMEUIINFO_ITEM_QUICKKEY (N_("Pe_rformance"), N_("Playback performance"),
+			     cb_performance, GTK_STOCK_INFO,
+			     GDK_CONTROL_MASK, 'r'),
   GNOMEUIINFO_ITEM_QUICKKEY (N_("_Play / Pause"), N_("Play or pause"),
 			     cb_play_or_pause, GST_PLAYER_STOCK_PLAY,
 			     GDK_CONTROL_MASK, 'p'),
@@ -225,10 +237,31 @@ gst_player_window_init (GstPlayerWindow *win)
 
   win->fullscreen = FALSE;
   win->play = NULL;
+  win->disp = NULL;
   win->video = NULL;
-  win->idle_id = 0;
+  win->playlist_lock = g_mutex_new ();
+  win->playlist = g_queue_new ();
+  win->next_uri = NULL;
+  win->next_tags = NULL;
+  win->switch_timer = g_timer_new ();
+  win->switching = SWITCH_NONE;
+  gst_segment_init (&win->audio_segment, GST_FORMAT_UNDEFINED);
+  win->audio_end = GST_CLOCK_TIME_NONE;
+  win->milestones = gst_player_milestones_new ();
+  win->tracer = NULL;
+  win->sinkstats = NULL;
+  win->perf = NULL;
   win->props = NULL;
-  win->tagcache = NULL;
+  win->tags = gst_player_tags_new ();
+  win->topo = NULL;
+  win->index = NULL;
+  win->metadata = NULL;
+  win->media_uri = NULL;
+  win->media_cached = NULL;
+  win->media = NULL;
+  win->disc_detect = NULL;
+  win->disc_device = NULL;
+  win->drives = NULL;
 
   /* init */
   gnome_app_construct (app, PACKAGE, PACKAGE_NAME);
@@ -239,16 +272,19 @@ gst_player_window_init (GstPlayerWindow *win)
   gtk_widget_hide (tool[1].widget);
 
   /* statusbar */
-  bar = gnome_appbar_new (FALSE, TRUE, GNOME_PREFERENCES_USER);
+  bar = gnome_appbar_new (TRUE, TRUE, GNOME_PREFERENCES_USER);
   gnome_app_set_statusbar (app, bar);
   gnome_app_install_appbar_menu_hints (GNOME_APPBAR (bar), menu);
 }
 
 static void
-cb_message (GstBus    *bus,
-            GstMessage*message,
+cb_message (GstMessage*message,
             gpointer   user_data)
 {
+  /* disposed, waiting for finalization */
+  if (!GST_PLAYER_WINDOW (user_data)->play)
+    return;
+
   switch (message->type) {
     case GST_MESSAGE_EOS:
       cb_eos (GST_PLAYER_WINDOW (user_data)->play,
@@ -282,6 +318,11 @@ cb_message (GstBus    *bus,
                                          &new_state,
                                          NULL);
 
+        /* may be coalesced with going to PLAYING */
+        if (old_state <= GST_STATE_READY && new_state >= GST_STATE_PAUSED)
+          gst_player_milestones_mark (GST_PLAYER_WINDOW (user_data)->milestones,
+                                      GST_PLAYER_MILESTONE_PREROLL);
+
         cb_state (GST_PLAYER_WINDOW (user_data)->play,
                   old_state,
                   new_state,
@@ -308,6 +349,235 @@ cb_message (GstBus    *bus,
   }
 }
 
+/*
+ * The next playlist item is playing now, called from the main loop.
+ */
+
+static gboolean
+cb_switched (gpointer data)
+{
+  GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
+  GstTagList *tags;
+  gchar *uri = NULL;
+
+  /* not disposed yet? */
+  if (win->play) {
+    g_mutex_lock (win->playlist_lock);
+    uri = win->next_uri;
+    win->next_uri = NULL;
+    g_mutex_unlock (win->playlist_lock);
+  }
+  tags = win->next_tags;
+  win->next_tags = NULL;
+
+  if (uri) {
+    media_start (win, uri);
+    if (win->timer->thumbs)
+      gst_player_thumbnailer_set_uri (win->timer->thumbs, uri);
+    if (tags)
+      cb_found_tag (win->play, NULL, tags, win);
+    media_loaded (win);
+  }
+
+  if (tags)
+    gst_tag_list_free (tags);
+  g_free (uri);
+  g_object_unref (G_OBJECT (win));
+
+  /* once */
+  return FALSE;
+}
+
+/*
+ * Keeps track of the running time of what reaches the audio sink.
+ */
+
+static gboolean
+cb_audio_event (GstPad   *pad,
+                GstEvent *event,
+                gpointer  data)
+{
+  GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_STOP:
+      gst_segment_init (&win->audio_segment, GST_FORMAT_UNDEFINED);
+      win->audio_end = GST_CLOCK_TIME_NONE;
+      break;
+    case GST_EVENT_NEWSEGMENT:
+      {
+        gboolean update;
+        gdouble rate, arate;
+        GstFormat format;
+        gint64 start, stop, time;
+
+        gst_event_parse_new_segment_full (event, &update, &rate, &arate,
+                                          &format, &start, &stop, &time);
+        if (format != GST_FORMAT_TIME)
+          break;
+
+        if (win->audio_segment.format != GST_FORMAT_TIME)
+          gst_segment_init (&win->audio_segment, GST_FORMAT_TIME);
+        gst_segment_set_newsegment_full (&win->audio_segment, update,
+                                         rate, arate, format,
+                                         start, stop, time);
+
+        /* the next item starts here */
+        if (!update)
+          g_atomic_int_compare_and_exchange (&win->switching,
+                                             SWITCH_GAPLESS, SWITCH_SEGMENT);
+      }
+      break;
+    default:
+      break;
+  }
+
+  return TRUE;
+}
+
+/*
+ * Called for every buffer that reaches the audio sink. Right after a
+ * playlist switch, reports how long the output went without samples:
+ * on a gapless switch, that's the difference in running time between
+ * the end of the last buffer of the previous item and the start of
+ * this one, which is what the sink fills with silence.
+ */
+
+static gboolean
+cb_audio_buffer (GstPad    *pad,
+                 GstBuffer *buffer,
+                 gpointer   data)
+{
+  GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
+  GstClockTime start = GST_CLOCK_TIME_NONE;
+  gdouble duration = -1.;
+  gint switching;
+
+  if (win->audio_segment.format == GST_FORMAT_TIME &&
+      GST_BUFFER_TIMESTAMP_IS_VALID (buffer)) {
+    start = gst_segment_to_running_time (&win->audio_segment,
+        GST_FORMAT_TIME, GST_BUFFER_TIMESTAMP (buffer));
+  }
+  if (GST_BUFFER_DURATION_IS_VALID (buffer))
+    duration = (gdouble) GST_BUFFER_DURATION (buffer) / GST_MSECOND;
+
+  switching = g_atomic_int_get (&win->switching);
+  if ((switching == SWITCH_RESTART || switching == SWITCH_SEGMENT) &&
+      g_atomic_int_compare_and_exchange (&win->switching,
+                                         switching, SWITCH_NONE)) {
+    if (switching == SWITCH_RESTART) {
+      gst_player_milestones_set_gap (win->milestones,
+          g_timer_elapsed (win->switch_timer, NULL) * 1000., duration);
+    } else {
+      gst_player_milestones_start (win->milestones);
+      if (GST_CLOCK_TIME_IS_VALID (start) &&
+          GST_CLOCK_TIME_IS_VALID (win->audio_end)) {
+        gst_player_milestones_set_gap (win->milestones,
+            (gdouble) GST_CLOCK_DIFF (win->audio_end, start) / GST_MSECOND,
+            duration);
+      }
+      g_idle_add (cb_switched, g_object_ref (G_OBJECT (win)));
+    }
+  }
+
+  if (GST_CLOCK_TIME_IS_VALID (start) &&
+      GST_BUFFER_DURATION_IS_VALID (buffer)) {
+    win->audio_end = start + GST_BUFFER_DURATION (buffer);
+    gst_segment_set_last_stop (&win->audio_segment, GST_FORMAT_TIME,
+        GST_BUFFER_TIMESTAMP (buffer) + GST_BUFFER_DURATION (buffer));
+  }
+
+  return TRUE;
+}
+
+/*
+ * playbin2 asks for the next uri from its streaming thread, so that
+ * it can preroll the next item while the current one plays out.
+ */
+
+static void
+cb_about_to_finish (GstElement *play,
+                    gpointer    data)
+{
+  GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
+  gchar *uri;
+
+  g_mutex_lock (win->playlist_lock);
+  if ((uri = g_queue_pop_head (win->playlist))) {
+    g_object_set (G_OBJECT (play), "uri", uri, NULL);
+    g_free (win->next_uri);
+    win->next_uri = uri;
+    g_atomic_int_set (&win->switching, SWITCH_GAPLESS);
+
+    /* queued items never come from a disc picked by drive */
+    g_free (win->disc_device);
+    win->disc_device = NULL;
+  }
+  g_mutex_unlock (win->playlist_lock);
+
+  /* keyframes seen from now on may belong to either item */
+  if (uri)
+    gst_player_index_open (win->index, NULL);
+}
+
+/*
+ * Disc sources read from their default device unless told otherwise,
+ * so the drive that was picked is set on them once playbin made one.
+ * Other sources have no "device" property and are left alone.
+ */
+
+static void
+cb_source (GObject    *play,
+	   GParamSpec *pspec,
+	   gpointer    data)
+{
+  GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
+  GObject *source = NULL;
+  gchar *device;
+
+  g_mutex_lock (win->playlist_lock);
+  device = g_strdup (win->disc_device);
+  g_mutex_unlock (win->playlist_lock);
+  if (!device)
+    return;
+
+  g_object_get (play, "source", &source, NULL);
+  if (source) {
+    if (g_object_class_find_property (G_OBJECT_GET_CLASS (source), "device"))
+      g_object_set (source, "device", device, NULL);
+    g_object_unref (source);
+  }
+  g_free (device);
+}
+
+static void
+cb_milestone (gpointer ms,
+              gpointer data)
+{
+  GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
+
+  if (win->props) {
+    gst_player_properties_update (GST_PLAYER_PROPERTIES (win->props),
+				  win->topo, win->tags);
+  }
+}
+
+/*
+ * Tags changed, at most a few times per second.
+ */
+
+static void
+cb_tags_changed (gpointer tags,
+                 gpointer data)
+{
+  GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
+
+  if (win->props) {
+    gst_player_properties_update (GST_PLAYER_PROPERTIES (win->props),
+				  win->topo, win->tags);
+  }
+}
+
 GtkWidget *
 gst_player_window_new (GError **err)
 {
@@ -317,48 +587,56 @@ gst_player_window_new (GError **err)
   GstElement *audio, *video;
   GnomeApp *app;
   GtkWidget       *videow, *toolbar, *slider;
-  GstBus          *bus;
-
-  /* start with the player */
-  if (!(play = gst_element_factory_make ("playbin", "player"))) {
-    g_set_error (err, GST_PLAYER_ERROR, 1,
-		 _("Failed to create playbin element"));
-    return NULL;
-  }
+  GstPad          *pad;
 
   /* set video/audio output */
   if (!(audio = gst_element_factory_make ("gconfaudiosink", "audio-sink"))) {
     g_set_error (err, GST_PLAYER_ERROR, 1,
 		 _("Failed to obtain default audio sink from GConf"));
-    goto fail;
+    return NULL;
   }
-  g_object_set (play, "audio-sink", audio, NULL);
 
-  if (!(video = gst_element_factory_make ("ximagesink", "video-sink"))) {
-    g_set_error (err, GST_PLAYER_ERROR, 1,
-		 _("Failed to obtain default video sink from GConf"));
-    goto fail;
+  if (!(video = gst_player_video_sink_new (err))) {
+    gst_object_unref (GST_OBJECT (audio));
+    return NULL;
   }
-  g_object_set (play, "video-sink", video, NULL);
 
-  if (gst_element_set_state (GST_ELEMENT (play),
-			     GST_STATE_READY) == GST_STATE_CHANGE_FAILURE) {
-    g_set_error (err, GST_PLAYER_ERROR, 1,
-		 _("Failed to set player to initial ready state - fatal"));
-    goto fail;
-  }
+  /* and the player itself */
+  if (!(play = gst_player_pipeline_new (audio, video, err)))
+    return NULL;
 
   /* actual window */
   win = g_object_new (GST_PLAYER_TYPE_WINDOW, NULL);
   app = GNOME_APP (win);
   win->play = play;
-  bus = gst_pipeline_get_bus (GST_PIPELINE (play));
-  gst_bus_add_signal_watch (bus);
-  g_signal_connect (bus, "message", G_CALLBACK (cb_message), win);
+  win->topo = gst_player_topology_new (play);
+  win->index = gst_player_index_new (play);
+  win->metadata = gst_player_metadata_new ();
+  win->sinkstats = gst_player_sink_stats_new (video);
+  win->disp = gst_player_dispatcher_new (play);
+  gst_player_dispatcher_subscribe (win->disp,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR | GST_MESSAGE_TAG, NULL,
+      cb_message, win);
+  gst_player_dispatcher_subscribe (win->disp,
+      GST_MESSAGE_STATE_CHANGED, GST_OBJECT (play), cb_message, win);
+  if ((pad = gst_element_get_static_pad (audio, "sink"))) {
+    gst_pad_add_event_probe (pad, G_CALLBACK (cb_audio_event), win);
+    gst_pad_add_buffer_probe (pad, G_CALLBACK (cb_audio_buffer), win);
+    gst_object_unref (GST_OBJECT (pad));
+  }
+  if (g_signal_lookup ("about-to-finish", G_OBJECT_TYPE (play)))
+    g_signal_connect (play, "about-to-finish",
+		      G_CALLBACK (cb_about_to_finish), win);
+  g_signal_connect (play, "notify::source", G_CALLBACK (cb_source), win);
+  gst_player_milestones_attach (win->milestones, play, audio, video);
+  gst_player_milestones_set_notify (win->milestones, cb_milestone, win);
+  gst_player_tags_set_notify (win->tags, 250, cb_tags_changed, win);
 
   /* add slider */
-  slider = gst_player_timer_new (play);
+  slider = gst_player_timer_new (play, win->disp);
   win->timer = GST_PLAYER_TIMER (slider);
+  if (win->timer->seek)
+    gst_player_seek_set_index (win->timer->seek, win->index);
   item = gnome_app_get_dock_item_by_name (app, GNOME_APP_TOOLBAR_NAME);
   toolbar = bonobo_dock_item_get_child (item);
   gtk_toolbar_append_widget (GTK_TOOLBAR (toolbar), slider,
@@ -366,16 +644,14 @@ gst_player_window_new (GError **err)
   gtk_widget_show (slider);
 
   /* video widget */
-  videow = gst_player_video_new (video, play);
+  videow = gst_player_video_new (video, play, win->disp);
   win->video = videow;
+  gst_player_video_set_milestones (GST_PLAYER_VIDEO (videow), win->milestones);
+  gst_player_video_set_topology (GST_PLAYER_VIDEO (videow), win->topo);
   gnome_app_set_contents (app, videow);
   gtk_widget_show (videow);
 
   return GTK_WIDGET (win);
-
-fail:
-  gst_object_unref (GST_OBJECT (play));
-  return NULL;
 }
 
 static void
@@ -383,23 +659,119 @@ gst_player_window_dispose (GObject *object)
 {
   GstPlayerWindow *win = GST_PLAYER_WINDOW (object);
 
+  if (win->perf) {
+    gtk_widget_destroy (win->perf);
+    win->perf = NULL;
+  }
+  if (win->disc_detect) {
+    cd_detect_cancel (win->disc_detect);
+    win->disc_detect = NULL;
+  }
+  if (win->drives) {
+    gtk_widget_destroy (win->drives);
+    win->drives = NULL;
+  }
+  if (win->metadata) {
+    media_close (win);
+    gst_player_metadata_free (win->metadata);
+    win->metadata = NULL;
+  }
+  if (win->topo) {
+    if (win->video)
+      gst_player_video_set_topology (GST_PLAYER_VIDEO (win->video), NULL);
+    gst_player_topology_free (win->topo);
+    win->topo = NULL;
+  }
   if (win->play) {
     gst_element_set_state (GST_ELEMENT (win->play), GST_STATE_NULL);
     gst_object_unref (GST_OBJECT (win->play));
     win->play = NULL;
   }
-  if (win->tagcache) {
-    gst_tag_list_free (win->tagcache);
-    win->tagcache = NULL;
+  g_free (win->disc_device);
+  win->disc_device = NULL;
+  if (win->tracer) {
+    gst_player_tracer_free (win->tracer);
+    win->tracer = NULL;
+  }
+  if (win->index) {
+    if (win->timer && win->timer->seek)
+      gst_player_seek_set_index (win->timer->seek, NULL);
+    gst_player_index_free (win->index);
+    win->index = NULL;
+  }
+  if (win->sinkstats) {
+    gst_player_sink_stats_free (win->sinkstats);
+    win->sinkstats = NULL;
+  }
+  if (win->tags) {
+    gst_player_tags_free (win->tags);
+    win->tags = NULL;
+  }
+  if (win->playlist) {
+    g_queue_foreach (win->playlist, (GFunc) g_free, NULL);
+    g_queue_free (win->playlist);
+    win->playlist = NULL;
+  }
+  g_free (win->next_uri);
+  win->next_uri = NULL;
+  if (win->next_tags) {
+    gst_tag_list_free (win->next_tags);
+    win->next_tags = NULL;
+  }
+  if (win->switch_timer) {
+    g_timer_destroy (win->switch_timer);
+    win->switch_timer = NULL;
+  }
+  if (win->milestones) {
+    if (win->video)
+      gst_player_video_set_milestones (GST_PLAYER_VIDEO (win->video), NULL);
+    if (win->props)
+      gst_player_properties_set_milestones (GST_PLAYER_PROPERTIES (win->props),
+					    NULL);
+    gst_player_milestones_free (win->milestones);
+    win->milestones = NULL;
   }
 
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
+/*
+ * The timer and video widget unsubscribe when they are destroyed,
+ * which happens when chaining up in dispose, so the dispatcher has to
+ * stay around until here.
+ */
+
+static void
+gst_player_window_finalize (GObject *object)
+{
+  GstPlayerWindow *win = GST_PLAYER_WINDOW (object);
+
+  if (win->disp) {
+    gst_player_dispatcher_free (win->disp);
+    win->disp = NULL;
+  }
+  g_mutex_free (win->playlist_lock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static gboolean
 gst_player_window_keypress (GtkWidget   *widget,
 			    GdkEventKey *event)
 {
+  GstPlayerWindow *win = GST_PLAYER_WINDOW (widget);
+
+  /* give up on a slow drive */
+  if (win->disc_detect && event->keyval == GDK_Escape) {
+    cd_detect_cancel (win->disc_detect);
+    win->disc_detect = NULL;
+    gnome_appbar_set_status (GNOME_APPBAR (GNOME_APP (win)->statusbar), "");
+    gnome_appbar_set_progress_percentage (
+        GNOME_APPBAR (GNOME_APP (win)->statusbar), 0.);
+
+    return TRUE;
+  }
+
   if (GST_PLAYER_WINDOW (widget)->fullscreen &&
       (event->keyval == GDK_Escape ||
        (event->keyval == GDK_Return &&
@@ -413,31 +785,91 @@ gst_player_window_keypress (GtkWidget   *widget,
 }
 
 /*
- * Iterate callback, do some maintainance in the timer.
+ * Menu/Toolbar actions.
  */
 
-static gboolean
-cb_iterate (gpointer data)
+/*
+ * Metadata cache. What's cached for the current media is shown until
+ * the pipeline prerolled, and whatever was learned meanwhile is
+ * written back when the media is left.
+ */
+
+static void
+media_show_cached (GstPlayerWindow *win)
 {
-  GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
-  gboolean res;
-  GstState state;
-  gst_element_get_state (win->play, &state, NULL, 100 /* usec */ * GST_NSECOND / GST_USECOND);
-  res = state == GST_STATE_PLAYING;
+  GstPlayerMediaInfo *cached = win->media_cached;
 
-  /* update timer - EOS might have killed us already so stop then*/
-  if (res && win->idle_id != 0)
-    gst_player_timer_progress (win->timer);
-  else if (!res)
-    win->idle_id = 0;
+  gst_player_topology_set_cached (win->topo, cached ? cached->streams : NULL);
+  if (cached && cached->tags)
+    gst_player_tags_merge (win->tags, cached->tags);
+  gst_player_timer_set_duration (win->timer,
+      cached ? cached->duration : GST_CLOCK_TIME_NONE);
 
-  return res;
+  if (win->props) {
+    gst_player_properties_update (GST_PLAYER_PROPERTIES (win->props),
+				  win->topo, win->tags);
+  }
+}
+
+static void
+media_close (GstPlayerWindow *win)
+{
+  gst_player_topology_set_cached (win->topo, NULL);
+
+  if (win->media) {
+    /* the duration may not have been known yet at preroll */
+    if (!GST_CLOCK_TIME_IS_VALID (win->media->duration))
+      win->media->duration = win->timer->len;
+    if (win->media->tags)
+      gst_tag_list_free (win->media->tags);
+    win->media->tags = gst_player_tags_to_list (win->tags);
+
+    if (win->media->streams &&
+        (!win->media_cached ||
+         !gst_player_media_info_equal (win->media, win->media_cached)))
+      gst_player_metadata_store (win->metadata, win->media_uri, win->media);
+    gst_player_media_info_free (win->media);
+    win->media = NULL;
+  }
+  if (win->media_cached) {
+    gst_player_media_info_free (win->media_cached);
+    win->media_cached = NULL;
+  }
+  g_free (win->media_uri);
+  win->media_uri = NULL;
+}
+
+static void
+media_open (GstPlayerWindow *win,
+	    const gchar     *uri)
+{
+  media_close (win);
+
+  win->media_uri = g_strdup (uri);
+  win->media = gst_player_media_info_new ();
+  win->media_cached = gst_player_metadata_lookup (win->metadata, uri);
+
+  gst_player_tags_clear (win->tags);
+  media_show_cached (win);
 }
 
 /*
- * Menu/Toolbar actions.
+ * Per-item state and counters, for uri, which is about to be set on
+ * the pipeline.
  */
 
+static void
+media_start (GstPlayerWindow *win,
+	     const gchar     *uri)
+{
+  gst_player_topology_invalidate (win->topo);
+  media_open (win, uri);
+  gst_player_index_open (win->index, uri);
+  if (win->tracer)
+    gst_player_tracer_reset (win->tracer);
+  gst_player_sink_stats_reset (win->sinkstats);
+}
+
 static gboolean
 cb_play (gpointer data)
 {
@@ -457,10 +889,58 @@ gst_player_window_play (GstPlayerWindow* self,
   g_return_if_fail (GST_PLAYER_IS_WINDOW (self));
   g_return_if_fail (uri && *uri);
 
+  /* a new explicit choice replaces whatever was queued */
+  g_mutex_lock (self->playlist_lock);
+  g_queue_foreach (self->playlist, (GFunc) g_free, NULL);
+  g_queue_clear (self->playlist);
+  g_free (self->next_uri);
+  self->next_uri = NULL;
+  g_free (self->disc_device);
+  self->disc_device = NULL;
+  g_atomic_int_set (&self->switching, SWITCH_NONE);
+  g_mutex_unlock (self->playlist_lock);
+  if (self->next_tags) {
+    gst_tag_list_free (self->next_tags);
+    self->next_tags = NULL;
+  }
+
+  media_start (self, uri);
   g_object_set (G_OBJECT (self->play), "uri", uri, NULL);
+  gst_player_milestones_start (self->milestones);
   g_idle_add (cb_play, self);
 }
 
+/*
+ * Start collecting per-element processing times. There's a small
+ * cost for every buffer, so this is off by default.
+ */
+
+void
+gst_player_window_enable_tracer (GstPlayerWindow* self)
+{
+  g_return_if_fail (GST_PLAYER_IS_WINDOW (self));
+
+  if (!self->tracer)
+    self->tracer = gst_player_tracer_new (self->play);
+}
+
+/*
+ * Queue an item to be played after the current one (and everything
+ * queued before it) has finished.
+ */
+
+void
+gst_player_window_enqueue (GstPlayerWindow* self,
+                           gchar const    * uri)
+{
+  g_return_if_fail (GST_PLAYER_IS_WINDOW (self));
+  g_return_if_fail (uri && *uri);
+
+  g_mutex_lock (self->playlist_lock);
+  g_queue_push_tail (self->playlist, g_strdup (uri));
+  g_mutex_unlock (self->playlist_lock);
+}
+
 static void
 cb_open_file (GtkWidget *widget,
 	      gpointer   data)
@@ -494,44 +974,124 @@ cb_open_file (GtkWidget *widget,
 }
 
 static void
-cb_open_disc (GtkWidget *widget,
-	      gpointer   data)
+cb_disc_progress (const gchar *message,
+		  gdouble      fraction,
+		  gpointer     data)
+{
+  GnomeAppBar *bar = GNOME_APPBAR (GNOME_APP (data)->statusbar);
+
+  gnome_appbar_set_status (bar, message);
+  gnome_appbar_set_progress_percentage (bar, fraction);
+}
+
+static void
+disc_open (GstPlayerWindow *win,
+	   CdType           type,
+	   const gchar     *uri,
+	   const gchar     *device)
+{
+  if (type == CD_TYPE_DATA) {
+    /* FIXME:
+     * - open correct location to mount path by default.
+     */
+    cb_open_file (NULL, win);
+  } else {
+    gst_element_set_state (win->play, GST_STATE_READY);
+    gst_player_window_play (win, uri);
+
+    /* playing only starts from the main loop, so this is in time */
+    g_mutex_lock (win->playlist_lock);
+    win->disc_device = g_strdup (device);
+    g_mutex_unlock (win->playlist_lock);
+  }
+}
+
+static void
+cb_disc_detected (CdType       type,
+		  const gchar *uri,
+		  GError      *error,
+		  gpointer     data)
 {
   GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
-  /* FIXME: drive detection */
-  GError *error = NULL;
-  CdType type = cd_detect_type ("/dev/cdrom", &error);
+  GnomeAppBar *bar = GNOME_APPBAR (GNOME_APP (win)->statusbar);
+  CdDetect *detect = win->disc_detect;
+
+  win->disc_detect = NULL;
+  gnome_appbar_set_status (bar, "");
+  gnome_appbar_set_progress_percentage (bar, 0.);
 
-  if (type == CD_TYPE_ERROR) {
+  /* detect is freed once this returns */
+  if (type == CD_TYPE_ERROR)
     cb_error (win->play, win->play, error, "no details", win);
-    g_error_free (error);
+  else
+    disc_open (win, type, uri, detect->device);
+}
+
+static void
+cb_drives_response (GtkDialog *dialog,
+		    gint       response,
+		    gpointer   data)
+{
+  GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
+  const gchar *uri = NULL, *device = NULL;
+  CdType type = CD_TYPE_ERROR;
+
+  if (response == GTK_RESPONSE_OK &&
+      gst_player_drives_get_selected (GST_PLAYER_DRIVES (dialog),
+				      &type, &uri, &device)) {
+    gchar *copy = g_strdup (device);
+
+    /* device belongs to the dialog */
+    gtk_widget_destroy (GTK_WIDGET (dialog));
+    disc_open (win, type, uri, copy);
+    g_free (copy);
   } else {
-    const gchar *uri = NULL;
-
-    switch (type) {
-      case CD_TYPE_DATA:
-        /* FIXME:
-         * - open correct location to mount path by default.
-         */
-        cb_open_file (widget, data);
-        return;
-      case CD_TYPE_CDDA:
-        uri = "cdda://";
-        break;
-      case CD_TYPE_VCD:
-        uri = "vcd://";
-        break;
-      case CD_TYPE_DVD:
-        uri = "dvd://";
-        break;
-      default:
-        g_assert_not_reached ();
-    }
-    gst_element_set_state (win->play, GST_STATE_READY);
-    g_object_set (G_OBJECT (win->play), "uri", uri, NULL);
+    gtk_widget_destroy (GTK_WIDGET (dialog));
+  }
+}
 
-    g_idle_add (cb_play, win);
+static void
+cb_drives_destroy (GtkWidget *widget,
+		   gpointer   data)
+{
+  GST_PLAYER_WINDOW (data)->drives = NULL;
+}
+
+static void
+cb_open_disc (GtkWidget *widget,
+	      gpointer   data)
+{
+  GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
+  GList *devices;
+
+  if (win->drives) {
+    gtk_window_present (GTK_WINDOW (win->drives));
+    return;
+  }
+
+  if (win->disc_detect) {
+    cd_detect_cancel (win->disc_detect);
+    win->disc_detect = NULL;
   }
+
+  /* a single drive is opened right away; otherwise, probe all of
+   * them at once and let the user pick */
+  devices = cd_drive_list ();
+  if (!devices->next) {
+    win->disc_detect = cd_detect_type_async (devices->data,
+        cb_disc_progress, cb_disc_detected, win);
+  } else {
+    win->drives = gst_player_drives_new (devices);
+    gtk_window_set_transient_for (GTK_WINDOW (win->drives),
+				  GTK_WINDOW (win));
+    g_signal_connect (win->drives, "response",
+		      G_CALLBACK (cb_drives_response), win);
+    g_signal_connect (win->drives, "destroy",
+		      G_CALLBACK (cb_drives_destroy), win);
+    gtk_widget_show (win->drives);
+  }
+  g_list_foreach (devices, (GFunc) g_free, NULL);
+  g_list_free (devices);
 }
 
 static void
@@ -564,10 +1124,8 @@ cb_open_location (GtkWidget *widget,
     const gchar *location = gtk_entry_get_text (GTK_ENTRY (entry));
 
     gst_element_set_state (win->play, GST_STATE_READY);
-    g_object_set (G_OBJECT (win->play), "uri", location, NULL);
+    gst_player_window_play (win, location);
     gtk_widget_destroy (dialog);
-
-    g_idle_add (cb_play, win);
   } else {
     gtk_widget_destroy (dialog);
   }
@@ -590,14 +1148,41 @@ cb_properties (GtkWidget *widget,
     gtk_window_present (GTK_WINDOW (win->props));
   } else {
     win->props = gst_player_properties_new ();
+    gst_player_properties_set_milestones (GST_PLAYER_PROPERTIES (win->props),
+					  win->milestones);
     gst_player_properties_update (GST_PLAYER_PROPERTIES (win->props),
-				  win->play, win->tagcache);
+				  win->topo, win->tags);
     g_signal_connect (win->props, "destroy",
 		      G_CALLBACK (cb_destroy), win);
     gtk_widget_show (win->props);
   }
 }
 
+static void
+cb_performance_destroy (GtkWidget *widget,
+			gpointer   data)
+{
+  GST_PLAYER_WINDOW (data)->perf = NULL;
+}
+
+static void
+cb_performance (GtkWidget *widget,
+		gpointer   data)
+{
+  GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
+
+  if (win->perf) {
+    gtk_window_present (GTK_WINDOW (win->perf));
+  } else {
+    win->perf = gst_player_performance_new (win->tracer, win->timer,
+					    win->sinkstats,
+					    GST_PLAYER_VIDEO (win->video));
+    g_signal_connect (win->perf, "destroy",
+		      G_CALLBACK (cb_performance_destroy), win);
+    gtk_widget_show (win->perf);
+  }
+}
+
 static void
 cb_play_or_pause (GtkWidget *widget,
 		  gpointer   data)
@@ -721,78 +1306,91 @@ cb_state (GstElement*play,
     /* show play button */
     gtk_widget_show (tool[0].widget);
     gtk_widget_hide (tool[1].widget);
-    if (win->idle_id != 0) {
-      g_source_remove (win->idle_id);
-      win->idle_id = 0;
-    }
+    gst_player_timer_stop (win->timer);
   } else if (new_state == GST_STATE_PLAYING) {
     /* show pause button */
     gtk_widget_show (tool[1].widget);
     gtk_widget_hide (tool[0].widget);
-    if (win->idle_id != 0)
-      g_source_remove (win->idle_id);
-    win->idle_id = g_idle_add (cb_iterate, win);
+    gst_player_timer_start (win->timer);
   }
 
   /* new movie loaded? */
   if (old_state == GST_STATE_READY &&
-      new_state > GST_STATE_READY) {
-    GList *streaminfo = NULL;
-    gboolean have_video = FALSE, have_audio = FALSE;
-
-    g_object_get (G_OBJECT (win->play), "stream-info",
-		  &streaminfo, NULL);
-    for ( ; streaminfo != NULL; streaminfo = streaminfo->next) {
-      GObject *info = streaminfo->data;
-      gint type;
-      GParamSpec *pspec;
-      GEnumValue *val;
-
-      gchar* name;
-
-      g_object_get (info, "type", &type, NULL);
-      pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (info), "type");
-      val = g_enum_get_value (G_PARAM_SPEC_ENUM (pspec)->enum_class, type);
-
-      name = g_utf8_strdown (val->value_name, -1);
-
-      if (strstr (name, "audio")) {
-        have_audio = TRUE;
-      } else if (strstr (name, "video")) {
-        have_video = TRUE;
-      }
+      new_state > GST_STATE_READY)
+    media_loaded (win);
 
-      g_free (name);
-    }
+  /* discarded movie? */
+  if (old_state > GST_STATE_READY &&
+      new_state <= GST_STATE_READY) {
+    gst_player_topology_invalidate (win->topo);
+    gst_player_tags_clear (win->tags);
+    media_show_cached (win);
+  }
+}
 
-    /* show/hide video window */
-    if (have_video)
-      gtk_widget_show (win->video);
-    else
-      gtk_widget_hide (win->video);
+/*
+ * New media prerolled, or the next playlist item started playing.
+ */
 
-    /* well, this resizes the window, which is what I want. */
-    gtk_window_resize (GTK_WINDOW (win), 1, 1);
+static void
+media_loaded (GstPlayerWindow *win)
+{
+  /* show/hide video window */
+  if (gst_player_topology_get_stream (win->topo, GST_PLAYER_STREAM_VIDEO))
+    gtk_widget_show (win->video);
+  else
+    gtk_widget_hide (win->video);
 
-    if (win->props) {
-      gst_player_properties_update (GST_PLAYER_PROPERTIES (win->props),
-				    win->play, NULL);
-    }
+  /* well, this resizes the window, which is what I want. */
+  gtk_window_resize (GTK_WINDOW (win), 1, 1);
+
+  if (win->media) {
+    GstFormat fmt = GST_FORMAT_TIME;
+    gint64 len;
+
+    g_list_foreach (win->media->streams,
+		    (GFunc) gst_player_stream_free, NULL);
+    g_list_free (win->media->streams);
+    win->media->streams = gst_player_topology_copy_streams (win->topo);
+    if (gst_element_query_duration (win->play, &fmt, &len))
+      win->media->duration = len;
   }
 
-  /* discarded movie? */
-  if (old_state > GST_STATE_READY &&
-      new_state == GST_STATE_READY) {
-    if (win->tagcache) {
-      gst_tag_list_free (win->tagcache);
-      win->tagcache = NULL;
-    }
+  if (win->props) {
+    gst_player_properties_update (GST_PLAYER_PROPERTIES (win->props),
+				  win->topo, win->tags);
+  }
+}
+
+/*
+ * Whether element is part of what playbin made to read uri: playbin2
+ * reads each playlist item with a uridecodebin of its own.
+ */
+
+static gboolean
+element_reads_uri (GstPlayerWindow *win,
+		   GstElement      *element,
+		   const gchar     *uri)
+{
+  GstObject *object = gst_object_ref (GST_OBJECT (element)), *parent;
+  gboolean res = FALSE;
+
+  while (!res && object && object != GST_OBJECT (win->play)) {
+    if (g_object_class_find_property (G_OBJECT_GET_CLASS (object), "uri")) {
+      gchar *object_uri = NULL;
 
-    if (win->props) {
-      gst_player_properties_update (GST_PLAYER_PROPERTIES (win->props),
-				    win->play, NULL);
+      g_object_get (object, "uri", &object_uri, NULL);
+      res = object_uri && !strcmp (object_uri, uri);
+      g_free (object_uri);
     }
+    parent = gst_object_get_parent (object);
+    gst_object_unref (object);
+    object = parent;
   }
+  if (object)
+    gst_object_unref (object);
+
+  return res;
 }
 
 static void
@@ -802,22 +1400,27 @@ cb_found_tag (GstElement       *play,
 	      gpointer          data)
 {
   GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
-
-  if (win->tagcache && taglist) {
-    GstTagList *taglist2;
-
-    taglist2 = gst_tag_list_merge (win->tagcache, taglist,
-				  GST_TAG_MERGE_APPEND);
-    gst_tag_list_free (win->tagcache);
-    win->tagcache = taglist2;
-  } else if (taglist) {
-    win->tagcache = gst_tag_list_copy (taglist);
+  gchar *next_uri;
+  gboolean next;
+
+  /* tags of the next playlist item, which isn't playing yet; the
+   * current one may still be sending its own meanwhile */
+  g_mutex_lock (win->playlist_lock);
+  next_uri = g_strdup (win->next_uri);
+  g_mutex_unlock (win->playlist_lock);
+  next = next_uri && source && element_reads_uri (win, source, next_uri);
+  g_free (next_uri);
+  if (next) {
+    if (win->next_tags)
+      gst_tag_list_insert (win->next_tags, taglist, GST_TAG_MERGE_REPLACE);
+    else
+      win->next_tags = gst_tag_list_copy (taglist);
+    return;
   }
 
-  if (win->props) {
-    gst_player_properties_update (GST_PLAYER_PROPERTIES (win->props),
-				  win->play, win->tagcache);
-  }
+  /* the dialog is refreshed from cb_tags_changed(), the metadata
+   * cache gets them in media_close() */
+  gst_player_tags_merge (win->tags, taglist);
 }
 
 static void
@@ -825,11 +1428,30 @@ cb_eos (GstElement *play,
 	gpointer    data)
 {
   GstPlayerWindow *win = GST_PLAYER_WINDOW (data);
+  gchar *uri;
 
-  if (win->idle_id != 0) {
-    g_source_remove (win->idle_id);
-    win->idle_id = 0;
-  }
+  gst_player_timer_stop (win->timer);
 
   gst_element_set_state (win->play, GST_STATE_READY);
+
+  /* continue with the next playlist item right away, from here rather
+   * than from an idle handler, so that the audio sink (which stays
+   * open in READY) doesn't starve any longer than needed. With
+   * playbin2, this only happens if nothing was queued yet when it
+   * asked for the next item. */
+  g_mutex_lock (win->playlist_lock);
+  if ((uri = g_queue_pop_head (win->playlist))) {
+    g_free (win->disc_device);
+    win->disc_device = NULL;
+  }
+  g_mutex_unlock (win->playlist_lock);
+  if (uri) {
+    g_timer_start (win->switch_timer);
+    g_atomic_int_set (&win->switching, SWITCH_RESTART);
+    media_start (win, uri);
+    g_object_set (G_OBJECT (win->play), "uri", uri, NULL);
+    gst_player_milestones_start (win->milestones);
+    gst_element_set_state (win->play, GST_STATE_PLAYING);
+    g_free (uri);
+  }
 }
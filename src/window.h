@@ -27,7 +27,16 @@
 #include <gdk/gdk.h>
 #include <gtk/gtkwidget.h>
 
+#include "disc.h"
+#include "dispatcher.h"
+#include "index.h"
+#include "metadata.h"
+#include "milestones.h"
+#include "sink.h"
+#include "tags.h"
 #include "timer.h"
+#include "topology.h"
+#include "tracer.h"
 
 G_BEGIN_DECLS
 
@@ -46,13 +55,51 @@ typedef struct _GstPlayerWindow {
   GnomeApp parent;
 
   GstElement *play;
+  GstPlayerDispatcher *disp;
   GstPlayerTimer *timer;
   GtkWidget *video;
-  guint idle_id;
+
+  /* playlist. With playbin2, the next item is taken from a streaming
+   * thread before the current one ends, and becomes the current one
+   * once its first audio sample reaches the sink. */
+  GMutex *playlist_lock;
+  GQueue *playlist;
+  gchar *next_uri;
+  GstTagList *next_tags;
+  GTimer *switch_timer;
+  gint switching;
+
+  /* what the audio sink got so far, to measure the gap on a switch */
+  GstSegment audio_segment;
+  GstClockTime audio_end;
+
+  /* time-to-first-frame of the current item */
+  GstPlayerMilestones *milestones;
+
+  /* per-element latency, optional */
+  GstPlayerTracer *tracer;
+  GstPlayerSinkStats *sinkstats;
+  GtkWidget *perf;
 
   /* tagging and streaminfo */
   GtkWidget *props;
-  GstTagList *tagcache;
+  GstPlayerTags *tags;
+  GstPlayerTopology *topo;
+
+  /* keyframes of local files, kept across runs */
+  GstPlayerIndex *index;
+
+  /* duration, streams and tags of local files, kept across runs: what
+   * was known about the current media and what was seen this time */
+  GstPlayerMetadata *metadata;
+  gchar *media_uri;
+  GstPlayerMediaInfo *media_cached, *media;
+
+  /* disc detection in progress, if any, and the drive that the
+   * current item is read from if it's a disc (under playlist_lock) */
+  CdDetect *disc_detect;
+  GtkWidget *drives;
+  gchar *disc_device;
 
   gboolean fullscreen;
 } GstPlayerWindow;
@@ -66,6 +113,9 @@ GtkWidget *	gst_player_window_new		(GError **err);
 
 void            gst_player_window_play          (GstPlayerWindow* self,
                                                  gchar const    * uri);
+void            gst_player_window_enqueue       (GstPlayerWindow* self,
+                                                 gchar const    * uri);
+void            gst_player_window_enable_tracer (GstPlayerWindow* self);
 
 G_END_DECLS
 